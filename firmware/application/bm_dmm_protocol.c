@@ -43,21 +43,28 @@
 
 #define RAW_BIT(data, bit) ((data) & (1 << (bit)))
 
+/// Number of digits with unknown segments pattern found since the last \ref bm_take_invalid_digits_no
+static uint32_t invalidDigitsNo = 0;
+
 
 STATIC INLINE void bm_fill_pkt_constants(data_resp_pkt* const pRespPack);
 STATIC INLINE void bm_calculate_pkt_check_sum(data_resp_pkt* const pRespPack);
-STATIC void convert_sanwa_ir_data_to_bm_pkt(const uint8_t* const pRawData, data_resp_pkt* const pPkg);
-STATIC uint8_t convert_digit_segs_to_val(uint8_t segments);
+STATIC RAMFUNC void convert_sanwa_ir_data_to_bm_pkt(const uint8_t* const pRawData,
+                                                   data_resp_pkt* const pPkg);
+STATIC RAMFUNC uint8_t convert_digit_segs_to_val(uint8_t segments);
 
 STATIC INLINE void _set_exponent_negative(data_resp_pkt* const pPkt);
 
-bm_result bm_create_pkt(const uint8_t* const pRawData, const uint8_t rawDataLen, data_resp_pkt* const pDestPkg) {
+RAMFUNC bm_result bm_create_pkt(const uint8_t* const pRawData, const uint8_t rawDataLen,
+                                data_resp_pkt* const pDestPkg) {
     bm_result retVal = BM_ERROR;
 
     if (NULL != pRawData && NULL != pDestPkg) {
         if (rawDataLen >= SANWA_DATA_LEN) {
-            // clear package memory - only func fields need to be cleared
+            // clear package memory - only func fields and exponent (set only when the dot is displayed) need to be
+            // cleared, the rest is always written
             memset((void*)pDestPkg->func, 0, sizeof(pDestPkg->func));
+            pDestPkg->asciiAndTailLong.exponent = 0;
             // convert from raw data:
             convert_sanwa_ir_data_to_bm_pkt(pRawData, pDestPkg);
             // fill constant values in the package
@@ -72,6 +79,63 @@ bm_result bm_create_pkt(const uint8_t* const pRawData, const uint8_t rawDataLen,
     return retVal;
 }
 
+uint16_t bm_create_adapter_pkt(const uint8_t cmd, const uint8_t* const pData, const uint8_t data_len,
+                               uint8_t* const pDest, const uint16_t dest_len) {
+    const uint16_t pktLen = BM_ADAPTER_PKT_LEN(data_len);
+    if ((NULL == pDest) || ((NULL == pData) && (data_len > 0)) || (pktLen > dest_len)) {
+        return 0;
+    }
+
+    data_resp_header* const pHeader = (data_resp_header*)pDest;
+    pHeader->dle = BM_DLE_CONST;
+    pHeader->stx = BM_STX_CONST;
+    pHeader->cmd = cmd;
+    pHeader->dataLen = data_len;
+
+    uint8_t* const pDestData = &pDest[sizeof(data_resp_header)];
+    uint8_t chkSum = 0;
+    for (int i = 0; i < data_len; ++i) {
+        pDestData[i] = pData[i];
+        chkSum ^= pData[i];
+    }
+
+    data_resp_tail* const pTail = (data_resp_tail*)&pDestData[data_len];
+    pTail->chkSum = chkSum;
+    pTail->dle = BM_DLE_CONST;
+    pTail->etx = BM_ETX_CONST;
+
+    return pktLen;
+}
+
+bm_result bm_create_timestamp_pkt(const uint16_t frame_no, const uint32_t offset_ns,
+                                  timestamp_resp_pkt* const pDestPkg) {
+    if (NULL == pDestPkg) {
+        return BM_ERROR;
+    }
+
+    pDestPkg->header.dle = BM_DLE_CONST;
+    pDestPkg->header.stx = BM_STX_CONST;
+    pDestPkg->header.cmd = BM_ADAPTER_TIMESTAMP_COMMAND;
+    pDestPkg->header.dataLen = BM_TIMESTAMP_PACKET_DATA_LENGTH;
+
+    pDestPkg->frameNo[0] = (uint8_t)frame_no;
+    pDestPkg->frameNo[1] = (uint8_t)(frame_no >> 8);
+    for (int i = 0; i < 4; ++i) {
+        pDestPkg->offsetNs[i] = (uint8_t)(offset_ns >> (8 * i));
+    }
+
+    uint8_t chkSum = 0;
+    const uint8_t* pBytes = pDestPkg->frameNo;
+    for (int i = 0; i < BM_TIMESTAMP_PACKET_DATA_LENGTH; ++i) {
+        chkSum ^= pBytes[i];
+    }
+    pDestPkg->pktTail.chkSum = chkSum;
+    pDestPkg->pktTail.dle = BM_DLE_CONST;
+    pDestPkg->pktTail.etx = BM_ETX_CONST;
+
+    return BM_PKG_CREATED;
+}
+
 
 STATIC INLINE void bm_calculate_pkt_check_sum(data_resp_pkt* const pRespPack) {
     if (NULL != pRespPack) {
@@ -114,7 +178,8 @@ STATIC INLINE void bm_fill_pkt_constants(data_resp_pkt* const pRespPack) {
 }
 
 
-STATIC void convert_sanwa_ir_data_to_bm_pkt(const uint8_t* const pRawData, data_resp_pkt* const pPkg) {
+STATIC RAMFUNC void convert_sanwa_ir_data_to_bm_pkt(const uint8_t* const pRawData,
+                                                   data_resp_pkt* const pPkg) {
     bool isOverLimit = false;
     uint8_t chByte = 0;
     uint8_t digit = DIGIT_EMPTY;
@@ -487,7 +552,7 @@ STATIC void convert_sanwa_ir_data_to_bm_pkt(const uint8_t* const pRawData, data_
 
 
 
-STATIC uint8_t convert_digit_segs_to_val(uint8_t segments) {
+STATIC RAMFUNC uint8_t convert_digit_segs_to_val(uint8_t segments) {
     //    BIT meaning
     //    0   must be set to 0
     //    1   E-segment of 1st digit
@@ -540,12 +605,18 @@ STATIC uint8_t convert_digit_segs_to_val(uint8_t segments) {
     case D0:     retVal = DIGIT_0;     break;
     case DEMPTY: retVal = DIGIT_EMPTY; break;
     case DL:     retVal = DIGIT_L;     break;
-    default:     retVal = DIGIT_INVALID_VALUE; break;
+    default:     retVal = DIGIT_INVALID_VALUE; ++invalidDigitsNo; break;
     };
 
     return retVal;
 }
 
+uint32_t bm_take_invalid_digits_no(void) {
+    const uint32_t retVal = invalidDigitsNo;
+    invalidDigitsNo = 0;
+    return retVal;
+}
+
 STATIC INLINE void _set_exponent_negative(data_resp_pkt* const pPkt) {
     pPkt->asciiAndTailLong.exponentSign = BM_EXPONENT_MINUS_CHAR;
 }
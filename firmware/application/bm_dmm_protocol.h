@@ -2,6 +2,7 @@
 #define BM_DMM_PROTOCOL_H_
 
 #include <stdint.h>
+#include "ramfunc.h"
 
 /// Data length inside packet which stores actual reading
 #define BM_NORMAL_PACKET_DATA_LENGTH 15
@@ -61,6 +62,24 @@ typedef struct {
     };
 } data_resp_pkt;
 
+/// Data length inside the timestamp packet
+#define BM_TIMESTAMP_PACKET_DATA_LENGTH 6
+
+/**
+ * Timestamp of the acquisition, sent after the data packet in the extended format. Data bytes are little endian: USB
+ * frame number (11 bits) of the last SOF before acquisition and the offset of acquisition from that SOF in ns
+ * (UINT32_MAX if unknown). Check sum is calculated the same way as in data packet.
+ */
+typedef struct {
+    data_resp_header        header;
+    uint8_t                 frameNo[2];
+    uint8_t                 offsetNs[4];
+    data_resp_tail          pktTail;
+} timestamp_resp_pkt;
+
+/// Length of the adapter specific packet with given length of data
+#define BM_ADAPTER_PKT_LEN(data_len) (sizeof(data_resp_header) + (data_len) + sizeof(data_resp_tail))
+
 typedef enum {
     BM_PKG_CREATED = 0,
     BM_RAW_DATA_LEN_TOO_SHORT,
@@ -69,6 +88,35 @@ typedef enum {
 /**
  * Converts raw data to UART package and returns pointer to converted
  */
-bm_result bm_create_pkt(const uint8_t* const pRawData, const uint8_t rawDataLen, data_resp_pkt* const pDestPkg);
+RAMFUNC bm_result bm_create_pkt(const uint8_t* const pRawData, const uint8_t rawDataLen,
+                                data_resp_pkt* const pDestPkg);
+
+/**
+ * Returns number of digits with unknown segments pattern (sent as empty) found by \ref bm_create_pkt since the last
+ * call. Not reentrant, call it from the same context as \ref bm_create_pkt.
+ */
+uint32_t bm_take_invalid_digits_no(void);
+
+/**
+ * Creates adapter specific packet of variable length: header, data and tail. Check sum is calculated the same way as in
+ * data packet.
+ * @param cmd value of 'command' field
+ * @param pData data bytes
+ * @param data_len number of data bytes
+ * @param pDest destination buffer
+ * @param dest_len length of the destination buffer
+ * @return length of the packet, 0 if it doesn't fit into the destination buffer
+ */
+uint16_t bm_create_adapter_pkt(const uint8_t cmd, const uint8_t* const pData, const uint8_t data_len,
+                               uint8_t* const pDest, const uint16_t dest_len);
+
+/**
+ * Creates timestamp packet.
+ * @param frame_no USB frame number
+ * @param offset_ns offset from the start of the frame in ns
+ * @param pDestPkg destination packet
+ */
+bm_result bm_create_timestamp_pkt(const uint16_t frame_no, const uint32_t offset_ns,
+                                  timestamp_resp_pkt* const pDestPkg);
 
 #endif // BM_DMM_PROTOCOL_H_
@@ -13,6 +13,26 @@
 #define BM_DATA_RESP_OV_COMMAND 0x01             // value of 'command' field when sending OverLimit packet
 
 
+/// Adapter specific commands (not a part of the Brymen protocol), see host_cmd.h for the frame layout:
+#define BM_ADAPTER_CMD_STREAM_START 0x40 // ARG0, ARG1: interval in ms (little endian), 0 means as fast as possible
+#define BM_ADAPTER_CMD_STREAM_STOP  0x41
+#define BM_ADAPTER_CMD_READ         0x42 // single acquisition, equivalent of the data request for the vendor interface
+#define BM_ADAPTER_CMD_EXT_FORMAT   0x43 // ARG0: 1 - each packet is followed by the timestamp packet, 0 - disabled
+#define BM_ADAPTER_CMD_CPU_STATS    0x44 // ARG0: 1 - reset figures after reading
+#define BM_ADAPTER_CMD_TRACE_DUMP   0x45 // ARG0: 1 - pause tracing during dump
+#define BM_ADAPTER_CMD_OP_STATS     0x46 // ARG0: 1 - reset statistics after reading
+#define BM_ADAPTER_CMD_LATENCY_HIST 0x47 // ARG0: 1 - reset histograms after reading
+#define BM_ADAPTER_CMD_RAW_FRAMES   0x48 // ARG0: 1 - each raw DMM frame is sent too, 0 - disabled
+
+/// Adapter specific response packets (not a part of the Brymen protocol), see bm_dmm_protocol.h:
+#define BM_ADAPTER_TIMESTAMP_COMMAND 0x50 // value of 'command' field of the timestamp packet
+#define BM_ADAPTER_CPU_STATS_COMMAND 0x51 // value of 'command' field of the CPU statistics packet
+#define BM_ADAPTER_TRACE_COMMAND     0x52 // value of 'command' field of the trace dump packet
+#define BM_ADAPTER_OP_STATS_COMMAND  0x53 // value of 'command' field of the operational statistics packet
+#define BM_ADAPTER_LATENCY_COMMAND   0x54 // value of 'command' field of the latency histogram packet
+#define BM_ADAPTER_RAW_FRAME_COMMAND 0x55 // value of 'command' field of the raw DMM frame packet
+
+
 /// Bits description inside frame's 'func' bytes
 #define BM_PROTO_SYM_AC (1 << 0)
 #define BM_PROTO_SYM_DC (1 << 1)
@@ -34,3 +34,9 @@ bool bsp_get_bt_state(void) {
     // todo software handling of debouncing is required while there is some hardware to handle this?
     return (0 != state) ? true : false;
 }
+
+
+
+void bsp_wait_for_interrupt(void) {
+    __asm__ volatile ("wfi");
+}
@@ -29,4 +29,9 @@ void bsp_led_toggle(void);
  */
 bool bsp_get_bt_state(void);
 
+/**
+ * Puts the core into sleep mode until the next interrupt occurs.
+ */
+void bsp_wait_for_interrupt(void);
+
 #endif //BSP_H_
@@ -12,22 +12,34 @@
  *  stored inside buffer if previous call was not complete and in current call there was missing request bytes.
  */
 uint8_t check_buffer_for_data_request(const uint8_t* const buff, const size_t size) {
+    static data_req_parser parser = {0};
+    return data_req_parser_check(&parser, buff, size);
+}
+
+void data_req_parser_init(data_req_parser* const parser) {
+    parser->state = 0;
+}
+
+uint8_t data_req_parser_check(data_req_parser* const parser, const uint8_t* const buff, const size_t size) {
     enum {STATES_NUM = 8};
     static const uint8_t statesTab[STATES_NUM] = {BM_DLE_CONST, BM_STX_CONST, BM_DATA_REQ_COMMAND, 0, 0, 0, BM_DLE_CONST, BM_ETX_CONST};
-    static uint8_t currState = 0;
+    // state to continue from when the byte doesn't match: matched bytes can end with the beginning of another request
+    // (the DLE before ETX), so e.g. a truncated request followed by a complete one is found
+    static const uint8_t fallbackTab[STATES_NUM] = {0, 0, 0, 0, 0, 0, 0, 1};
 
     uint8_t retval = 0;
 
-    if ((NULL != buff) && (size > 0)) {
+    if ((NULL != parser) && (NULL != buff) && (size > 0)) {
         for (size_t i = 0; i < size; ++i) {
-            if (statesTab[currState] == buff[i]) {
-                ++currState;
-                if (currState >= STATES_NUM) {
-                    currState = 0;
+            while ((parser->state > 0) && (statesTab[parser->state] != buff[i])) {
+                parser->state = fallbackTab[parser->state];
+            }
+            if (statesTab[parser->state] == buff[i]) {
+                ++parser->state;
+                if (parser->state >= STATES_NUM) {
+                    parser->state = 0;
                     ++retval;
                 }
-            } else {
-                currState = 0;
             }
         }
     }
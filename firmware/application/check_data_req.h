@@ -2,9 +2,24 @@
 #define CHECK_DATA_REQ_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
+/// State of the data request parser. Each source of requests has its own instance.
+typedef struct {
+    /// Number of request bytes matched so far
+    uint8_t state;
+} data_req_parser;
 
 uint8_t check_buffer_for_data_request(const uint8_t* const buff, const size_t size);
 
+/// Initializes the parser
+void data_req_parser_init(data_req_parser* const parser);
+
+/**
+ * Same as \ref check_buffer_for_data_request, but the state between calls is kept in given parser instead of the
+ * single shared one.
+ */
+uint8_t data_req_parser_check(data_req_parser* const parser, const uint8_t* const buff, const size_t size);
+
 
 #endif //CHECK_DATA_REQ_H_
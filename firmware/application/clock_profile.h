@@ -0,0 +1,36 @@
+#ifndef CLOCK_PROFILE_H_
+#define CLOCK_PROFILE_H_
+
+/**
+ * @file Clock profile: frequencies of the core and buses, all derived from the core clock SYSCLK_HZ (set by CPU_MHZ of
+ * the Makefile).
+ *
+ * Both profiles run the PLL from the 8 MHz external oscillator:
+ * - 48 MHz: flash with 1 wait state, USB clock is the PLL output
+ * - 72 MHz: flash with 2 wait states, USB clock is the PLL output divided by 1.5
+ * Constants of peripherals which depend on the clock (e.g. timers of ir_interface.c) are computed from these at
+ * compile time, so they follow the profile.
+ */
+
+/// Core clock in Hz
+#ifndef SYSCLK_HZ
+#define SYSCLK_HZ 48000000
+#endif
+
+#if (48000000 != SYSCLK_HZ) && (72000000 != SYSCLK_HZ)
+#error "Unsupported SYSCLK_HZ, 48000000 or 72000000 expected"
+#endif
+
+/// External oscillator
+#define HSE_HZ 8000000
+/// PLL multiplication factor of the external oscillator
+#define CLOCK_PLL_MUL (SYSCLK_HZ / HSE_HZ)
+
+/// AHB and APB2 run at the core clock, APB1 at its half (36 MHz at most)
+#define AHB_HZ  SYSCLK_HZ
+#define APB1_HZ (SYSCLK_HZ / 2)
+#define APB2_HZ SYSCLK_HZ
+/// Timers on APB1 (TIM2-TIM4) run at twice the APB1 clock when APB1 is divided
+#define TIM_APB1_HZ (2 * APB1_HZ)
+
+#endif // CLOCK_PROFILE_H_
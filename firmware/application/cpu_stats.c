@@ -0,0 +1,93 @@
+#include <string.h>
+#include "cpu_stats.h"
+#include "systick_local.h"
+
+#if 1 == CPU_STATS
+
+/*
+ * Sections are entered and left from all interrupts including the IR timer, which must never be masked. Updates are
+ * therefore lock-free: the nested cycles are swapped by compare-and-exchange (LDREX/STREX), which fails when some
+ * interrupt changed them meanwhile, and the section re-reads the time then. Cycles of each source are written only by
+ * its own priority level; the reader (main loop) repeats its copy when any section ended meanwhile.
+ */
+
+/// Cycles of completed sections nested in the current one
+static uint32_t nestedCycles = 0;
+/// Exclusive cycles of sources since start
+static uint64_t sourceCycles[CPU_STAT_SOURCES_NO];
+/// Incremented when some section ended, the reader detects concurrent updates by it
+static uint32_t updateSeq = 0;
+/// Cycles of sources and the time at the start of the measuring window, only the reader accesses them
+static uint64_t windowSourceCycles[CPU_STAT_SOURCES_NO];
+static uint64_t windowStart = 0;
+
+RAMFUNC void cpu_stats_enter(cpu_stats_ctx* const ctx) {
+    uint32_t nested = __atomic_load_n(&nestedCycles, __ATOMIC_RELAXED);
+    do {
+        ctx->start = st_get_cycles();
+        ctx->savedNested = nested;
+    } while (false == __atomic_compare_exchange_n(&nestedCycles, &nested, 0, true, __ATOMIC_RELAXED,
+                                                  __ATOMIC_RELAXED));
+}
+
+RAMFUNC void cpu_stats_leave(cpu_stats_ctx* const ctx, const cpu_stats_source src) {
+    uint32_t nested = __atomic_load_n(&nestedCycles, __ATOMIC_RELAXED);
+    uint32_t elapsed;
+    // whole section is nested in the one which it preempted
+    do {
+        elapsed = st_get_cycles() - ctx->start;
+    } while (false == __atomic_compare_exchange_n(&nestedCycles, &nested, ctx->savedNested + elapsed, true,
+                                                  __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+    sourceCycles[src] += elapsed - nested;
+    __atomic_fetch_add(&updateSeq, 1, __ATOMIC_RELEASE);
+}
+
+void cpu_stats_get(cpu_stats_snapshot* const snapshot, const bool reset) {
+    uint64_t cycles[CPU_STAT_SOURCES_NO];
+    uint64_t now;
+
+    uint32_t seq = __atomic_load_n(&updateSeq, __ATOMIC_ACQUIRE);
+    for (;;) {
+        now = st_get_cycles64();
+        memcpy(cycles, sourceCycles, sizeof(cycles));
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        const uint32_t seqAfter = __atomic_load_n(&updateSeq, __ATOMIC_ACQUIRE);
+        if (seqAfter == seq) {
+            break;
+        }
+        seq = seqAfter;
+    }
+
+    const uint64_t window = now - windowStart;
+    for (int src = 0; src < CPU_STAT_SOURCES_NO; ++src) {
+        const uint64_t total = cycles[src];
+        cycles[src] -= windowSourceCycles[src];
+        if (true == reset) {
+            windowSourceCycles[src] = total;
+        }
+    }
+    if (true == reset) {
+        windowStart = now;
+    }
+
+    uint64_t measured = 0;
+    for (int src = 0; src < CPU_STAT_OTHER; ++src) {
+        measured += cycles[src];
+    }
+    cycles[CPU_STAT_OTHER] = (window > measured) ? (window - measured) : 0;
+
+    snapshot->window_us = (uint32_t)st_cycles_to_us(window);
+    for (int src = 0; src < CPU_STAT_SOURCES_NO; ++src) {
+        snapshot->sources[src].time_us = (uint32_t)st_cycles_to_us(cycles[src]);
+        snapshot->sources[src].load = (window > 0) ? (uint16_t)((cycles[src] * 10000) / window) : 0;
+    }
+}
+
+#else
+
+void cpu_stats_get(cpu_stats_snapshot* const snapshot, const bool reset) {
+    (void)reset;
+    memset(snapshot, 0, sizeof(cpu_stats_snapshot));
+}
+
+#endif // CPU_STATS
@@ -0,0 +1,87 @@
+#ifndef CPU_STATS_H_
+#define CPU_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "ramfunc.h"
+
+/**
+ * @file Accounting of CPU time per source (interrupts, selected functions, idle) with the core cycles of
+ * systick_local.h.
+ *
+ * Each measured section is enclosed by \ref cpu_stats_enter and \ref cpu_stats_leave. Time of nested sections (e.g.
+ * interrupt which preempts other one) is subtracted from the outer section, so figures are exclusive. Time not covered
+ * by any section is reported as CPU_STAT_OTHER. Stacking of registers on interrupt entry is not measured.
+ * CPU_STAT_IDLE is measured around WFI directly: the cycles are derived from SysTick, which keeps counting in sleep
+ * (DWT CYCCNT stops there).
+ */
+
+/// Set to 0 to remove the accounting from the build
+#ifndef CPU_STATS
+#define CPU_STATS 1
+#endif
+
+/// Measured sources
+typedef enum {
+    CPU_STAT_TIM2 = 0,      ///< tim2_isr: DMM clock and data sampling
+    CPU_STAT_EXTI4,         ///< exti4_isr: DMM ready
+    CPU_STAT_SYSTICK,       ///< sys_tick_handler
+    CPU_STAT_USB,           ///< USB interrupts
+    CPU_STAT_BM_CREATE_PKT, ///< conversion of raw data to Brymen packet
+    CPU_STAT_IDLE,          ///< core sleeping in WFI
+    CPU_STAT_OTHER,         ///< the rest, mostly the main loop
+    CPU_STAT_SOURCES_NO
+} cpu_stats_source;
+
+/// State of the measured section, usually a local variable of the measured function
+typedef struct {
+    uint32_t start;
+    uint32_t savedNested;
+} cpu_stats_ctx;
+
+/// Figures of one source
+typedef struct {
+    /// Time spent in the source in us
+    uint32_t time_us;
+    /// Share of the source in the window in 0.01 %
+    uint16_t load;
+} cpu_stats_figure;
+
+/// Figures of all sources since the last reset
+typedef struct {
+    /// Length of the measuring window in us
+    uint32_t         window_us;
+    cpu_stats_figure sources[CPU_STAT_SOURCES_NO];
+} cpu_stats_snapshot;
+
+#if 1 == CPU_STATS
+
+/// Starts the measured section. Can be called from any interrupt.
+RAMFUNC void cpu_stats_enter(cpu_stats_ctx* const ctx);
+
+/// Ends the measured section and accounts its time to given source.
+RAMFUNC void cpu_stats_leave(cpu_stats_ctx* const ctx, const cpu_stats_source src);
+
+/**
+ * Returns figures since the last reset. Must be called from the main loop only.
+ * @param[out] snapshot figures
+ * @param reset if true, the next window starts now
+ */
+void cpu_stats_get(cpu_stats_snapshot* const snapshot, const bool reset);
+
+#else
+
+static inline void cpu_stats_enter(cpu_stats_ctx* const ctx) {
+    (void)ctx;
+}
+
+static inline void cpu_stats_leave(cpu_stats_ctx* const ctx, const cpu_stats_source src) {
+    (void)ctx;
+    (void)src;
+}
+
+void cpu_stats_get(cpu_stats_snapshot* const snapshot, const bool reset);
+
+#endif // CPU_STATS
+
+#endif //CPU_STATS_H_
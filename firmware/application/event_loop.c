@@ -0,0 +1,51 @@
+#include <stddef.h>
+#include "event_loop.h"
+
+/// Bit mask of pending events, bit number is \ref event_id
+static volatile uint32_t pendingEvents = 0;
+/// Handlers of events
+static event_handler handlers[EVENT_NO];
+/// Numbers of dispatches of events
+static uint32_t dispatchCounts[EVENT_NO];
+
+bool event_loop_register(const event_id ev, event_handler handler) {
+    bool retval = false;
+    if (ev < EVENT_NO) {
+        handlers[ev] = handler;
+        retval = true;
+    }
+    return retval;
+}
+
+void event_post(const event_id ev) {
+    if (ev < EVENT_NO) {
+        __atomic_fetch_or(&pendingEvents, (uint32_t)1 << ev, __ATOMIC_RELAXED);
+    }
+}
+
+uint8_t event_loop_dispatch(void) {
+    uint8_t retval = 0;
+    // take all pending events at once, events posted during dispatching wait for the next call
+    uint32_t events = __atomic_exchange_n(&pendingEvents, 0, __ATOMIC_RELAXED);
+
+    for (int ev = 0; (ev < EVENT_NO) && (0 != events); ++ev) {
+        const uint32_t evBit = (uint32_t)1 << ev;
+        if (0 != (events & evBit)) {
+            events &= ~evBit;
+            ++retval;
+            ++dispatchCounts[ev];
+            if (NULL != handlers[ev]) {
+                handlers[ev]();
+            }
+        }
+    }
+    return retval;
+}
+
+uint32_t event_loop_get_dispatch_count(const event_id ev) {
+    return (ev < EVENT_NO) ? dispatchCounts[ev] : 0;
+}
+
+bool event_loop_is_idle(void) {
+    return (0 == pendingEvents);
+}
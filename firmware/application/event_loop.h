@@ -0,0 +1,56 @@
+#ifndef EVENT_LOOP_H_
+#define EVENT_LOOP_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file Event driven cooperative scheduler.
+ *
+ * Interrupts post events, the main loop dispatches them by calling registered handlers. Each handler runs to completion
+ * in the thread mode, so handlers don't need to protect data shared only between them. Pending events are stored as
+ * bits, so posting the same event several times before dispatch results in single call of its handler.
+ */
+
+/// Identifiers of events. Lower identifier means the handler is called earlier during dispatching.
+typedef enum {
+    EVENT_SOFT_TIMER = 0,   ///< SysTick ticked, software timers need to be polled
+    EVENT_HOST_CMD,         ///< adapter specific command received from host
+    EVENT_IR_END,           ///< transaction of IR interface ended, successfully or not
+    EVENT_ACQ_REQ,          ///< acquisition of data from DMM was requested
+    EVENT_PT_WAKEUP,        ///< time awaited by some coroutine elapsed, see pt.h
+    EVENT_NO                ///< number of events, must not exceed 32
+} event_id;
+
+/// Type of function called when event is dispatched
+typedef void (*event_handler)(void);
+
+/**
+ * Registers handler of the event. Handler registered earlier is replaced.
+ * @return false if event identifier is invalid
+ */
+bool event_loop_register(const event_id ev, event_handler handler);
+
+/**
+ * Marks the event as pending. Can be called from any interrupt.
+ */
+void event_post(const event_id ev);
+
+/**
+ * Calls handlers of all events pending at the moment of call. Events posted by handlers are dispatched in next call.
+ * @return number of dispatched events
+ */
+uint8_t event_loop_dispatch(void);
+
+/**
+ * Returns number of dispatches of the event, it wraps around.
+ */
+uint32_t event_loop_get_dispatch_count(const event_id ev);
+
+/**
+ * Checks if there is no pending event. To not miss any event it must be called with interrupts masked just before
+ * going to sleep.
+ */
+bool event_loop_is_idle(void);
+
+#endif //EVENT_LOOP_H_
@@ -0,0 +1,60 @@
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include "host_cmd.h"
+#include "bm_protocol_defs.h"
+
+/// Positions of bytes inside the command frame
+enum {
+    FRAME_DLE_S = 0,
+    FRAME_STX,
+    FRAME_CMD,
+    FRAME_ARG0,
+    FRAME_ARG1,
+    FRAME_CHKSUM,
+    FRAME_DLE_E,
+    FRAME_ETX,
+    FRAME_LEN
+};
+
+/// Checks if given window of received bytes stores a valid command frame
+static bool is_valid_cmd_frame(const uint8_t* const frame) {
+    return (BM_DLE_CONST == frame[FRAME_DLE_S]) &&
+           (BM_STX_CONST == frame[FRAME_STX]) &&
+           (BM_DATA_REQ_COMMAND != frame[FRAME_CMD]) &&
+           ((frame[FRAME_CMD] ^ frame[FRAME_ARG0] ^ frame[FRAME_ARG1]) == frame[FRAME_CHKSUM]) &&
+           (BM_DLE_CONST == frame[FRAME_DLE_E]) &&
+           (BM_ETX_CONST == frame[FRAME_ETX]);
+}
+
+void host_cmd_parser_init(host_cmd_parser* const parser, const uint8_t source) {
+    memset(parser->window, 0, HOST_CMD_FRAME_LEN);
+    parser->source = source;
+}
+
+/**
+ * Received bytes are shifted through the window of frame's length, so the parser synchronizes to the frame which
+ * starts inside previously broken one.
+ */
+uint8_t check_buffer_for_host_cmd(host_cmd_parser* const parser, const uint8_t* const buff, const size_t size,
+                                  host_cmd_callback callback) {
+    uint8_t retval = 0;
+
+    if ((NULL != parser) && (NULL != buff) && (size > 0)) {
+        uint8_t* const window = parser->window;
+        for (size_t i = 0; i < size; ++i) {
+            memmove(&window[0], &window[1], FRAME_LEN - 1);
+            window[FRAME_LEN - 1] = buff[i];
+
+            if (true == is_valid_cmd_frame(window)) {
+                ++retval;
+                if (NULL != callback) {
+                    callback(parser->source, window[FRAME_CMD], window[FRAME_ARG0], window[FRAME_ARG1]);
+                }
+                // bytes of matched frame can not be a part of the next one
+                memset(window, 0, FRAME_LEN);
+            }
+        }
+    }
+    return retval;
+}
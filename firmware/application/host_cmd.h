@@ -0,0 +1,49 @@
+#ifndef HOST_CMD_H_
+#define HOST_CMD_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @file Parser of adapter specific commands sent by the host.
+ *
+ * Commands use the same frame layout as the Brymen data request: DLE STX CMD ARG0 ARG1 CHKSUM DLE ETX, where
+ * CHKSUM = CMD ^ ARG0 ^ ARG1. The data request itself (CMD = BM_DATA_REQ_COMMAND) is not reported by this parser, it is
+ * handled by \ref check_buffer_for_data_request.
+ */
+
+/// Length of the command frame in bytes
+#define HOST_CMD_FRAME_LEN 8
+
+/// State of the parser. Each source of commands (USB interface) has its own instance.
+typedef struct {
+    /// The last received bytes
+    uint8_t window[HOST_CMD_FRAME_LEN];
+    /// Identifier of the source of commands, passed to the callback
+    uint8_t source;
+} host_cmd_parser;
+
+/// Type of function called for each valid command frame found in received bytes.
+typedef void (*host_cmd_callback)(const uint8_t source, const uint8_t cmd, const uint8_t arg0, const uint8_t arg1);
+
+/**
+ * Initializes the parser.
+ *
+ * @param parser parser to initialize
+ * @param source identifier of the source of commands, it is passed to the callback
+ */
+void host_cmd_parser_init(host_cmd_parser* const parser, const uint8_t source);
+
+/**
+ * Checks received bytes for valid command frames. Parser stores the state between calls, so frame can come in parts.
+ *
+ * @param parser state of the parser, see \ref host_cmd_parser_init
+ * @param buff pointer to the buffer where received bytes are storing
+ * @param size number of bytes inside buffer
+ * @param callback function called for each matched command, can be NULL
+ * @return number of matched commands in this function call
+ */
+uint8_t check_buffer_for_host_cmd(host_cmd_parser* const parser, const uint8_t* const buff, const size_t size,
+                                  host_cmd_callback callback);
+
+#endif //HOST_CMD_H_
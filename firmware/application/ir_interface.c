@@ -7,6 +7,11 @@
 #include "ir_interface.h"
 #include "systick_local.h"
 #include "soft_timer.h"
+#include "irq_prio.h"
+#include "cpu_stats.h"
+#include "trace.h"
+#include "ramfunc.h"
+#include "clock_profile.h"
 
 #if INTERFACE_VER1 == USING_INTERFACE_VER
 
@@ -59,28 +64,45 @@
 /**
  * Timer's registers configuration values which are using to generate 10ms-long level on the output pin.
  *
- * These values were counted with assumptions:
- * - frequency of the internal timer's clock: 48 MHz
+ * These values are computed from the timer's clock TIM_APB1_HZ (see clock_profile.h) with assumptions:
+ * - timer ticks at TIM_PULSE_GEN_TICK_HZ, slow enough to count the pulse in 16 bits
  * - runs in pwm - mode 1
  * - required high level time - 10ms
  * - period as short as possible (high level time plus something small to get integer value)
 */
-#define TIM_PULSE_GEN_PRESCALER 7999
-#define TIM_PULSE_GEN_OCCR      60
-#define TIM_PULSE_GEN_ARR       65
+#define TIM_PULSE_GEN_TICK_HZ   6000
+#define TIM_PULSE_GEN_HIGH_US   10000
+#define TIM_PULSE_GEN_PRESCALER (TIM_APB1_HZ / TIM_PULSE_GEN_TICK_HZ - 1)
+#define TIM_PULSE_GEN_OCCR      (TIM_PULSE_GEN_HIGH_US * (TIM_PULSE_GEN_TICK_HZ / 1000) / 1000)
+#define TIM_PULSE_GEN_ARR       (TIM_PULSE_GEN_OCCR + 5)
 
 /**
  * Timer's registers configuration values which are using to generate 'clk' signal on the output pin.
  *
- * These value were counted with assumptions:
- * - frequency of the internal timer's clock: 48 MHz
+ * These values are computed from the timer's clock TIM_APB1_HZ (see clock_profile.h) with assumptions:
+ * - bit rate of the DMM clock: DMM_CLK_HZ, timer ticks at TIM_CLK_GEN_TICK_HZ
  * - runs in pwm - mode 1
  * - duty: 50%
  * - th = tl = not less than 2us
  */
-#define TIM_CLK_GEN_PRESCALER   39
-#define TIM_CLK_GEN_OCCR        100
-#define TIM_CLK_GEN_ARR         199
+#define DMM_CLK_HZ              6000
+#define TIM_CLK_GEN_TICK_HZ     1200000
+#define TIM_CLK_GEN_PRESCALER   (TIM_APB1_HZ / TIM_CLK_GEN_TICK_HZ - 1)
+#define TIM_CLK_GEN_ARR         (TIM_CLK_GEN_TICK_HZ / DMM_CLK_HZ - 1)
+#define TIM_CLK_GEN_OCCR        ((TIM_CLK_GEN_ARR + 1) / 2)
+
+// a clock profile which doesn't divide exactly would silently change the IR timing
+#if (0 != (TIM_APB1_HZ % TIM_PULSE_GEN_TICK_HZ)) || (0 != (TIM_APB1_HZ % TIM_CLK_GEN_TICK_HZ)) || \
+    (0 != (TIM_CLK_GEN_TICK_HZ % DMM_CLK_HZ))
+#error "Timer clock isn't a multiple of the IR timer ticks"
+#endif
+#if (TIM_PULSE_GEN_PRESCALER > 0xFFFF) || (TIM_PULSE_GEN_ARR > 0xFFFF) || \
+    (TIM_CLK_GEN_PRESCALER > 0xFFFF) || (TIM_CLK_GEN_ARR > 0xFFFF)
+#error "IR timer values don't fit into 16 bits registers"
+#endif
+#if (TIM_CLK_GEN_OCCR * 1000000 / TIM_CLK_GEN_TICK_HZ) < 2
+#error "DMM clock levels are shorter than 2 us"
+#endif
 
 
 /// Defines offset of the Input Data Register (IDR) from the GPIO base address.
@@ -124,6 +146,14 @@ static volatile sig_atomic_t dmmCommState = IR_ITF_READY;
 /// Software timer that is using together with nonblocking API and acts as the timeout when waiting for reponse from
 /// the DMM.
 static soft_timer_descr softTimer;
+/// Is set while the timer generates the start impulse, its compare match is the end of the impulse then
+static volatile bool startPulseOn = false;
+/// Called at the end of the start impulse
+static volatile ir_itf_callback pulseEndCallback = NULL;
+/// Called when DMM is ready to transmit
+static volatile ir_itf_callback dmmReadyCallback = NULL;
+/// Called when read transaction ends
+static volatile ir_itf_callback endCallback = NULL;
 
 
 void ir_itf_init_blocking(void) {
@@ -211,6 +241,10 @@ void ir_itf_init_nb(void) {
 
     timer_reset(USED_TIMER_PERIPH);
 
+    // sampling of data bits must not be delayed by other interrupts
+    nvic_set_priority(USED_TIMER_NVIC_IRQ, IRQ_PRIO_IR_TIMER);
+    nvic_set_priority(USED_EXTI_NVIC_IRQ, IRQ_PRIO_IR_EXTI);
+
     // maps bit vale of DATA_IN pin to variable (bit banding)
     dataInBit = &BBIO_PERIPH((GPIO_IDR_ADDR(GPIO_PORT)), GPIO_DATA_IN_PIN_NO);
 }
@@ -287,6 +321,11 @@ static void ir_itf_generate_start_pulse(void) {
     timer_generate_event(USED_TIMER_PERIPH, TIM_EGR_UG);
     // clearing all flags in status register (clear on write '0')
     timer_clear_flag(USED_TIMER_PERIPH, TIM_SR_ALL_INT_FLAGS);
+    // compare match ends the impulse, its interrupt captures the moment
+    startPulseOn = true;
+    timer_enable_irq(USED_TIMER_PERIPH, USED_TIMER_DIER_CCIE);
+    nvic_clear_pending_irq(USED_TIMER_NVIC_IRQ);
+    nvic_enable_irq(USED_TIMER_NVIC_IRQ);
 
     timer_enable_counter(USED_TIMER_PERIPH);
 
@@ -298,6 +337,7 @@ static void ir_itf_generate_start_pulse(void) {
 
     // configure exti on DATA INPUT pin on rising edge -> this will be an event when DMM is ready to transmit data
     configure_exti_for_data_ready_signal();
+    TRACE(TRACE_IR_START_PULSE, 0);
 }
 
 
@@ -305,8 +345,18 @@ static void ir_itf_generate_start_pulse(void) {
  * On each compare match only when generating CLK signal. This interrupt represents the falling edge of clock which
  * is also a data sampling edge.
  */
-__attribute__((interrupt)) void tim2_isr(void) {
-    if (true == timer_interrupt_source(USED_TIMER_PERIPH, TIM_SR_CC2IF)) { // Falling edge of CLK signal -> edge of sampling
+RAMFUNC_ISR __attribute__((interrupt)) void tim2_isr(void) {
+    cpu_stats_ctx stats;
+    cpu_stats_enter(&stats);
+
+    if (true == startPulseOn) { // End of the start impulse
+        startPulseOn = false;
+        timer_clear_flag(USED_TIMER_PERIPH, TIM_SR_CC2IF);
+        timer_disable_irq(USED_TIMER_PERIPH, USED_TIMER_DIER_CCIE);
+        if (NULL != pulseEndCallback) {
+            pulseEndCallback();
+        }
+    } else if (true == timer_interrupt_source(USED_TIMER_PERIPH, TIM_SR_CC2IF)) { // Falling edge of CLK signal -> edge of sampling
         timer_clear_flag(USED_TIMER_PERIPH, TIM_SR_CC2IF);
         //
         // Note about assumption: byteNo and bitNo must be set to 0 prior first interrupt occur
@@ -324,6 +374,7 @@ __attribute__((interrupt)) void tim2_isr(void) {
         ++bitNo;
         if (bitNo >= 8) {
             bitNo = 0;
+            TRACE(TRACE_IR_BYTE, byteNo);
             ++byteNo;
             // check if that was a last byte
             if (byteNo >= IR_DATA_BYTES) {
@@ -337,16 +388,28 @@ __attribute__((interrupt)) void tim2_isr(void) {
                 nvic_clear_pending_irq(USED_TIMER_NVIC_IRQ);
 
                 dmmCommState = IR_ITF_DONE;
+                if (NULL != endCallback) {
+                    endCallback();
+                }
             }
         }
     } // TIM_SR_CC2IF
+
+    cpu_stats_leave(&stats, CPU_STAT_TIM2);
 } // tim2_isr()
 
 
 /**
  * Interrupt occurs when DMM indicates (by turning its IR LED on) when it is read to transmit data.
  */
-__attribute__((interrupt)) void exti4_isr(void) {
+RAMFUNC_ISR __attribute__((interrupt)) void exti4_isr(void) {
+    cpu_stats_ctx stats;
+    cpu_stats_enter(&stats);
+
+    TRACE(TRACE_IR_DMM_READY, 0);
+    if (NULL != dmmReadyCallback) {
+        dmmReadyCallback();
+    }
     softTimer.terminating_req = 1; // request to abort the timer
     exti_reset_request(USED_EXTI_SOURCE);
     // disable exti
@@ -358,6 +421,7 @@ __attribute__((interrupt)) void exti4_isr(void) {
     // data will be read on falling edge
     timer_disable_counter(USED_TIMER_PERIPH);
     nvic_disable_irq(USED_TIMER_NVIC_IRQ);
+    startPulseOn = false;
 
     timer_set_prescaler(USED_TIMER_PERIPH, TIM_CLK_GEN_PRESCALER);
     timer_set_period(USED_TIMER_PERIPH, TIM_CLK_GEN_ARR);
@@ -376,11 +440,14 @@ __attribute__((interrupt)) void exti4_isr(void) {
 
     // start counting
     timer_enable_counter(USED_TIMER_PERIPH);
+
+    cpu_stats_leave(&stats, CPU_STAT_EXTI4);
 } // exti4_isr()
 
 static void dmm_not_responding_soft_timer_callback(void) {
     if (IR_ITF_WAITING_FOR_DMM == dmmCommState) {
         // timed out -> dmm didn't respond in requested time. Reset to ready state.
+        TRACE(TRACE_IR_TIMEOUT, 0);
         // - disable EXIT
         nvic_disable_irq(USED_EXTI_NVIC_IRQ);
         exti_reset_request(USED_EXTI_SOURCE);
@@ -392,6 +459,20 @@ static void dmm_not_responding_soft_timer_callback(void) {
         timer_disable_counter(USED_TIMER_PERIPH);
 
         dmmCommState = IR_ITF_READY;
+        if (NULL != endCallback) {
+            endCallback();
+        }
     }
 }
 
+void ir_itf_register_pulse_end_callback(ir_itf_callback callback) {
+    pulseEndCallback = callback;
+}
+
+void ir_itf_register_dmm_ready_callback(ir_itf_callback callback) {
+    dmmReadyCallback = callback;
+}
+
+void ir_itf_register_end_callback(ir_itf_callback callback) {
+    endCallback = callback;
+}
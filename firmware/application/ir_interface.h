@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
+#include "pt.h"
 
 /// Length of buffer (in bytes) required to store data read with IR interface
 #define IR_DATA_BYTES 16
@@ -61,5 +62,35 @@ void ir_itf_start_read_nb(uint8_t* const buffer, const size_t len);
 // todo something to check status and check if can start reading data from the DMM.
 ir_itf_state_type ir_itf_get_status(void);
 
+/// Type of function called by IR interface on its events
+typedef void (*ir_itf_callback)(void);
+
+/**
+ * Waits inside the coroutine until non-blocking read started by \ref ir_itf_start_read_nb ends. Coroutine must be
+ * resumed on EVENT_IR_END, see \ref ir_itf_register_end_callback.
+ *
+ * @param pt context of the coroutine
+ * @param status variable which is set to the final state: \ref IR_ITF_DONE or \ref IR_ITF_READY if DMM didn't respond
+ */
+#define PT_AWAIT_IR_DONE(pt, status) PT_WAIT_UNTIL((pt), IR_ITF_WORKING != ((status) = ir_itf_get_status()))
+
+/**
+ * Registers function called inside the interrupt when DMM signals that it is ready to transmit, that is at the moment
+ * of acquisition. Can be NULL to unregister.
+ */
+void ir_itf_register_dmm_ready_callback(ir_itf_callback callback);
+
+/**
+ * Registers function called inside the interrupt at the end of the start impulse, which the timer generates by itself.
+ * Can be NULL to unregister.
+ */
+void ir_itf_register_pulse_end_callback(ir_itf_callback callback);
+
+/**
+ * Registers function called when read transaction ends: data are read (state is \ref IR_ITF_DONE) or DMM didn't respond
+ * (state is \ref IR_ITF_READY again). It can be called inside the interrupt. Can be NULL to unregister.
+ */
+void ir_itf_register_end_callback(ir_itf_callback callback);
+
 
 #endif //IR_INTERFACE_H_
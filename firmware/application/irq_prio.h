@@ -0,0 +1,45 @@
+#ifndef IRQ_PRIO_H_
+#define IRQ_PRIO_H_
+
+#include <stdint.h>
+
+/**
+ * @file Priorities of used interrupts.
+ *
+ * STM32F1 implements 4 upper bits of the priority field and all of them are used as the preemption priority. Lower value
+ * means higher priority. Sampling of the DMM's data can not be delayed by anything else, USB is serviced at the lowest
+ * priority because host tolerates the latency of a few microseconds.
+ */
+
+/// Timer which generates clock for the DMM and samples data bits
+#define IRQ_PRIO_IR_TIMER   (0 << 4)
+/// EXTI which detects the DMM readiness to transmit
+#define IRQ_PRIO_IR_EXTI    (1 << 4)
+/// SysTick which counts local ticks
+#define IRQ_PRIO_SYSTICK    (2 << 4)
+/// USB low priority interrupt which services whole USB device
+#define IRQ_PRIO_USB        (3 << 4)
+
+#if defined(__arm__)
+/**
+ * Masks interrupts of priority prio and lower by BASEPRI, interrupts of higher priority still preempt. BASEPRI is only
+ * raised (BASEPRI_MAX), so the call nests into sections which mask more. Returns previous BASEPRI for \ref irq_unmask.
+ */
+static inline uint32_t irq_mask_from(const uint32_t prio) {
+    uint32_t basepri;
+    __asm__ volatile ("mrs %0, basepri" : "=r" (basepri));
+    __asm__ volatile ("msr basepri_max, %0" : : "r" (prio) : "memory");
+    return basepri;
+}
+
+/// Restores BASEPRI returned by \ref irq_mask_from
+static inline void irq_unmask(const uint32_t basepri) {
+    __asm__ volatile ("msr basepri, %0" : : "r" (basepri) : "memory");
+}
+#else
+/// Host builds implement masking by priority in their model of NVIC
+uint32_t irq_mask_from(const uint32_t prio);
+void irq_unmask(const uint32_t basepri);
+#endif
+
+#endif //IRQ_PRIO_H_
@@ -0,0 +1,36 @@
+#include <stddef.h>
+#include <string.h>
+#include "latency_hist.h"
+
+uint8_t latency_hist_bin(const uint32_t duration_us) {
+    if (duration_us < 2) {
+        return 0;
+    }
+
+    // position of the most significant bit
+    const uint8_t bin = (uint8_t)(31 - __builtin_clz(duration_us));
+    return (bin < LATENCY_HIST_BINS) ? bin : (LATENCY_HIST_BINS - 1);
+}
+
+void latency_hist_add(latency_hist* const hist, const uint32_t duration_us) {
+    if (NULL == hist) {
+        return;
+    }
+
+    uint32_t* const bin = &hist->bins[latency_hist_bin(duration_us)];
+    if (*bin < UINT32_MAX) {
+        ++(*bin);
+    }
+    if (hist->samples < UINT32_MAX) {
+        ++hist->samples;
+    }
+    if (duration_us > hist->max_us) {
+        hist->max_us = duration_us;
+    }
+}
+
+void latency_hist_reset(latency_hist* const hist) {
+    if (NULL != hist) {
+        memset(hist, 0, sizeof(latency_hist));
+    }
+}
@@ -0,0 +1,34 @@
+#ifndef LATENCY_HIST_H_
+#define LATENCY_HIST_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file Histogram of durations with logarithmic bins.
+ *
+ * Bin 0 counts durations shorter than 2 us, bin n (n > 0) counts durations from 2^n us to 2^(n+1) - 1 us. The last bin
+ * counts also all longer durations. Counts saturate at UINT32_MAX.
+ */
+
+/// Number of bins, the last one starts at 2^21 us (~2.1 s)
+#define LATENCY_HIST_BINS 22
+
+typedef struct {
+    uint32_t bins[LATENCY_HIST_BINS];
+    /// Number of added samples
+    uint32_t samples;
+    /// The longest added duration in us
+    uint32_t max_us;
+} latency_hist;
+
+/// Returns index of the bin which counts given duration
+uint8_t latency_hist_bin(const uint32_t duration_us);
+
+/// Adds sample to the histogram
+void latency_hist_add(latency_hist* const hist, const uint32_t duration_us);
+
+/// Clears the histogram
+void latency_hist_reset(latency_hist* const hist);
+
+#endif // LATENCY_HIST_H_
@@ -25,6 +25,7 @@
 #include <libopencm3/usb/usbd.h>
 #include <libopencm3/cm3/nvic.h>
 #include <libopencm3/cm3/systick.h>
+#include <libopencm3/cm3/cortex.h>
 #include <libopencm3/stm32/flash.h>
 
 #include "usb_cdc_dev.h"
@@ -34,6 +35,16 @@
 #include "ir_interface.h"
 #include "bm_dmm_protocol.h"
 #include "check_data_req.h"
+#include "host_cmd.h"
+#include "event_loop.h"
+#include "cpu_stats.h"
+#include "trace.h"
+#include "op_stats.h"
+#include "latency_hist.h"
+#include "bm_protocol_defs.h"
+#include "clock_profile.h"
+#include "irq_prio.h"
+#include "ramfunc.h"
 
 #define FAKE_RESPONSE 0
 #if 1 == FAKE_RESPONSE
@@ -50,26 +61,821 @@ static const data_resp_pkt example_voltageReading1 = {
 #endif
 
 
-/// Number of data requests received from host
-static int dataRequestNo = 0;
+/// Number of data requests received from host on each USB channel. It is incremented inside the USB interrupt.
+static volatile int dataRequestNo[USB_CH_NO] = {0};
+/// Core cycle counter at the arrival of the oldest pending data request of each USB channel
+static volatile uint32_t requestCycles[USB_CH_NO] = {0};
+/// Core cycle counter at the arrival of data requests served by the current acquisition, per USB channel
+static uint32_t acqRequestCycles[USB_CH_NO] = {0};
+/// Bit mask of USB channels whose data request is served by the current acquisition
+static uint8_t acqRequestChannels = 0;
+/// Parsers of adapter specific commands, one per USB channel
+static host_cmd_parser hostCmdParsers[USB_CH_NO];
+/// Is set to true for USB channels which requested the extended format (each packet is followed by its timestamp)
+static volatile bool extFormat[USB_CH_NO] = {false};
 
-/// Callback function called when received some data by USB-CDC protocol
-static void cdcacm_rx_callback(usbd_device *usbd_dev, uint8_t ep) {
-    (void)ep;
+/// Phases of serving the data request, duration of each one is collected in the histogram
+typedef enum {
+    LAT_PHASE_QUEUE = 0,    ///< request received -> reading of DMM started
+    LAT_PHASE_START_PULSE,  ///< reading started -> end of the start impulse
+    LAT_PHASE_DMM_WAKE,     ///< end of the start impulse -> DMM ready to transmit
+    LAT_PHASE_CLOCK_IN,     ///< DMM ready -> last bit read
+    LAT_PHASE_DECODE,       ///< last bit read -> packet built
+    LAT_PHASE_USB,          ///< packet built -> packet accepted by the endpoint
+    LAT_PHASES_NO
+} latency_phase;
+
+/// Core cycle counter at phase boundaries of the data request waiting for its packet to be accepted by the endpoint
+typedef struct {
+    uint32_t    requestCycles;
+    uint32_t    startCycles;
+    uint32_t    pulseEndCycles;
+    uint32_t    readyCycles;
+    uint32_t    doneCycles;
+    uint32_t    builtCycles;
+    /// Number of bytes committed to the TX ring buffer including the packet, see \ref usb_cdc_get_tx_committed_bytes
+    uint32_t    txMark;
+    bool        armed;
+} request_timeline;
+
+/// Timelines of the last served data request of each USB channel, shared with the USB interrupt
+static request_timeline timelines[USB_CH_NO];
+/// Histograms of durations of phases, shared with the USB interrupt
+static latency_hist phaseHists[LAT_PHASES_NO];
+
+/// Core cycle counter at the start of the current acquisition, at the end of the start impulse, when DMM is ready and
+/// when the last bit is read
+static volatile struct {
+    uint32_t    startCycles;
+    uint32_t    pulseEndCycles;
+    uint32_t    readyCycles;
+    uint32_t    doneCycles;
+} acqCycles;
+
+/// Position of the last acquisition on the USB bus timeline, captured when DMM starts transmitting
+static volatile struct {
+    uint16_t    frameNo;
+    uint32_t    offsetCycles;
+    bool        valid;
+} acqTimestamp;
+
+/// Is set to true when adapter acquires data by itself and pushes each packet to the host (streaming mode)
+static bool streamingOn = false;
+/// Interval of acquisitions in streaming mode in ms, 0 means acquiring as fast as possible
+static uint16_t streamIntervalMs = 0;
+/// USB channel which packets acquired in streaming mode are pushed to
+static usb_channel streamChannel = USB_CH_CDC;
+/// Is set by the streaming timer when next acquisition should be started
+static volatile sig_atomic_t streamAcqPending = 0;
+/// Continuous software timer that paces acquisitions in streaming mode
+static soft_timer_descr streamTimer;
+/// Number of stream commands which can wait for the main loop, must be power of 2
+#define STREAM_CMD_QUEUE_LEN 4
+/// Stream commands received inside the USB interrupt, waiting to be applied in the main loop in order of arrival
+static volatile struct {
+    uint8_t     cmd;
+    uint8_t     channel;
+    uint16_t    arg;
+} streamCmds[STREAM_CMD_QUEUE_LEN];
+/// Number of stream commands queued since start, written by the USB interrupt only
+static volatile uint8_t streamCmdsIn = 0;
+/// Number of stream commands taken by the main loop since start
+static volatile uint8_t streamCmdsOut = 0;
+
+/// Callback of the streaming timer, requests next acquisition
+static void stream_soft_timer_callback(void) {
+    streamAcqPending = 1;
+    event_post(EVENT_ACQ_REQ);
+}
+
+/**
+ * Enables streaming mode.
+ * @param ch USB channel which acquired packets will be pushed to
+ * @param interval_ms interval of acquisitions in ms, 0 means acquiring as fast as possible
+ */
+static void stream_start(const usb_channel ch, const uint16_t interval_ms) {
+    streamChannel = ch;
+    streamIntervalMs = interval_ms;
+    streamAcqPending = 1; // first acquisition right away
+    streamingOn = true;
+
+    if (interval_ms > 0) {
+        if (false == soft_timer_start_continuous(&streamTimer, interval_ms, stream_soft_timer_callback)) {
+            streamingOn = false;
+        }
+    } else {
+        soft_timer_cancel(&streamTimer);
+    }
+}
+
+/// Disables streaming mode
+static void stream_stop(void) {
+    streamingOn = false;
+    streamAcqPending = 0;
+    soft_timer_cancel(&streamTimer);
+}
+
+/**
+ * Checks if acquisition in streaming mode should be started now and consumes the request.
+ * @return true if acquisition should be started.
+ */
+static bool stream_acquisition_due(void) {
+    bool retval = false;
+    if (true == streamingOn) {
+        if ((0 == streamIntervalMs) || (0 != streamAcqPending)) {
+            streamAcqPending = 0;
+            retval = true;
+        }
+    }
+    return retval;
+}
+
+/**
+ * Queues stream command to be applied in the main loop. Called inside the USB interrupt. When the queue is full, the
+ * newest command is replaced, so the last one received still takes effect.
+ */
+static void stream_queue_cmd(const uint8_t source, const uint8_t cmd, const uint16_t arg) {
+    uint8_t slot = streamCmdsIn;
+    if ((uint8_t)(slot - streamCmdsOut) >= STREAM_CMD_QUEUE_LEN) {
+        --slot;
+    } else {
+        streamCmdsIn = (uint8_t)(slot + 1);
+    }
+    slot &= (STREAM_CMD_QUEUE_LEN - 1);
+    streamCmds[slot].cmd = cmd;
+    streamCmds[slot].channel = source;
+    streamCmds[slot].arg = arg;
+}
+
+/// Applies stream commands received inside the USB interrupt. Software timers can be touched only from the main loop.
+static void stream_apply_cmds(void) {
+    while (streamCmdsOut != streamCmdsIn) {
+        const uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+        const uint8_t slot = streamCmdsOut & (STREAM_CMD_QUEUE_LEN - 1);
+        const uint8_t cmd = streamCmds[slot].cmd;
+        const uint16_t arg = streamCmds[slot].arg;
+        const usb_channel ch = (usb_channel)streamCmds[slot].channel;
+        ++streamCmdsOut;
+        irq_unmask(mask);
+
+        switch (cmd) {
+        case BM_ADAPTER_CMD_STREAM_START: stream_start(ch, arg); event_post(EVENT_ACQ_REQ); break;
+        case BM_ADAPTER_CMD_STREAM_STOP:  stream_stop();         break;
+        default: break;
+        }
+    }
+}
+
+/// Bit mask of USB channels which receive raw DMM frames, bit number is \ref usb_channel
+static volatile uint8_t rawFrameChannels = 0;
+/// Sequence number of the last raw DMM frame read successfully
+static uint32_t rawFrameSeq = 0;
+
+/**
+ * Sends raw DMM frame packet: sequence number (4 bytes), time just after the reading in us since start (8 bytes), then
+ * IR_DATA_BYTES of the frame as it is passed to the decoder, numbers are little endian. Sequence number counts all
+ * successful readings, so a gap means the packet was dropped.
+ */
+static void send_raw_frame(const usb_channel ch, const uint32_t seq, const uint64_t time_us,
+                           const uint8_t* const pRawData) {
+    enum {DATA_LEN = 4 + 8 + IR_DATA_BYTES};
+    uint8_t data[DATA_LEN];
+
+    for (int i = 0; i < 4; ++i) {
+        data[i] = (uint8_t)(seq >> (8 * i));
+    }
+    for (int i = 0; i < 8; ++i) {
+        data[4 + i] = (uint8_t)(time_us >> (8 * i));
+    }
+    memcpy(&data[12], pRawData, IR_DATA_BYTES);
+
+    uint8_t* const pPkt = usb_cdc_tx_reserve(ch, BM_ADAPTER_PKT_LEN(DATA_LEN));
+    if (NULL != pPkt) {
+        usb_cdc_tx_commit(ch, bm_create_adapter_pkt(BM_ADAPTER_RAW_FRAME_COMMAND, data, DATA_LEN, pPkt,
+                                                    BM_ADAPTER_PKT_LEN(DATA_LEN)));
+    } else {
+        op_stats_add(OP_STAT_TX_DROPPED, 1);
+    }
+}
+
+/// Bit mask of USB channels which requested CPU statistics, bit number is \ref usb_channel
+static volatile uint8_t cpuStatsReqChannels = 0;
+/// Is set to true if CPU statistics should be reset after reading
+static volatile bool cpuStatsResetReq = false;
+/// Bit mask of USB channels which requested operational statistics, bit number is \ref usb_channel
+static volatile uint8_t opStatsReqChannels = 0;
+/// Is set to true if operational statistics should be reset after reading
+static volatile bool opStatsResetReq = false;
+
+/**
+ * Sends CPU statistics packet: length of the window in us (4 bytes), then for each \ref cpu_stats_source time in us
+ * (4 bytes) and load in 0.01 % (2 bytes), all little endian.
+ */
+static void send_cpu_stats(const usb_channel ch, const cpu_stats_snapshot* const pStats) {
+    enum {DATA_LEN = 4 + (CPU_STAT_SOURCES_NO * 6)};
+    uint8_t data[DATA_LEN];
+    uint8_t* pData = data;
+
+    for (int i = 0; i < 4; ++i) {
+        *pData++ = (uint8_t)(pStats->window_us >> (8 * i));
+    }
+    for (int src = 0; src < CPU_STAT_SOURCES_NO; ++src) {
+        for (int i = 0; i < 4; ++i) {
+            *pData++ = (uint8_t)(pStats->sources[src].time_us >> (8 * i));
+        }
+        *pData++ = (uint8_t)pStats->sources[src].load;
+        *pData++ = (uint8_t)(pStats->sources[src].load >> 8);
+    }
+
+    uint8_t* const pPkt = usb_cdc_tx_reserve(ch, BM_ADAPTER_PKT_LEN(DATA_LEN));
+    if (NULL != pPkt) {
+        usb_cdc_tx_commit(ch, bm_create_adapter_pkt(BM_ADAPTER_CPU_STATS_COMMAND, data, DATA_LEN, pPkt,
+                                                    BM_ADAPTER_PKT_LEN(DATA_LEN)));
+    } else {
+        op_stats_add(OP_STAT_TX_DROPPED, 1);
+    }
+}
+
+/// Answers requests for CPU statistics received inside the USB interrupt
+static void cpu_stats_answer(void) {
+    const uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+    const uint8_t channels = cpuStatsReqChannels;
+    const bool reset = cpuStatsResetReq;
+    cpuStatsReqChannels = 0;
+    cpuStatsResetReq = false;
+    irq_unmask(mask);
+
+    if (0 != channels) {
+        cpu_stats_snapshot stats;
+        cpu_stats_get(&stats, reset);
+        for (int ch = 0; ch < USB_CH_NO; ++ch) {
+            if (0 != (channels & (1 << ch))) {
+                send_cpu_stats((usb_channel)ch, &stats);
+            }
+        }
+    }
+}
+
+/**
+ * Sends operational statistics packet: each \ref op_stats_counter (4 bytes), number of latency samples (4 bytes), then
+ * minimal, mean and maximal request to reply latency in us (4 bytes each), all little endian.
+ */
+static void send_op_stats(const usb_channel ch, const op_stats_snapshot* const pStats) {
+    enum {DATA_LEN = (OP_STAT_COUNTERS_NO + 4) * 4};
+    const uint32_t values[OP_STAT_COUNTERS_NO + 4] = {
+        [OP_STAT_REQUESTS]           = pStats->counters[OP_STAT_REQUESTS],
+        [OP_STAT_ACQUISITIONS]       = pStats->counters[OP_STAT_ACQUISITIONS],
+        [OP_STAT_DMM_TIMEOUTS]       = pStats->counters[OP_STAT_DMM_TIMEOUTS],
+        [OP_STAT_INVALID_DIGITS]     = pStats->counters[OP_STAT_INVALID_DIGITS],
+        [OP_STAT_OL_PACKETS]         = pStats->counters[OP_STAT_OL_PACKETS],
+        [OP_STAT_USB_WRITE_FAILURES] = pStats->counters[OP_STAT_USB_WRITE_FAILURES],
+        [OP_STAT_TX_DROPPED]         = pStats->counters[OP_STAT_TX_DROPPED],
+        [OP_STAT_COALESCED]          = pStats->counters[OP_STAT_COALESCED],
+        [OP_STAT_COUNTERS_NO]        = pStats->latencyNo,
+        [OP_STAT_COUNTERS_NO + 1]    = pStats->latencyMin_us,
+        [OP_STAT_COUNTERS_NO + 2]    = pStats->latencyMean_us,
+        [OP_STAT_COUNTERS_NO + 3]    = pStats->latencyMax_us,
+    };
+    uint8_t data[DATA_LEN];
+    uint8_t* pData = data;
+
+    for (int v = 0; v < OP_STAT_COUNTERS_NO + 4; ++v) {
+        for (int i = 0; i < 4; ++i) {
+            *pData++ = (uint8_t)(values[v] >> (8 * i));
+        }
+    }
+
+    uint8_t* const pPkt = usb_cdc_tx_reserve(ch, BM_ADAPTER_PKT_LEN(DATA_LEN));
+    if (NULL != pPkt) {
+        usb_cdc_tx_commit(ch, bm_create_adapter_pkt(BM_ADAPTER_OP_STATS_COMMAND, data, DATA_LEN, pPkt,
+                                                    BM_ADAPTER_PKT_LEN(DATA_LEN)));
+    } else {
+        op_stats_add(OP_STAT_TX_DROPPED, 1);
+    }
+}
+
+/// Answers requests for operational statistics received inside the USB interrupt
+static void op_stats_answer(void) {
+    const uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+    const uint8_t channels = opStatsReqChannels;
+    const bool reset = opStatsResetReq;
+    opStatsReqChannels = 0;
+    opStatsResetReq = false;
+    irq_unmask(mask);
+
+    if (0 != channels) {
+        op_stats_snapshot stats;
+        op_stats_get(&stats, reset);
+        for (int ch = 0; ch < USB_CH_NO; ++ch) {
+            if (0 != (channels & (1 << ch))) {
+                send_op_stats((usb_channel)ch, &stats);
+            }
+        }
+    }
+}
+
+/// Bit mask of USB channels which requested latency histograms, bit number is \ref usb_channel
+static volatile uint8_t latencyReqChannels = 0;
+/// Is set to true if latency histograms should be reset after reading
+static volatile bool latencyResetReq = false;
+/// Context of the latency histograms coroutine
+static pt_ctx latencyPt;
+
+/**
+ * Adds durations of phases of the data request to histograms when its packet is accepted by the endpoint. Called
+ * inside the USB interrupt or inside \ref usb_cdc_tx_commit.
+ */
+static void tx_written_callback(const usb_channel ch, const uint32_t written_bytes) {
+    request_timeline* const tl = &timelines[ch];
+    if ((false == tl->armed) || ((int32_t)(written_bytes - tl->txMark) < 0)) {
+        return;
+    }
+    tl->armed = false;
+
+    const uint32_t now = st_get_cycles();
+    const uint32_t durations[LAT_PHASES_NO] = {
+        [LAT_PHASE_QUEUE]       = (uint32_t)st_cycles_to_us(tl->startCycles - tl->requestCycles),
+        [LAT_PHASE_START_PULSE] = (uint32_t)st_cycles_to_us(tl->pulseEndCycles - tl->startCycles),
+        [LAT_PHASE_DMM_WAKE]    = (uint32_t)st_cycles_to_us(tl->readyCycles - tl->pulseEndCycles),
+        [LAT_PHASE_CLOCK_IN]    = (uint32_t)st_cycles_to_us(tl->doneCycles - tl->readyCycles),
+        [LAT_PHASE_DECODE]      = (uint32_t)st_cycles_to_us(tl->builtCycles - tl->doneCycles),
+        [LAT_PHASE_USB]         = (uint32_t)st_cycles_to_us(now - tl->builtCycles),
+    };
+    for (int phase = 0; phase < LAT_PHASES_NO; ++phase) {
+        latency_hist_add(&phaseHists[phase], durations[phase]);
+    }
+}
+
+/**
+ * Starts measuring of the USB phase of the data request served by the current acquisition. Called just before its
+ * packet is committed to the TX ring buffer.
+ */
+static void latency_arm(const usb_channel ch) {
+    const uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+    request_timeline* const tl = &timelines[ch];
+    tl->requestCycles = acqRequestCycles[ch];
+    tl->startCycles = acqCycles.startCycles;
+    tl->pulseEndCycles = acqCycles.pulseEndCycles;
+    tl->readyCycles = acqCycles.readyCycles;
+    tl->doneCycles = acqCycles.doneCycles;
+    tl->builtCycles = st_get_cycles();
+    tl->txMark = usb_cdc_get_tx_committed_bytes(ch) + sizeof(data_resp_pkt);
+    tl->armed = true;
+    irq_unmask(mask);
+}
+
+/**
+ * Sends latency histograms, two packets per phase. Data of each packet: phase (\ref latency_phase), index of the first
+ * bin, number of samples (4 bytes), the longest duration in us (4 bytes), then LATENCY_PKT_BINS bins (4 bytes each),
+ * all little endian. Bins are described in latency_hist.h. Resumed on EVENT_HOST_CMD and EVENT_PT_WAKEUP.
+ */
+static PT_THREAD(latency_hist_pt(pt_ctx* const pt)) {
+    enum {LATENCY_PKT_BINS = (LATENCY_HIST_BINS + 1) / 2, LATENCY_PKT_DATA_LEN = 10 + (LATENCY_PKT_BINS * 4)};
+    static latency_hist hists[LAT_PHASES_NO];
+    static uint8_t channels;
+    static uint8_t ch;
+    static uint8_t pktNo;
+
+    PT_BEGIN(pt);
+    while (1) {
+        PT_WAIT_UNTIL(pt, 0 != latencyReqChannels);
+
+        uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+        channels = latencyReqChannels;
+        const bool reset = latencyResetReq;
+        latencyReqChannels = 0;
+        latencyResetReq = false;
+        irq_unmask(mask);
+
+        for (int phase = 0; phase < LAT_PHASES_NO; ++phase) {
+            mask = irq_mask_from(IRQ_PRIO_USB);
+            hists[phase] = phaseHists[phase];
+            if (true == reset) {
+                latency_hist_reset(&phaseHists[phase]);
+            }
+            irq_unmask(mask);
+        }
+
+        for (ch = 0; ch < USB_CH_NO; ++ch) {
+            if (0 == (channels & (1 << ch))) {
+                continue;
+            }
+            for (pktNo = 0; pktNo < (LAT_PHASES_NO * 2); ++pktNo) {
+                uint8_t* pPkt = NULL;
+                while (NULL == (pPkt = usb_cdc_tx_reserve((usb_channel)ch, BM_ADAPTER_PKT_LEN(LATENCY_PKT_DATA_LEN)))) {
+                    // TX ring is full, give the host time to read
+                    PT_AWAIT_MS(pt, 1);
+                }
+
+                const latency_hist* const pHist = &hists[pktNo / 2];
+                const uint8_t firstBin = (uint8_t)((pktNo % 2) * LATENCY_PKT_BINS);
+                uint8_t data[LATENCY_PKT_DATA_LEN];
+                uint8_t* pData = data;
+                *pData++ = (uint8_t)(pktNo / 2);
+                *pData++ = firstBin;
+                for (int i = 0; i < 4; ++i) {
+                    *pData++ = (uint8_t)(pHist->samples >> (8 * i));
+                }
+                for (int i = 0; i < 4; ++i) {
+                    *pData++ = (uint8_t)(pHist->max_us >> (8 * i));
+                }
+                for (int bin = firstBin; bin < (firstBin + LATENCY_PKT_BINS); ++bin) {
+                    const uint32_t count = (bin < LATENCY_HIST_BINS) ? pHist->bins[bin] : 0;
+                    for (int i = 0; i < 4; ++i) {
+                        *pData++ = (uint8_t)(count >> (8 * i));
+                    }
+                }
+
+                usb_cdc_tx_commit((usb_channel)ch, bm_create_adapter_pkt(BM_ADAPTER_LATENCY_COMMAND, data,
+                                                                         LATENCY_PKT_DATA_LEN, pPkt,
+                                                                         BM_ADAPTER_PKT_LEN(LATENCY_PKT_DATA_LEN)));
+            }
+        }
+    }
+    PT_END(pt);
+}
+
+/// Is set to true when the host requested the trace dump
+static volatile bool traceDumpReq = false;
+/// USB channel which requested the trace dump
+static volatile uint8_t traceDumpChannel = USB_CH_CDC;
+/// Is set to true if tracing should be paused during the dump
+static volatile bool traceDumpPause = false;
+/// Context of the trace dump coroutine
+static pt_ctx traceDumpPt;
+
+/**
+ * Sends records of the trace stored at the moment of request, in packets of up to TRACE_RECORDS_PER_PKT records. Data
+ * of each packet: sequence number of the first record (4 bytes), then records: cycles (4 bytes), event, reserved byte,
+ * argument (2 bytes), all little endian. Packet without records ends the dump. Resumed on EVENT_HOST_CMD and
+ * EVENT_PT_WAKEUP.
+ */
+static PT_THREAD(trace_dump_pt(pt_ctx* const pt)) {
+    enum {TRACE_RECORDS_PER_PKT = 6, TRACE_PKT_DATA_LEN = 4 + (TRACE_RECORDS_PER_PKT * 8)};
+    static usb_channel ch;
+    static uint32_t seq;
+    static uint32_t endSeq;
+    static uint8_t recordsNo;
+
+    PT_BEGIN(pt);
+    while (1) {
+        PT_WAIT_UNTIL(pt, true == traceDumpReq);
+        ch = (usb_channel)traceDumpChannel;
+        if (true == traceDumpPause) {
+            trace_enable(false);
+        }
+        traceDumpReq = false;
+        // records written during the dump (e.g. USB writes of the dump itself) are not sent
+        seq = trace_get_oldest_seq();
+        endSeq = trace_get_next_seq();
+
+        do {
+            uint8_t* pPkt = NULL;
+            while (NULL == (pPkt = usb_cdc_tx_reserve(ch, BM_ADAPTER_PKT_LEN(TRACE_PKT_DATA_LEN)))) {
+                // TX ring is full, give the host time to read
+                PT_AWAIT_MS(pt, 1);
+            }
+
+            uint8_t data[TRACE_PKT_DATA_LEN];
+            uint8_t* pData = &data[4];
+            trace_record rec;
+            recordsNo = 0;
+            // sequence number of the first record, it skips records overwritten meanwhile
+            uint32_t firstSeq = seq;
+            while ((recordsNo < TRACE_RECORDS_PER_PKT) && (seq < endSeq) && (true == trace_read(&seq, &rec))) {
+                if (0 == recordsNo) {
+                    firstSeq = seq;
+                }
+                for (int i = 0; i < 4; ++i) {
+                    *pData++ = (uint8_t)(rec.cycles >> (8 * i));
+                }
+                *pData++ = rec.event;
+                *pData++ = rec.reserved;
+                *pData++ = (uint8_t)rec.arg;
+                *pData++ = (uint8_t)(rec.arg >> 8);
+                ++seq;
+                ++recordsNo;
+            }
+            for (int i = 0; i < 4; ++i) {
+                data[i] = (uint8_t)(firstSeq >> (8 * i));
+            }
+
+            const uint8_t dataLen = (uint8_t)(4 + (recordsNo * 8));
+            usb_cdc_tx_commit(ch, bm_create_adapter_pkt(BM_ADAPTER_TRACE_COMMAND, data, dataLen, pPkt,
+                                                        BM_ADAPTER_PKT_LEN(dataLen)));
+        } while (recordsNo > 0);
+
+        trace_enable(true);
+    }
+    PT_END(pt);
+}
+
+/// Resumes coroutines which answer host commands. Handler of EVENT_PT_WAKEUP.
+static void host_cmd_pt_task(void) {
+    trace_dump_pt(&traceDumpPt);
+    latency_hist_pt(&latencyPt);
+}
+
+/// Applies adapter specific commands which can not be handled inside the USB interrupt. Handler of EVENT_HOST_CMD.
+static void host_cmd_task(void) {
+    stream_apply_cmds();
+    cpu_stats_answer();
+    op_stats_answer();
+    host_cmd_pt_task();
+}
+
+/// Queues data requests of given USB channel. Called inside the USB interrupt.
+static void add_data_requests(const usb_channel ch, const uint8_t requests_no) {
+    if (0 == dataRequestNo[ch]) {
+        requestCycles[ch] = st_get_cycles();
+    }
+    dataRequestNo[ch] += requests_no;
+    op_stats_add(OP_STAT_REQUESTS, requests_no);
+    event_post(EVENT_ACQ_REQ);
+}
+
+/// Handles adapter specific commands received from host. Called inside the USB interrupt.
+static void host_cmd_handler(const uint8_t source, const uint8_t cmd, const uint8_t arg0, const uint8_t arg1) {
+    switch (cmd) {
+    case BM_ADAPTER_CMD_STREAM_START:
+    case BM_ADAPTER_CMD_STREAM_STOP:
+        stream_queue_cmd(source, cmd, (uint16_t)(arg0 | (arg1 << 8)));
+        event_post(EVENT_HOST_CMD);
+        break;
+    case BM_ADAPTER_CMD_READ:
+        add_data_requests((usb_channel)source, 1);
+        break;
+    case BM_ADAPTER_CMD_EXT_FORMAT: {
+        extFormat[source] = (0 != arg0);
+        bool anyExtFormat = false;
+        for (int ch = 0; ch < USB_CH_NO; ++ch) {
+            anyExtFormat |= extFormat[ch];
+        }
+        usb_cdc_enable_sof_capture(anyExtFormat);
+    } break;
+    case BM_ADAPTER_CMD_TRACE_DUMP:
+        traceDumpChannel = source;
+        traceDumpPause = (0 != arg0);
+        traceDumpReq = true;
+        event_post(EVENT_HOST_CMD);
+        break;
+    case BM_ADAPTER_CMD_CPU_STATS:
+        cpuStatsReqChannels |= (uint8_t)(1 << source);
+        cpuStatsResetReq |= (0 != arg0);
+        event_post(EVENT_HOST_CMD);
+        break;
+    case BM_ADAPTER_CMD_LATENCY_HIST:
+        latencyReqChannels |= (uint8_t)(1 << source);
+        latencyResetReq |= (0 != arg0);
+        event_post(EVENT_HOST_CMD);
+        break;
+    case BM_ADAPTER_CMD_RAW_FRAMES:
+        if (0 != arg0) {
+            rawFrameChannels |= (uint8_t)(1 << source);
+        } else {
+            rawFrameChannels &= (uint8_t)~(1 << source);
+        }
+        break;
+    case BM_ADAPTER_CMD_OP_STATS:
+        opStatsReqChannels |= (uint8_t)(1 << source);
+        opStatsResetReq |= (0 != arg0);
+        event_post(EVENT_HOST_CMD);
+        break;
+    default: break;
+    }
+}
+
+/**
+ * Takes one pending data request of each USB channel. Requests of all channels are served by single acquisition.
+ * @return bit mask of channels whose data request was pending, bit number is \ref usb_channel.
+ */
+static uint8_t take_data_requests(void) {
+    uint8_t retval = 0;
+    const uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+    for (int ch = 0; ch < USB_CH_NO; ++ch) {
+        if (dataRequestNo[ch] > 0) {
+            --dataRequestNo[ch];
+            retval |= (uint8_t)(1 << ch);
+            acqRequestCycles[ch] = requestCycles[ch];
+            if (dataRequestNo[ch] > 0) {
+                // arrival of requests queued behind is not stored, they are measured from getting their turn
+                requestCycles[ch] = st_get_cycles();
+            }
+        }
+    }
+    irq_unmask(mask);
+    return retval;
+}
+
+/// Called inside the timer interrupt at the end of the start impulse
+static void pulse_end_callback(void) {
+    acqCycles.pulseEndCycles = st_get_cycles();
+}
+
+/// Called inside the EXTI interrupt when DMM starts transmitting, captures the acquisition moment
+static void dmm_ready_callback(void) {
+    const uint32_t cycles = st_get_cycles();
+    acqCycles.readyCycles = cycles;
+    uint16_t frameNo = 0;
+    uint32_t offsetCycles = 0;
+
+    acqTimestamp.valid = usb_cdc_get_sof_timestamp(cycles, &frameNo, &offsetCycles);
+    acqTimestamp.frameNo = frameNo;
+    acqTimestamp.offsetCycles = offsetCycles;
+}
+
+/**
+ * Sends packet converted from raw IR data to the host, it is built directly inside the USB TX buffer. In the extended
+ * format packet is followed by the timestamp packet, both are reserved and committed together, so either both or none
+ * of them is sent.
+ * @param ch USB channel
+ * @param pRawData raw data read from the DMM
+ * @return true if the data packet was queued for sending.
+ */
+static bool send_bm_pkt(const usb_channel ch, const uint8_t* const pRawData) {
+    // the format is switched inside the USB interrupt
+    const bool withTimestamp = extFormat[ch];
+    const uint16_t len = sizeof(data_resp_pkt) + ((true == withTimestamp) ? sizeof(timestamp_resp_pkt) : 0);
+    uint8_t* const pPkts = usb_cdc_tx_reserve(ch, len);
+    if (NULL == pPkts) {
+        op_stats_add(OP_STAT_TX_DROPPED, 1);
+        return false;
+    }
+
+    data_resp_pkt* const pBmData = (data_resp_pkt*)pPkts;
+    cpu_stats_ctx stats;
+    cpu_stats_enter(&stats);
+    const bm_result result = bm_create_pkt(pRawData, IR_DATA_BYTES, pBmData);
+    cpu_stats_leave(&stats, CPU_STAT_BM_CREATE_PKT);
+
+    TRACE(TRACE_PKT_BUILT, ch);
+    op_stats_add(OP_STAT_INVALID_DIGITS, bm_take_invalid_digits_no());
+    if (BM_PKG_CREATED != result) {
+        usb_cdc_tx_commit(ch, 0);
+        return false;
+    }
 
+    if (BM_OL_PACKET_DATA_LENGTH == pBmData->header.dataLen) {
+        op_stats_add(OP_STAT_OL_PACKETS, 1);
+    }
+    if (true == withTimestamp) {
+        const uint32_t offsetNs = (true == acqTimestamp.valid) ? st_cycles_to_ns(acqTimestamp.offsetCycles)
+                                                               : UINT32_MAX;
+        bm_create_timestamp_pkt(acqTimestamp.frameNo, offsetNs, (timestamp_resp_pkt*)&pPkts[sizeof(data_resp_pkt)]);
+    }
+    if (0 != (acqRequestChannels & (1 << ch))) {
+        latency_arm(ch);
+    }
+    usb_cdc_tx_commit(ch, len);
+    return true;
+}
+
+/**
+ * Callback function called inside the USB interrupt when received some data by CDC or vendor interface. Brymen data
+ * requests are accepted only by CDC, adapter specific commands by both interfaces.
+ */
+static void cdcacm_rx_callback(usbd_device *usbd_dev, uint8_t ep) {
     static uint8_t buff[CDC_DATA_BUFFER_LEN] = {0};
 
+    const usb_channel ch = usb_cdc_get_channel(ep);
     // read received bytes from usb buffer
-    int len = usbd_ep_read_packet(usbd_dev, CDC_DATA_IN_EP, buff, CDC_DATA_BUFFER_LEN);
+    int len = usbd_ep_read_packet(usbd_dev, ep, buff, CDC_DATA_BUFFER_LEN);
 
     // check received bytes for 'dmm-data' request
     if (len > 0) {
-        dataRequestNo += check_buffer_for_data_request(buff, len);
+        if (USB_CH_CDC == ch) {
+            const uint8_t requestsNo = check_buffer_for_data_request(buff, len);
+            if (requestsNo > 0) {
+                add_data_requests(ch, requestsNo);
+            }
+        }
+        check_buffer_for_host_cmd(&hostCmdParsers[ch], buff, len, host_cmd_handler);
+    }
+}
+
+/// Raw data read from the DMM
+static uint8_t ir_raw_data_buff[IR_DATA_BYTES] = {0};
+/// Bit mask of USB channels waiting for the current acquisition
+static uint8_t acqChannels = 0;
+
+/// Collects USB channels which wait for acquisition, returns their bit mask
+static uint8_t collect_acq_channels(void) {
+    acqRequestChannels = take_data_requests();
+    uint8_t retval = acqRequestChannels;
+    int servedNo = __builtin_popcount(acqRequestChannels);
+    if (true == stream_acquisition_due()) {
+        retval |= (uint8_t)(1 << streamChannel);
+        ++servedNo;
+    }
+    if (servedNo > 1) {
+        op_stats_add(OP_STAT_COALESCED, (uint32_t)(servedNo - 1));
     }
+    return retval;
 }
 
+/// Context of the acquisition coroutine
+static pt_ctx acqPt;
 
-static void rcc_clock_setup_in_hse_8mhz_out_48mhz(void) {
+/**
+ * Drives acquisitions: starts reading of the DMM when some channel waits for data and sends the result when reading is
+ * done. Resumed on EVENT_ACQ_REQ and EVENT_IR_END.
+ */
+static PT_THREAD(acquisition_pt(pt_ctx* const pt)) {
+    ir_itf_state_type status = IR_ITF_READY;
+
+    PT_BEGIN(pt);
+    while (1) {
+        PT_WAIT_UNTIL(pt, (IR_ITF_READY == ir_itf_get_status()) && (0 != (acqChannels = collect_acq_channels())));
+
+#if 1 == FAKE_RESPONSE
+        static systick_t startPoint = 0;
+        // simulate data acquisition
+        if ((systick_t)(st_get_ticks() - startPoint) >= 350) {
+            usb_cdc_write(USB_CH_CDC, &example_voltageReading1, sizeof(data_resp_pkt));
+            startPoint = st_get_ticks();
+        }
+#else
+        memset((void*)ir_raw_data_buff, 0, IR_DATA_BYTES);
+        acqTimestamp.valid = false;
+        acqCycles.startCycles = st_get_cycles();
+        ir_itf_start_read_nb(ir_raw_data_buff, IR_DATA_BYTES);
+        op_stats_add(OP_STAT_ACQUISITIONS, 1);
+
+        PT_AWAIT_IR_DONE(pt, status);
+        TRACE(TRACE_IR_DONE, status);
+        if (IR_ITF_DONE != status) {
+            op_stats_add(OP_STAT_DMM_TIMEOUTS, 1);
+        } else {
+#if INTERFACE_VER1 == USING_INTERFACE_VER
+            // Inverse bits in raw data -> DMM transmits '0' when turns its IR LED on. So with this version of hardware
+            // read bit of value '1' is in fact bit of value '0'.
+            for (int i = 0; i < IR_DATA_BYTES; ++i) {
+                ir_raw_data_buff[i] = ~ir_raw_data_buff[i];
+            }
+#endif
+            // convert raw data to the brymen packet for each channel which waits for it
+            for (int ch = 0; ch < USB_CH_NO; ++ch) {
+                if (0 != (acqChannels & (1 << ch))) {
+                    const bool sent = send_bm_pkt((usb_channel)ch, ir_raw_data_buff);
+                    if ((true == sent) && (0 != (acqRequestChannels & (1 << ch)))) {
+                        op_stats_add_latency((uint32_t)st_cycles_to_us(st_get_cycles() - acqRequestCycles[ch]));
+                    }
+                }
+            }
+
+            // raw frame follows data packets, so it doesn't delay them
+            ++rawFrameSeq;
+            const uint8_t rawChannels = rawFrameChannels;
+            if (0 != rawChannels) {
+                const uint64_t timeUs = st_get_time_us();
+                for (int ch = 0; ch < USB_CH_NO; ++ch) {
+                    if (0 != (rawChannels & (1 << ch))) {
+                        send_raw_frame((usb_channel)ch, rawFrameSeq, timeUs, ir_raw_data_buff);
+                    }
+                }
+            }
+        }
+#endif
+        acqChannels = 0;
+        // requests received meanwhile and streaming as fast as possible are served by the next loop right away
+    }
+    PT_END(pt);
+}
+
+/// Handler of events which resume the acquisition coroutine
+static void acquisition_task(void) {
+    acquisition_pt(&acqPt);
+}
+
+/// Called by SysTick interrupt on each tick
+static void systick_callback(void) {
+    event_post(EVENT_SOFT_TIMER);
+}
+
+/// Called when transaction of IR interface ends, successfully or not
+static void ir_end_callback(void) {
+    acqCycles.doneCycles = st_get_cycles();
+    event_post(EVENT_IR_END);
+}
+
+
+/// Settings of RCC and flash for the clock profile, see clock_profile.h
+#if 9 == CLOCK_PLL_MUL
+#define CLOCK_RCC_PLLMUL        RCC_CFGR_PLLMUL_PLL_CLK_MUL9
+#elif 6 == CLOCK_PLL_MUL
+#define CLOCK_RCC_PLLMUL        RCC_CFGR_PLLMUL_PLL_CLK_MUL6
+#else
+#error "Unsupported CLOCK_PLL_MUL, 6 or 9 expected"
+#endif
+#if 72000000 == SYSCLK_HZ
+#define CLOCK_RCC_USBPRE        RCC_CFGR_USBPRE_PLL_CLK_DIV1_5
+#define CLOCK_FLASH_LATENCY     FLASH_ACR_LATENCY_2WS
+#else
+#define CLOCK_RCC_USBPRE        RCC_CFGR_USBPRE_PLL_CLK_NODIV
+#define CLOCK_FLASH_LATENCY     FLASH_ACR_LATENCY_1WS
+#endif
+
+static void rcc_clock_setup_in_hse_8mhz(void) {
 //    /* Enable internal high-speed oscillator. */
 //    rcc_osc_on(RCC_HSI);
 //    rcc_wait_for_osc_ready(RCC_HSI);
@@ -87,25 +893,24 @@ static void rcc_clock_setup_in_hse_8mhz_out_48mhz(void) {
      * Set prescalers for AHB, ADC, ABP1, ABP2.
      * Do this before touching the PLL
      */
-    rcc_set_hpre(RCC_CFGR_HPRE_SYSCLK_NODIV);   /*Set.48MHz Max.72MHz */
-    rcc_set_adcpre(RCC_CFGR_ADCPRE_PCLK2_DIV8); /*Set. 6MHz Max.14MHz */
-    rcc_set_ppre1(RCC_CFGR_PPRE1_HCLK_DIV2);    /*Set.24MHz Max.36MHz */
-    rcc_set_ppre2(RCC_CFGR_PPRE2_HCLK_NODIV);   /*Set.48MHz Max.72MHz */
-    rcc_set_usbpre(RCC_CFGR_USBPRE_PLL_CLK_NODIV);  /*Set.48MHz Max.48MHz */
+    rcc_set_hpre(RCC_CFGR_HPRE_SYSCLK_NODIV);   /*Set.48/72MHz Max.72MHz */
+    rcc_set_adcpre(RCC_CFGR_ADCPRE_PCLK2_DIV8); /*Set. 6/9MHz Max.14MHz */
+    rcc_set_ppre1(RCC_CFGR_PPRE1_HCLK_DIV2);    /*Set.24/36MHz Max.36MHz */
+    rcc_set_ppre2(RCC_CFGR_PPRE2_HCLK_NODIV);   /*Set.48/72MHz Max.72MHz */
+    rcc_set_usbpre(CLOCK_RCC_USBPRE);           /*Set.48MHz Max.48MHz */
 
     /*
-     * Sysclk runs with 24MHz -> 0 waitstates.
      * 0WS from 0-24MHz
      * 1WS from 24-48MHz
      * 2WS from 48-72MHz
      */
-    flash_set_ws(FLASH_ACR_LATENCY_1WS);
+    flash_set_ws(CLOCK_FLASH_LATENCY);
 
     /*
-     * Set the PLL multiplication factor to 6.
-     * 8MHz (external) * 6 (multiplier) = 48MHz
+     * Set the PLL multiplication factor.
+     * 8MHz (external) * CLOCK_PLL_MUL (6 or 9) = SYSCLK_HZ
      */
-    rcc_set_pll_multiplication_factor(RCC_CFGR_PLLMUL_PLL_CLK_MUL6);
+    rcc_set_pll_multiplication_factor(CLOCK_RCC_PLLMUL);
 
     /* Select HSE as PLL source. */
     rcc_set_pll_source(RCC_CFGR_PLLSRC_HSE_CLK);
@@ -124,9 +929,9 @@ static void rcc_clock_setup_in_hse_8mhz_out_48mhz(void) {
     rcc_set_sysclk_source(RCC_CFGR_SW_SYSCLKSEL_PLLCLK);
 
     /* Set the peripheral clock frequencies used */
-    rcc_ahb_frequency = 48000000;
-    rcc_apb1_frequency = 24000000;
-    rcc_apb2_frequency = 48000000;
+    rcc_ahb_frequency = AHB_HZ;
+    rcc_apb1_frequency = APB1_HZ;
+    rcc_apb2_frequency = APB2_HZ;
 }
 
 
@@ -135,10 +940,13 @@ static void rcc_clock_setup_in_hse_8mhz_out_48mhz(void) {
 int main(void) {
     usbd_device* usbd_dev = NULL;
 
-    rcc_clock_setup_in_hse_8mhz_out_48mhz();
+    // Time critical functions and handlers are called from RAM
+    ramfunc_init();
+
+    rcc_clock_setup_in_hse_8mhz();
 
     // Configures and start SysTick
-    st_init(1000, 48000000);
+    st_init(1000, AHB_HZ);
 
     rcc_periph_clock_enable(RCC_GPIOA);
     rcc_periph_clock_enable(RCC_AFIO);
@@ -150,15 +958,27 @@ int main(void) {
 
     // init ir interface
     ir_itf_init_nb();
+    ir_itf_register_pulse_end_callback(pulse_end_callback);
+    ir_itf_register_dmm_ready_callback(dmm_ready_callback);
+    ir_itf_register_end_callback(ir_end_callback);
 
-    uint8_t ir_raw_data_buff[IR_DATA_BYTES] = {0};
-    data_resp_pkt bm_data = {0};
+    event_loop_register(EVENT_SOFT_TIMER, soft_timer_poll);
+    event_loop_register(EVENT_HOST_CMD, host_cmd_task);
+    event_loop_register(EVENT_PT_WAKEUP, host_cmd_pt_task);
+    event_loop_register(EVENT_IR_END, acquisition_task);
+    event_loop_register(EVENT_ACQ_REQ, acquisition_task);
+    st_register_tick_callback(systick_callback);
+
+    for (int ch = 0; ch < USB_CH_NO; ++ch) {
+        host_cmd_parser_init(&hostCmdParsers[ch], (uint8_t)ch);
+    }
 
     // LED on
     bsp_set_led_state(true);
 
     // register custom callback for USB-DATA-RECEIVED event
     usb_cdc_register_data_in_callback(cdcacm_rx_callback);
+    usb_cdc_register_tx_written_callback(tx_written_callback);
     // init USB device
     usbd_dev = usb_cdc_init();
     assert(NULL != usbd_dev);
@@ -166,54 +986,38 @@ int main(void) {
 
 
     systick_t startPoint = st_get_ticks();
-    // allow USB to submit on host OS
+    // allow USB to submit on host OS, USB is serviced by the interrupt
     while ((systick_t)(st_get_ticks() - startPoint) <= 2000) {
-        usbd_poll(usbd_dev);
+        bsp_wait_for_interrupt();
     }
 
-    startPoint = st_get_ticks();
     while (1) {
-        usbd_poll(usbd_dev);
-        soft_timer_poll();
-
-        switch(ir_itf_get_status()) {
-        case IR_ITF_READY:
-            if (dataRequestNo > 0) {
-                --dataRequestNo;
-
-    #if 1 == FAKE_RESPONSE
-
-                // simulate data acquisition
-                if ((systick_t)(st_get_ticks() - startPoint) >= 350) {
-
-                    usbd_ep_write_packet(usbd_dev, CDC_DATA_OUT_EP, (void*)&example_voltageReading1, sizeof(data_resp_pkt));
-                    startPoint = st_get_ticks();
-                }
-    #else
-                memset((void*)ir_raw_data_buff, 0, IR_DATA_BYTES);
-                ir_itf_start_read_nb(ir_raw_data_buff, IR_DATA_BYTES);
-    #endif
+        event_loop_dispatch();
 
+#if 1 == SYSTICK_TICKLESS
+        // SysTick wakes the core up only when the first software timer times out
+        uint32_t nextTimeout = 0;
+        if (true == soft_timer_get_next_timeout(&nextTimeout)) {
+            if (0 == nextTimeout) {
+                event_post(EVENT_SOFT_TIMER);
             }
-        break;
-        case IR_ITF_DONE: {
-#if INTERFACE_VER1 == USING_INTERFACE_VER
-            // Inverse bits in raw data -> DMM transmits '0' when turns its IR LED on. So with this version of hardware
-            // read bit of value '1' is in fact bit of value '0'.
-            for (int i = 0; i < IR_DATA_BYTES; ++i) {
-                ir_raw_data_buff[i] = ~ir_raw_data_buff[i];
-            }
+            st_set_wakeup(nextTimeout);
+        } else {
+            st_set_wakeup(UINT32_MAX);
+        }
 #endif
-            // convert raw data to the brymen packet
-            if (BM_PKG_CREATED == bm_create_pkt(ir_raw_data_buff, IR_DATA_BYTES, &bm_data)) {
-                usbd_ep_write_packet(usbd_dev, CDC_DATA_OUT_EP, (void*)&bm_data, sizeof(bm_data));
-            }
-        } // end of case IR_ITF_DONE
-        break;
-        default: break;
-        } // end of switch
-
 
+        // Sleep until the next interrupt if there is nothing to do. Interrupts are masked, so the event posted just
+        // after the check still wakes the core up. The interrupt which woke the core runs after the idle section is
+        // left, so its time isn't counted as idle.
+        const uint32_t mask = cm_mask_interrupts(1);
+        if (true == event_loop_is_idle()) {
+            cpu_stats_ctx stats;
+            cpu_stats_enter(&stats);
+            bsp_wait_for_interrupt();
+            cpu_stats_leave(&stats, CPU_STAT_IDLE);
+        }
+        cm_mask_interrupts(mask);
     }
 
     return 0;
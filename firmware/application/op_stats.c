@@ -0,0 +1,60 @@
+#include <stddef.h>
+#include "op_stats.h"
+
+/// Event counters, shared with interrupts
+static uint32_t counters[OP_STAT_COUNTERS_NO];
+
+/// Latency figures, accessed from the main loop only
+static struct {
+    uint32_t no;
+    uint64_t sum_us;
+    uint32_t min_us;
+    uint32_t max_us;
+} latency;
+
+void op_stats_add(const op_stats_counter counter, const uint32_t n) {
+    if (counter < OP_STAT_COUNTERS_NO) {
+        __atomic_fetch_add(&counters[counter], n, __ATOMIC_RELAXED);
+    }
+}
+
+void op_stats_add_latency(const uint32_t latency_us) {
+    if ((0 == latency.no) || (latency_us < latency.min_us)) {
+        latency.min_us = latency_us;
+    }
+    if (latency_us > latency.max_us) {
+        latency.max_us = latency_us;
+    }
+    latency.sum_us += latency_us;
+    ++latency.no;
+}
+
+void op_stats_get(op_stats_snapshot* const snapshot, const bool reset) {
+    if (NULL == snapshot) {
+        return;
+    }
+
+    for (int i = 0; i < OP_STAT_COUNTERS_NO; ++i) {
+        // counter is read and cleared at once, so no event is lost
+        snapshot->counters[i] = (true == reset) ? __atomic_exchange_n(&counters[i], 0, __ATOMIC_RELAXED)
+                                                : __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+    }
+
+    snapshot->latencyNo = latency.no;
+    if (latency.no > 0) {
+        snapshot->latencyMin_us = latency.min_us;
+        snapshot->latencyMean_us = (uint32_t)(latency.sum_us / latency.no);
+        snapshot->latencyMax_us = latency.max_us;
+    } else {
+        snapshot->latencyMin_us = 0;
+        snapshot->latencyMean_us = 0;
+        snapshot->latencyMax_us = 0;
+    }
+
+    if (true == reset) {
+        latency.no = 0;
+        latency.sum_us = 0;
+        latency.min_us = 0;
+        latency.max_us = 0;
+    }
+}
@@ -0,0 +1,51 @@
+#ifndef OP_STATS_H_
+#define OP_STATS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file Operational statistics: event counters and request to reply latency since power-on or the last reset.
+ *
+ * Counters can be incremented from any context. Latency samples are added and statistics are read from the main loop
+ * only.
+ */
+
+/// Counted events
+typedef enum {
+    OP_STAT_REQUESTS = 0,       ///< data requests received from the host
+    OP_STAT_ACQUISITIONS,       ///< readings of the DMM started
+    OP_STAT_DMM_TIMEOUTS,       ///< readings ended because DMM didn't respond
+    OP_STAT_INVALID_DIGITS,     ///< digits with unknown segments pattern, sent as empty
+    OP_STAT_OL_PACKETS,         ///< Over Limit packets sent
+    OP_STAT_USB_WRITE_FAILURES, ///< packets refused by the endpoint, they are retried later
+    OP_STAT_TX_DROPPED,         ///< packets dropped because TX buffer was full
+    OP_STAT_COALESCED,          ///< requests served by reading started for other channel
+    OP_STAT_COUNTERS_NO
+} op_stats_counter;
+
+/// Statistics since the last reset
+typedef struct {
+    uint32_t counters[OP_STAT_COUNTERS_NO];
+    /// Number of latency samples
+    uint32_t latencyNo;
+    /// Minimal, mean and maximal latency in us, all 0 if there is no sample
+    uint32_t latencyMin_us;
+    uint32_t latencyMean_us;
+    uint32_t latencyMax_us;
+} op_stats_snapshot;
+
+/// Adds n to the counter. Can be called from any interrupt.
+void op_stats_add(const op_stats_counter counter, const uint32_t n);
+
+/// Adds sample of request to reply latency
+void op_stats_add_latency(const uint32_t latency_us);
+
+/**
+ * Returns statistics since the last reset.
+ * @param[out] snapshot statistics
+ * @param reset if true, statistics are cleared after reading
+ */
+void op_stats_get(op_stats_snapshot* const snapshot, const bool reset);
+
+#endif // OP_STATS_H_
@@ -0,0 +1,96 @@
+#ifndef PT_H_
+#define PT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "soft_timer.h"
+#include "event_loop.h"
+
+/**
+ * @file Stackless coroutines (protothreads) built on the switch statement.
+ *
+ * Coroutine is a function taking \ref pt_ctx and returning \ref pt_result. Its body is enclosed between PT_BEGIN and
+ * PT_END, awaiting macros return from the function and the next call resumes it just after the awaiting point, so
+ * sequential code can wait for time or events without blocking the main loop.
+ *
+ * Limitations:
+ * - local variables are not preserved across awaiting points, keep the state in static variables or in the context,
+ * - awaiting macros can not be used inside the switch statement of the coroutine.
+ *
+ * Coroutine is resumed by calling it again, usually from the handler of the event it waits for. PT_AWAIT_MS posts
+ * EVENT_PT_WAKEUP when the time elapses, its handler must resume coroutines which await time.
+ */
+
+/// Result of the coroutine call
+typedef enum {
+    PT_WAITING = 0,     ///< coroutine waits at awaiting point
+    PT_EXITED,          ///< coroutine left by PT_EXIT
+    PT_ENDED            ///< coroutine reached PT_END
+} pt_result;
+
+/// Context of the coroutine
+typedef struct {
+    /// Resume point, 0 is the start of the coroutine
+    uint16_t            lc;
+    /// Dispatch counter of the awaited event, see \ref PT_AWAIT_EVENT
+    uint32_t            event_count;
+    /// Timer used by \ref PT_AWAIT_MS
+    soft_timer_descr    timer;
+} pt_ctx;
+
+/// Callback of the timer used by \ref PT_AWAIT_MS
+static inline void pt_timer_callback(void) {
+    event_post(EVENT_PT_WAKEUP);
+}
+
+/// Declares the coroutine function
+#define PT_THREAD(name_args) pt_result name_args
+
+/// Initializes context, the next call starts the coroutine from the beginning
+#define PT_INIT(pt) do { (pt)->lc = 0; } while (0)
+
+/// Starts the body of the coroutine
+#define PT_BEGIN(pt) switch ((pt)->lc) { case 0:
+
+/// Ends the body of the coroutine, the next call starts it again
+#define PT_END(pt) } (pt)->lc = 0; return PT_ENDED
+
+/// Leaves the coroutine, the next call starts it again
+#define PT_EXIT(pt) do { (pt)->lc = 0; return PT_EXITED; } while (0)
+
+/// Waits until condition is true. Condition is evaluated at each resume.
+#define PT_WAIT_UNTIL(pt, condition)    \
+    do {                                \
+        (pt)->lc = __LINE__;            \
+        case __LINE__:                  \
+        if (!(condition)) {             \
+            return PT_WAITING;          \
+        }                               \
+    } while (0)
+
+/// Waits while condition is true
+#define PT_WAIT_WHILE(pt, condition) PT_WAIT_UNTIL((pt), !(condition))
+
+/// Returns once, the coroutine continues at the next call
+#define PT_YIELD(pt)                    \
+    do {                                \
+        (pt)->lc = __LINE__;            \
+        return PT_WAITING;              \
+        case __LINE__: ;                \
+    } while (0)
+
+/// Waits given number of ms, see soft_timer.h for the precision
+#define PT_AWAIT_MS(pt, ms)                                                         \
+    do {                                                                            \
+        soft_timer_start_one_shot(&(pt)->timer, (systick_t)(ms), pt_timer_callback);\
+        PT_WAIT_UNTIL((pt), (pt)->timer.is_timed_out);                              \
+    } while (0)
+
+/// Waits until the event is dispatched by event loop, counting from now
+#define PT_AWAIT_EVENT(pt, ev)                                                      \
+    do {                                                                            \
+        (pt)->event_count = event_loop_get_dispatch_count(ev);                      \
+        PT_WAIT_UNTIL((pt), (pt)->event_count != event_loop_get_dispatch_count(ev));\
+    } while (0)
+
+#endif //PT_H_
@@ -0,0 +1,50 @@
+#ifndef RAMFUNC_H_
+#define RAMFUNC_H_
+
+#include <stdint.h>
+
+/**
+ * @file Placement of time critical functions in RAM.
+ *
+ * Flash runs with wait states at 48 and 72 MHz and the prefetch buffer doesn't hide them after branches. Functions
+ * marked by RAMFUNC are linked into the .ramfunc section, which is loaded to flash and runs from RAM (see
+ * stm32f103c8t6_app.ld). \ref ramfunc_init copies it to RAM, so they run without wait states. The mark must be on the
+ * declaration seen by callers too: RAM is out of the range of BL from flash, so calls go through a register. Calls
+ * from RAM to flash functions go through veneers added by the linker.
+ * Host builds (unit tests, simulator) ignore the mark.
+ */
+
+/**
+ * Set to 1 to run the marked functions from RAM. Off by default: the gain was not measured yet and the calls through
+ * registers and veneers cost cycles too. 'make ramfunc-compare' in isa_bench runs the benchmarks both ways.
+ */
+#ifndef RAMFUNC_ENABLED
+#define RAMFUNC_ENABLED 0
+#endif
+
+#if (1 == RAMFUNC_ENABLED) && defined(__arm__)
+#define RAMFUNC __attribute__((section(".ramfunc"), long_call, noinline))
+/// Handlers are declared by libopencm3 without long_call (it would conflict), only the vector table calls them
+#define RAMFUNC_ISR __attribute__((section(".ramfunc")))
+#else
+#define RAMFUNC
+#define RAMFUNC_ISR
+#endif
+
+#if defined(__arm__)
+/// Copies .ramfunc from flash to RAM, must be called before any interrupt is enabled or marked function called
+static inline void ramfunc_init(void) {
+    extern uint32_t _ramfunc, _eramfunc, _ramfunc_loadaddr;
+    const uint32_t* src = &_ramfunc_loadaddr;
+
+    for (uint32_t* dst = &_ramfunc; dst < &_eramfunc; ++dst) {
+        *dst = *src++;
+    }
+}
+#else
+/// Host builds run all code in place
+static inline void ramfunc_init(void) {
+}
+#endif
+
+#endif // RAMFUNC_H_
@@ -6,74 +6,257 @@
  *
  */
 
+#include <stddef.h>
 #include "soft_timer.h"
 
 
-#define SOFT_TIMERS_POOL_SIZE 16
-static soft_timer_descr* soft_timers_pool[SOFT_TIMERS_POOL_SIZE];
+/// Root of the pairing heap of running timers, it expires first
+static soft_timer_descr* heapRoot = NULL;
+/// Incremented on each start of the timer
+static uint32_t startSeq = 0;
 
-bool soft_timer_start_one_shot(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback) {
-    bool retval = false;
-    if (NULL != stim) {
+/// Registers the timer inside the pool and starts it as timer of given type.
+static bool soft_timer_start(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback,
+                             const soft_timer_type type);
+
+/// Returns true if tick count a is before tick count b, wrap-around safe
+static inline bool is_before(const uint32_t a, const uint32_t b) {
+    return ((int32_t)(a - b) < 0);
+}
 
-        int avaiableIdx = -1;
-        // find free space in pool or the same timer if it already inserted
-        for (int i = 0; i < SOFT_TIMERS_POOL_SIZE; ++i) {
-            if ((NULL == soft_timers_pool[i]) || (stim == soft_timers_pool[i])) {
-                avaiableIdx = i;
-                break;
+/// Returns true if timer a times out before timer b
+static inline bool expires_before(const soft_timer_descr* const a, const soft_timer_descr* const b) {
+    return (true == is_before(a->expiry_count, b->expiry_count)) ||
+           ((a->expiry_count == b->expiry_count) && (true == is_before(a->start_seq, b->start_seq)));
+}
+
+/// Melds two heaps, both roots must have no siblings. Returns root of the result.
+static soft_timer_descr* heap_meld(soft_timer_descr* a, soft_timer_descr* b) {
+    if (NULL == a) {
+        return b;
+    }
+    if (NULL == b) {
+        return a;
+    }
+    if (true == expires_before(b, a)) {
+        soft_timer_descr* const tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    // b becomes the first child of a
+    b->heap_prev = a;
+    b->heap_next = a->heap_child;
+    if (NULL != a->heap_child) {
+        a->heap_child->heap_prev = b;
+    }
+    a->heap_child = b;
+    return a;
+}
+
+/**
+ * Melds the list of siblings into one heap in two passes: pairs from left to right, then the results from right to
+ * left. This keeps the amortized cost of removal logarithmic.
+ */
+static soft_timer_descr* heap_merge_pairs(soft_timer_descr* first) {
+    soft_timer_descr* pairs = NULL;
+
+    while (NULL != first) {
+        soft_timer_descr* a = first;
+        soft_timer_descr* b = a->heap_next;
+        first = (NULL != b) ? b->heap_next : NULL;
+
+        a->heap_prev = NULL;
+        a->heap_next = NULL;
+        if (NULL != b) {
+            b->heap_prev = NULL;
+            b->heap_next = NULL;
+            a = heap_meld(a, b);
+        }
+        // results are stacked in reverse order
+        a->heap_next = pairs;
+        pairs = a;
+    }
+
+    soft_timer_descr* root = NULL;
+    while (NULL != pairs) {
+        soft_timer_descr* const next = pairs->heap_next;
+        pairs->heap_next = NULL;
+        root = heap_meld(root, pairs);
+        pairs = next;
+    }
+    return root;
+}
+
+/// Links the timer into the heap according to its expiry_count
+static void heap_insert(soft_timer_descr* const stim) {
+    stim->heap_prev = NULL;
+    stim->heap_child = NULL;
+    stim->heap_next = NULL;
+    stim->start_seq = startSeq++;
+    heapRoot = heap_meld(heapRoot, stim);
+    stim->is_linked = true;
+}
+
+/// Unlinks the timer from the heap
+static void heap_remove(soft_timer_descr* const stim) {
+    if (stim == heapRoot) {
+        heapRoot = heap_merge_pairs(stim->heap_child);
+    } else {
+        // detach subtree of the timer from its parent or previous sibling
+        if (stim->heap_prev->heap_child == stim) {
+            stim->heap_prev->heap_child = stim->heap_next;
+        } else {
+            stim->heap_prev->heap_next = stim->heap_next;
+        }
+        if (NULL != stim->heap_next) {
+            stim->heap_next->heap_prev = stim->heap_prev;
+        }
+        heapRoot = heap_meld(heapRoot, heap_merge_pairs(stim->heap_child));
+    }
+
+    stim->heap_prev = NULL;
+    stim->heap_child = NULL;
+    stim->heap_next = NULL;
+    stim->is_linked = false;
+}
+
+/// Returns parent of the timer linked into the heap, NULL for the root
+static soft_timer_descr* heap_parent(const soft_timer_descr* stim) {
+    // heap_prev of the first child is the parent, of the other children their previous sibling
+    while ((NULL != stim->heap_prev) && (stim->heap_prev->heap_child != stim)) {
+        stim = stim->heap_prev;
+    }
+    return stim->heap_prev;
+}
+
+/// Returns the first timer of the heap which has terminating_req set, NULL if there is none
+static soft_timer_descr* heap_find_terminated(void) {
+    soft_timer_descr* stim = heapRoot;
+    while (NULL != stim) {
+        if (0 != stim->terminating_req) {
+            break;
+        }
+        if (NULL != stim->heap_child) {
+            stim = stim->heap_child;
+        } else {
+            // the nearest next sibling of the timer or of its ancestors
+            while ((NULL != stim) && (NULL == stim->heap_next)) {
+                stim = heap_parent(stim);
             }
+            stim = (NULL != stim) ? stim->heap_next : NULL;
         }
+    }
+    return stim;
+}
+
+/**
+ * Removes timers terminated by interrupts wherever they are in the heap, they would wait for their expiry otherwise.
+ * Cost is linear in the number of running timers.
+ */
+static void remove_terminated(void) {
+    for (soft_timer_descr* stim = heap_find_terminated(); NULL != stim; stim = heap_find_terminated()) {
+        heap_remove(stim);
+        stim->is_timed_out = true;
+    }
+}
+
+bool soft_timer_start_one_shot(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback) {
+    return soft_timer_start(stim, time_out_ticks, callback, SOFT_TIMER_SINGLE_SHOT);
+}
 
-        if (avaiableIdx >= 0) {
-            // found free space or timer is already inside the pool. In both cases set values in timer
-            stim->callback = callback;
-            stim->is_timed_out = false;
-            stim->time_out_ticks = time_out_ticks;
-            stim->type = SOFT_TIMER_SINGLE_SHOT;
-            stim->terminating_req = 0;
-            stim->last_count = (uint32_t)st_get_ticks();
-            retval = true;
-
-            // store software timer inside the pool
-            soft_timers_pool[avaiableIdx] = stim;
+bool soft_timer_start_continuous(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback) {
+    return soft_timer_start(stim, time_out_ticks, callback, SOFT_TIMER_CONTINUOUS);
+}
+
+static bool soft_timer_start(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback,
+                             const soft_timer_type type) {
+    bool retval = false;
+    // continuous timer of 0 period would time out on each poll forever
+    if ((NULL != stim) && ((SOFT_TIMER_SINGLE_SHOT == type) || (time_out_ticks > 0))) {
+        // restarted timer must not be linked twice
+        if (true == stim->is_linked) {
+            heap_remove(stim);
         }
+
+        stim->callback = callback;
+        stim->is_timed_out = false;
+        stim->time_out_ticks = time_out_ticks;
+        stim->type = type;
+        stim->terminating_req = 0;
+        stim->last_count = (uint32_t)st_get_ticks();
+        stim->expiry_count = stim->last_count + stim->time_out_ticks;
+        heap_insert(stim);
+        retval = true;
+    }
+
+    return retval;
+}
+
+bool soft_timer_restart(soft_timer_descr* const stim) {
+    bool retval = false;
+    if (NULL != stim) {
+        retval = soft_timer_start(stim, (systick_t)stim->time_out_ticks, stim->callback, stim->type);
     }
+    return retval;
+}
 
+bool soft_timer_cancel(soft_timer_descr* const stim) {
+    bool retval = false;
+    if ((NULL != stim) && (true == stim->is_linked)) {
+        heap_remove(stim);
+        stim->is_timed_out = true;
+        retval = true;
+    }
     return retval;
 }
 
+bool soft_timer_is_running(const soft_timer_descr* const stim) {
+    return (NULL != stim) && (true == stim->is_linked) && (0 == stim->terminating_req);
+}
+
+bool soft_timer_get_next_timeout(uint32_t* const ticks) {
+    if (NULL == ticks) {
+        return false;
+    }
+    remove_terminated();
+    if (NULL == heapRoot) {
+        return false;
+    }
+
+    const uint32_t now = (uint32_t)st_get_ticks();
+    *ticks = (true == is_before(now, heapRoot->expiry_count)) ? (heapRoot->expiry_count - now) : 0;
+    return true;
+}
+
 
 void soft_timer_poll(void) {
-    for (int i = 0; i < SOFT_TIMERS_POOL_SIZE; ++i) {
-        soft_timer_descr* const tim = soft_timers_pool[i];
-        if (NULL != tim) {
-
-            if (0 != tim->terminating_req) {
-                // request to terminate the software timer is set -> delete it from the pool
-                tim->is_timed_out = true;
-                soft_timers_pool[i] = NULL;
-            } else if ((st_get_time_duration(tim->last_count) >= tim->time_out_ticks) || (true == tim->is_timed_out)) {
-                // timed out
-                if (SOFT_TIMER_SINGLE_SHOT == tim->type) {
-                    tim->is_timed_out = true;
-                    // check if callback is set and also check again terminating request, because it can be set inside
-                    // the interrupt routine
-                    if ((0 == tim->terminating_req) && (NULL != tim->callback)) {
-                        tim->callback();
-                    }
-                    // remove from pool
-                    soft_timers_pool[i] = NULL;
-                } else {
-                    // continuous timer
-                    if (NULL != tim->callback) {
-                        tim->is_timed_out = true;
-                        tim->callback();
-                    }
-                    tim->is_timed_out = false;
-                    tim->last_count = (uint32_t)st_get_ticks();
-                }
+    const uint32_t now = (uint32_t)st_get_ticks();
+
+    remove_terminated();
+
+    // only the root needs to be checked, the rest of timers expire later
+    while ((NULL != heapRoot) && (false == is_before(now, heapRoot->expiry_count))) {
+        soft_timer_descr* const tim = heapRoot;
+        heap_remove(tim);
+        tim->is_timed_out = true;
+
+        // check terminating request just before the callback, because it can be set inside the interrupt routine
+        if ((0 == tim->terminating_req) && (NULL != tim->callback)) {
+            tim->callback();
+        }
+
+        // continuous timer starts again unless it was terminated or restarted by the callback
+        if ((SOFT_TIMER_CONTINUOUS == tim->type) && (0 == tim->terminating_req) && (false == tim->is_linked)) {
+            tim->is_timed_out = false;
+            tim->last_count = tim->expiry_count;
+            tim->expiry_count += tim->time_out_ticks;
+            if (false == is_before(now, tim->expiry_count)) {
+                // polled too late, skip missed events
+                tim->last_count = now;
+                tim->expiry_count = now + tim->time_out_ticks;
             }
+            heap_insert(tim);
         }
     }
 }
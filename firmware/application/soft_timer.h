@@ -11,6 +11,11 @@
  * @note This is the software timer, and is doesn't guarantee precision timing. It only guarantees that call callback
  * function will be called on timer's timed out event not earlier than specified ticks.
  *
+ * Running timers are linked into the pairing heap ordered by the expiry tick, so polling checks only the root of the
+ * heap and number of timers is not limited. Starting takes constant time, removing of the timer logarithmic
+ * (amortized). Timers are linked through their descriptors, so descriptor of running timer must stay valid. Functions
+ * of this module must be called from the main loop only, interrupts can only set terminating_req of the timer. Such
+ * timers are removed by the next poll, which searches the whole heap for them.
  */
 
 
@@ -28,11 +33,22 @@ typedef enum {
 /**
  * Descriptor of software timer.
  */
-typedef struct {
+typedef struct soft_timer_descr_s {
     /// Hardware counter value set during timer's start event.
     uint32_t            last_count;
     /// Ticks to timer's timed out event.
     uint32_t            time_out_ticks;
+    /// Hardware counter value of the next timed out event.
+    uint32_t            expiry_count;
+    /// Start order, timers of equal expiry time out in order of their start
+    uint32_t            start_seq;
+    /// Links in the heap of running timers: parent (for the first child) or previous sibling, the first child, next
+    /// sibling
+    struct soft_timer_descr_s* heap_prev;
+    struct soft_timer_descr_s* heap_child;
+    struct soft_timer_descr_s* heap_next;
+    /// Is set to true if timer is linked into the heap of running timers
+    bool                is_linked;
     /// The callback function which will be called when timer was timeout.
     soft_timer_callback callback;
     /// Type of timer, see \ref soft_timer_type.
@@ -47,7 +63,7 @@ typedef struct {
 
 /**
  * Registers inside the pool and starts single shot timer. If callback function was specified it will be called if
- * timer times out then the timer will be removed from the pool.
+ * timer times out then the timer will be removed from the pool. Running timer is restarted.
  *
  * @param stim[in]  software timer descriptor to register and start.
  * @param time_out_ticks[in] how many ticks must elapsed until timeout event occur.
@@ -56,6 +72,47 @@ typedef struct {
  */
 bool soft_timer_start_one_shot(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback);
 
+/**
+ * Registers inside the pool and starts continuous timer. The callback function will be called each time when timer
+ * times out, then the timer is started again. Timer stays in the pool until it is cancelled or its terminating_req is
+ * set. Period is kept without drift, timed out events missed by late polling are skipped.
+ *
+ * @param stim[in]  software timer descriptor to register and start.
+ * @param time_out_ticks[in] period of the timer in ticks, must be greater than 0.
+ * @param callback[in]  callback function called when timeout event occurs.
+ * @return true if software timer was registered and started successfully, false otherwise.
+ */
+bool soft_timer_start_continuous(soft_timer_descr* const stim, const systick_t time_out_ticks, soft_timer_callback callback);
+
+/**
+ * Starts again the timer with its last period, type and callback, counting from now.
+ *
+ * @param stim[in] software timer descriptor started before at least once.
+ * @return true if timer was restarted.
+ */
+bool soft_timer_restart(soft_timer_descr* const stim);
+
+/**
+ * Stops the timer and removes it from the pool, its callback is not called.
+ *
+ * @param stim[in] software timer descriptor.
+ * @return true if timer was running.
+ */
+bool soft_timer_cancel(soft_timer_descr* const stim);
+
+/**
+ * Checks if timer is registered inside the pool.
+ */
+bool soft_timer_is_running(const soft_timer_descr* const stim);
+
+/**
+ * Returns number of ticks until the first running timer times out, terminated timers are removed before.
+ *
+ * @param ticks[out] number of ticks, 0 if some timer has already timed out.
+ * @return false if no timer is running.
+ */
+bool soft_timer_get_next_timeout(uint32_t* const ticks);
+
 /**
  * Polls the registered software timers and checks their state and calls callback function if necessary.
  * It must be called periodically.
@@ -1,35 +1,237 @@
 #include <libopencm3/cm3/systick.h>
 #include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
+#include <stddef.h>
 #include "systick_local.h"
+#include "irq_prio.h"
+#include "cpu_stats.h"
 
+/*
+ * Time is counted by SysTick, which runs at the core clock in sleep too (unlike DWT CYCCNT, which stops in WFI). The
+ * time at the start of the current SysTick period is published by the SysTick interrupt at each wrap, in tickless mode
+ * also by st_set_wakeup which restarts the period. Readers add the elapsed part of the period computed from the
+ * current value of SysTick. Writers fill the unused one of two copies and then switch to it, so readers of any priority
+ * need no lock: they repeat the read if a new period was published meanwhile. A wrap which the SysTick interrupt has
+ * not accounted yet (it's pending, or preempted by the reader before publishing) is added by the reader. The reader
+ * can't tell from the state of the memory whether the active SysTick interrupt is about to publish or it is about to
+ * return, so the interrupt pends PendSV, which marks its period as handled after it returned (see handledNo).
+ */
 
+/// State of SysTick at the start of its period
+typedef struct {
+    uint64_t cycles;    ///< core cycles since \ref st_init
+    uint32_t ticks;     ///< ticks since \ref st_init
+    uint32_t phase;     ///< cycles since the start of the current tick
+    uint32_t len;       ///< length of the period in cycles (reload value + 1)
+} st_period;
+
+#if 1 != SYSTICK_TICKLESS
 static volatile systick_t counter;
 static volatile systick_t delay_ms_cnt;
+#endif
+/// Called on each tick
+static volatile st_tick_callback tickCallback = NULL;
+/// Number of core cycles per microsecond
+static uint32_t cyclesPerUs = 1;
+/// Number of core cycles per tick
+static uint32_t cyclesPerTick = 1;
+/// The current period and the previous one, the current is periods[periodNo & 1]
+static st_period periods[2];
+/// Number of periods published since \ref st_init
+static uint32_t periodNo = 0;
+/**
+ * Equals periodNo, except from the publish by SysTick interrupt until PendSV which follows it. The SysTick interrupt
+ * is active and hasn't published its period yet only while they are equal. PendSV has the priority of SysTick, so it
+ * runs after the interrupt returned and before the next one.
+ */
+static volatile uint32_t handledNo = 0;
+
+/**
+ * Publishes the period which starts given number of cycles after the start of the current one. Called by SysTick
+ * interrupt or with it masked.
+ */
+static void period_publish(const uint32_t elapsed, const uint32_t len) {
+    const st_period* const cur = &periods[periodNo & 1];
+    st_period* const next = &periods[(periodNo + 1) & 1];
+    const uint32_t phase = cur->phase + elapsed;
+    next->cycles = cur->cycles + elapsed;
+    next->ticks = cur->ticks + (phase / cyclesPerTick);
+    next->phase = phase % cyclesPerTick;
+    next->len = len;
+    __atomic_store_n(&periodNo, periodNo + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Reads the current period and the number of cycles elapsed since its start. Can be called from any interrupt.
+ * @return true if SysTick wrapped at the end of the current period and the wrap was not accounted yet
+ */
+static bool period_now(st_period* const period, uint32_t* const elapsed) {
+    for (;;) {
+        const uint32_t no = __atomic_load_n(&periodNo, __ATOMIC_ACQUIRE);
+        *period = periods[no & 1];
+        uint32_t value = systick_get_value();
+        uint32_t wraps = 0;
+        if (0 != (SCB_ICSR & SCB_ICSR_PENDSTSET)) {
+            // the value could be read before the wrap
+            value = systick_get_value();
+            ++wraps;
+        }
+        if ((0 != (SCB_SHCSR & SCB_SHCSR_SYSTICKACT)) && (no == handledNo)) {
+            // SysTick interrupt is preempted by the caller (or it is the caller) and didn't publish the period yet
+            ++wraps;
+        }
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        if (no == __atomic_load_n(&periodNo, __ATOMIC_ACQUIRE)) {
+            // the value counts down from len - 1 to 0, it is 0 at the moment of wrap
+            *elapsed = (wraps * period->len) + ((0 == value) ? 0 : (period->len - value));
+            return (wraps > 0);
+        }
+    }
+}
 
 void sys_tick_handler(void) {
+    // the period ended by the wrap is published first, so the time read by everything below is consistent
+    period_publish(periods[periodNo & 1].len, systick_get_reload() + 1);
+    SCB_ICSR = SCB_ICSR_PENDSVSET;
+
+    cpu_stats_ctx stats;
+    cpu_stats_enter(&stats);
+
+#if 1 != SYSTICK_TICKLESS
     ++counter;
     if (delay_ms_cnt > 0) {
         --delay_ms_cnt;
     }
+#endif
+    if (NULL != tickCallback) {
+        tickCallback();
+    }
+
+    cpu_stats_leave(&stats, CPU_STAT_SYSTICK);
+}
+
+void pend_sv_handler(void) {
+    handledNo = periodNo;
 }
 
 bool st_init(const uint32_t systick_freq, const uint32_t ahb_freq) {
     bool retval = systick_set_frequency(systick_freq, ahb_freq);
+    cyclesPerUs = (ahb_freq >= 1000000) ? (ahb_freq / 1000000) : 1;
+    cyclesPerTick = ((systick_freq > 0) && (ahb_freq >= systick_freq)) ? (ahb_freq / systick_freq) : 1;
+    periods[0].len = systick_get_reload() + 1;
+    nvic_set_priority(NVIC_SYSTICK_IRQ, IRQ_PRIO_SYSTICK);
+    nvic_set_priority(NVIC_PENDSV_IRQ, IRQ_PRIO_SYSTICK);
     systick_interrupt_enable();
+    // the first period starts at 0
+    systick_clear();
     /* Start counting. */
     systick_counter_enable();
     return retval;
 }
 
+void st_register_tick_callback(st_tick_callback callback) {
+    tickCallback = callback;
+}
+
 systick_t st_get_ticks(void) {
+#if 1 == SYSTICK_TICKLESS
+    // SysTick interrupt doesn't come on each tick, ticks are derived from the current period
+    st_period period;
+    uint32_t elapsed;
+    period_now(&period, &elapsed);
+    return (systick_t)(period.ticks + ((period.phase + elapsed) / cyclesPerTick));
+#else
     return counter;
+#endif
+}
+
+uint32_t st_get_cycles(void) {
+    return (uint32_t)st_get_cycles64();
+}
+
+uint64_t st_get_cycles64(void) {
+    st_period period;
+    uint32_t elapsed;
+    period_now(&period, &elapsed);
+    return period.cycles + elapsed;
+}
+
+uint64_t st_get_time_us(void) {
+    return st_cycles_to_us(st_get_cycles64());
+}
+
+uint64_t st_cycles_to_us(const uint64_t cycles) {
+    return cycles / cyclesPerUs;
+}
+
+uint32_t st_cycles_to_ns(const uint32_t cycles) {
+    if (cycles > (UINT32_MAX / 1000)) {
+        return UINT32_MAX;
+    }
+    return (cycles * 1000) / cyclesPerUs;
 }
 
 uint32_t st_get_time_duration(const systick_t start_time_point) {
-    return (uint32_t)((uint32_t)counter - (uint32_t)start_time_point);
+    return (uint32_t)((uint32_t)st_get_ticks() - (uint32_t)start_time_point);
 }
 
 void st_delay_ms(uint32_t delay) {
+#if 1 == SYSTICK_TICKLESS
+    const uint64_t end = st_get_cycles64() + ((uint64_t)delay * 1000 * cyclesPerUs);
+    while (st_get_cycles64() < end) {;}
+#else
     delay_ms_cnt = delay;
     while (delay_ms_cnt > 0) {;}
+#endif
+}
+
+#if 1 == SYSTICK_TICKLESS
+void st_set_wakeup(const uint32_t ticks_from_now) {
+    // SysTick counter has 24 bits, longer sleep is split into several wakeups. The shortest period must be longer than
+    // the longest interrupt handler of higher priority, so that no wrap is missed while SysTick interrupt waits.
+    enum {MAX_LEN = 0x01000000};
+    const uint32_t minLen = cyclesPerTick / 4;
+
+    const uint32_t mask = irq_mask_from(IRQ_PRIO_SYSTICK);
+    st_period period;
+    uint32_t elapsed;
+    const bool wrapped = period_now(&period, &elapsed);
+
+    // wake up exactly at the start of the tick, not after full tick counted from now
+    uint64_t len = minLen;
+    if (ticks_from_now > 0) {
+        const uint32_t tickLeft = cyclesPerTick - ((period.phase + elapsed) % cyclesPerTick);
+        len = ((uint64_t)(ticks_from_now - 1) * cyclesPerTick) + tickLeft;
+        if (len > MAX_LEN) {
+            len = MAX_LEN;
+        } else if (len < minLen) {
+            len = minLen;
+        }
+    }
+
+    // cycles lost between reading of SysTick and its restart are not counted, so it is restarted only when the wake-up
+    // moves: as soon as possible means any wake-up in the minimal period
+    const uint32_t periodLeft = (false == wrapped) ? (period.len - elapsed) : 0;
+    if ((0 == ticks_from_now) ? (periodLeft > minLen) : (periodLeft != len)) {
+        uint32_t value = systick_get_value();
+        uint32_t wraps = 0;
+        if (0 != (SCB_ICSR & SCB_ICSR_PENDSTSET)) {
+            value = systick_get_value();
+            wraps = 1;
+        }
+        systick_set_reload((uint32_t)len - 1);
+        // writing to the current value register restarts counting from the new reload value, no wrap is signaled
+        systick_clear();
+        const bool pending = (0 != (SCB_ICSR & SCB_ICSR_PENDSTSET));
+        SCB_ICSR = SCB_ICSR_PENDSTCLR;
+        elapsed = (wraps * period.len) + ((0 == value) ? 0 : (period.len - value));
+        period_publish(elapsed, (uint32_t)len);
+        handledNo = periodNo;
+        if ((true == pending) && (NULL != tickCallback)) {
+            // the wrap was accounted here, its interrupt won't come
+            tickCallback();
+        }
+    }
+    irq_unmask(mask);
 }
+#endif
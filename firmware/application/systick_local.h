@@ -4,10 +4,20 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/**
+ * If set to 1, SysTick interrupt doesn't come on each tick but when the next software timer times out (see \ref
+ * st_set_wakeup), at least once per 2^24 core cycles. Ticks are derived from the current value of SysTick then.
+ */
+#ifndef SYSTICK_TICKLESS
+#define SYSTICK_TICKLESS 0
+#endif
 
 /// Type that represents current local ticks counted by SysTick handler.
 typedef sig_atomic_t systick_t;
 
+/// Type of function called inside SysTick interrupt on each tick, or on each wakeup in tickless mode.
+typedef void (*st_tick_callback)(void);
+
 /// Type of function that returns local value of counter incremented by SysTick interrupt handler.
 typedef systick_t (*st_get_ticks_t)(void);
 
@@ -19,13 +29,54 @@ typedef systick_t (*st_get_ticks_t)(void);
  */
 bool st_init(const uint32_t systick_freq, const uint32_t ahb_freq);
 
+/**
+ * Registers function called inside SysTick interrupt on each tick. Can be NULL to unregister.
+ */
+void st_register_tick_callback(st_tick_callback callback);
+
 /**
  * Returns local value of counter incremented by SysTick interrupt handler.
  */
 systick_t st_get_ticks(void);
 
+/**
+ * Returns value of the core cycle counter started by \ref st_init. It wraps around each 2^32 cycles. The counter is
+ * derived from SysTick, which runs in sleep too (DWT CYCCNT stops in WFI). Can be called from any interrupt.
+ */
+uint32_t st_get_cycles(void);
+
+/**
+ * Returns 64 bits monotonic core cycle counter, it doesn't overflow in practice. Can be called from any interrupt.
+ */
+uint64_t st_get_cycles64(void);
+
+/**
+ * Returns 64 bits monotonic time in us since \ref st_init.
+ */
+uint64_t st_get_time_us(void);
+
+/**
+ * Converts number of core cycles to us.
+ */
+uint64_t st_cycles_to_us(const uint64_t cycles);
+
+/**
+ * Converts number of core cycles to ns.
+ * @return UINT32_MAX if result does not fit into 32 bits
+ */
+uint32_t st_cycles_to_ns(const uint32_t cycles);
+
 uint32_t st_get_time_duration(const systick_t start_time_point);
 
 void st_delay_ms(uint32_t delay);
 
+#if 1 == SYSTICK_TICKLESS
+/**
+ * Programs SysTick interrupt to come at the start of given tick. The interrupt keeps coming with the same period until
+ * programmed again.
+ * @param ticks_from_now number of ticks to wake up after, 0 means as soon as possible
+ */
+void st_set_wakeup(const uint32_t ticks_from_now);
+#endif
+
 #endif // SYSTICK_LOCAL_H_
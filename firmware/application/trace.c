@@ -0,0 +1,69 @@
+#include "trace.h"
+#include "systick_local.h"
+
+#if 1 == TRACE_ENABLED
+
+/*
+ * Records are written from all interrupts including the IR timer, which must never be masked. A writer reserves its
+ * record by atomic increment of writeSeq (LDREX/STREX) and fills it then; a writer preempted meanwhile is resumed and
+ * completes its record before the main loop, the only reader, runs again.
+ */
+
+/// Ring buffer of records
+static trace_record records[TRACE_RECORDS_NO];
+/// Sequence number of the next written record, it indexes the ring buffer modulo TRACE_RECORDS_NO
+static uint32_t writeSeq = 0;
+/// Is set to false when tracing is paused
+static volatile bool enabled = true;
+
+/// Returns sequence number of the oldest stored record when nextSeq is the next one
+static inline uint32_t oldest_seq(const uint32_t nextSeq) {
+    return (nextSeq > TRACE_RECORDS_NO) ? (nextSeq - TRACE_RECORDS_NO) : 0;
+}
+
+void trace_write(const trace_event event, const uint16_t arg) {
+    if (false == enabled) {
+        return;
+    }
+
+    const uint32_t cycles = st_get_cycles();
+    const uint32_t seq = __atomic_fetch_add(&writeSeq, 1, __ATOMIC_RELAXED);
+    trace_record* const rec = &records[seq & (TRACE_RECORDS_NO - 1)];
+    rec->cycles = cycles;
+    rec->event = (uint8_t)event;
+    rec->reserved = 0;
+    rec->arg = arg;
+}
+
+void trace_enable(const bool enable) {
+    enabled = enable;
+}
+
+uint32_t trace_get_oldest_seq(void) {
+    return oldest_seq(__atomic_load_n(&writeSeq, __ATOMIC_RELAXED));
+}
+
+uint32_t trace_get_next_seq(void) {
+    return __atomic_load_n(&writeSeq, __ATOMIC_RELAXED);
+}
+
+bool trace_read(uint32_t* const seq, trace_record* const record) {
+    for (;;) {
+        const uint32_t nextSeq = __atomic_load_n(&writeSeq, __ATOMIC_ACQUIRE);
+        if (*seq < oldest_seq(nextSeq)) {
+            // overwritten meanwhile
+            *seq = oldest_seq(nextSeq);
+        }
+        if (*seq >= nextSeq) {
+            return false;
+        }
+        *record = records[*seq & (TRACE_RECORDS_NO - 1)];
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        // the copy is valid unless interrupts wrote over the record while it was copied
+        if (*seq >= oldest_seq(__atomic_load_n(&writeSeq, __ATOMIC_ACQUIRE))) {
+            return true;
+        }
+    }
+}
+
+#endif // TRACE_ENABLED
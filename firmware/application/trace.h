@@ -0,0 +1,89 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file Trace of hot path events in RAM.
+ *
+ * Records of fixed size (timestamp in core cycles, event, argument) are written into the ring buffer, the oldest ones
+ * are overwritten. The buffer is read out by the host command, see tools/trace_timeline.py.
+ */
+
+/// Set to 0 to remove tracing from the build
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+/// Number of records inside the ring buffer, must be power of 2
+#define TRACE_RECORDS_NO 256
+
+/// Traced events
+typedef enum {
+    TRACE_IR_START_PULSE = 1,   ///< start pulse issued to the DMM
+    TRACE_IR_DMM_READY,         ///< EXTI: DMM is ready to transmit
+    TRACE_IR_BYTE,              ///< byte received in tim2_isr, arg: byte number
+    TRACE_IR_TIMEOUT,           ///< DMM didn't respond
+    TRACE_IR_DONE,              ///< end of reading observed by main loop, arg: ir_itf_state_type
+    TRACE_PKT_BUILT,            ///< packet built, arg: USB channel
+    TRACE_USB_EP_WRITE,         ///< packet handed to endpoint, arg: length, bit 15 set on failure, bits 8-14 channel
+} trace_event;
+
+/// Record of the trace
+typedef struct {
+    uint32_t cycles;    ///< core cycle counter
+    uint8_t  event;     ///< \ref trace_event
+    uint8_t  reserved;
+    uint16_t arg;       ///< argument of the event
+} trace_record;
+
+#if 1 == TRACE_ENABLED
+
+/// Writes the record, can be called from any interrupt
+void trace_write(const trace_event event, const uint16_t arg);
+
+/// Enables or disables writing of records, e.g. to read out consistent content
+void trace_enable(const bool enable);
+
+/**
+ * Reads the record. Must be called from the main loop only.
+ * @param seq[in,out] sequence number of the record, increased to the oldest record still stored if it was overwritten
+ * @param[out] record read record
+ * @return false if there is no record of given sequence number yet
+ */
+bool trace_read(uint32_t* const seq, trace_record* const record);
+
+/// Returns sequence number of the oldest stored record
+uint32_t trace_get_oldest_seq(void);
+
+/// Returns sequence number of the next written record
+uint32_t trace_get_next_seq(void);
+
+#define TRACE(event, arg) trace_write((event), (uint16_t)(arg))
+
+#else
+
+static inline void trace_enable(const bool enable) {
+    (void)enable;
+}
+
+static inline bool trace_read(uint32_t* const seq, trace_record* const record) {
+    (void)seq;
+    (void)record;
+    return false;
+}
+
+static inline uint32_t trace_get_oldest_seq(void) {
+    return 0;
+}
+
+static inline uint32_t trace_get_next_seq(void) {
+    return 0;
+}
+
+#define TRACE(event, arg) do {} while (0)
+
+#endif // TRACE_ENABLED
+
+#endif //TRACE_H_
@@ -1,17 +1,26 @@
 #include <libopencm3/usb/usbd.h>
 #include <libopencm3/usb/cdc.h>
+#include <libopencm3/stm32/st_usbfs.h>
 #include <libopencm3/stm32/gpio.h>
+#include <libopencm3/cm3/nvic.h>
 #include <stddef.h>
+#include <string.h>
 
 #include "usb_cdc_dev.h"
+#include "irq_prio.h"
+#include "systick_local.h"
+#include "cpu_stats.h"
+#include "op_stats.h"
+#include "trace.h"
 
 static const struct usb_device_descriptor dev = {
     .bLength = USB_DT_DEVICE_SIZE,
     .bDescriptorType = USB_DT_DEVICE,
     .bcdUSB = 0x0200,
-    .bDeviceClass = USB_CLASS_CDC,
-    .bDeviceSubClass = 0,
-    .bDeviceProtocol = 0,
+    // composite device with Interface Association Descriptor
+    .bDeviceClass = USB_CLASS_MISCELLANEOUS,
+    .bDeviceSubClass = 2,
+    .bDeviceProtocol = 1,
     .bMaxPacketSize0 = CDC_DATA_BUFFER_LEN,
     .idVendor = 0x0483,
     .idProduct = 0x5740,
@@ -122,12 +131,64 @@ static const struct usb_interface_descriptor data_iface[] = {{
 }};
 
 
+/// Groups CDC interfaces into one function of the composite device
+static const struct usb_iface_assoc_descriptor cdc_iface_assoc = {
+    .bLength = USB_DT_INTERFACE_ASSOCIATION_SIZE,
+    .bDescriptorType = USB_DT_INTERFACE_ASSOCIATION,
+    .bFirstInterface = 0,
+    .bInterfaceCount = 2,
+    .bFunctionClass = USB_CLASS_CDC,
+    .bFunctionSubClass = USB_CDC_SUBCLASS_ACM,
+    .bFunctionProtocol = USB_CDC_PROTOCOL_AT,
+    .iFunction = 0,
+};
+
+
+/*
+ * Vendor specific interface carries the same packets as CDC data interface, but without the tty layer on the host.
+ */
+static const struct usb_endpoint_descriptor vnd_endp[] = {{
+    .bLength = USB_DT_ENDPOINT_SIZE,
+    .bDescriptorType = USB_DT_ENDPOINT,
+    .bEndpointAddress = VND_DATA_IN_EP,
+    .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+    .wMaxPacketSize = VND_CMD_BUFFER_LEN,
+    .bInterval = 1,
+}, {
+    .bLength = USB_DT_ENDPOINT_SIZE,
+    .bDescriptorType = USB_DT_ENDPOINT,
+    .bEndpointAddress = VND_DATA_OUT_EP,
+    .bmAttributes = USB_ENDPOINT_ATTR_BULK,
+    .wMaxPacketSize = VND_DATA_BUFFER_LEN,
+    .bInterval = 1,
+}};
+
+
+static const struct usb_interface_descriptor vnd_iface[] = {{
+    .bLength = USB_DT_INTERFACE_SIZE,
+    .bDescriptorType = USB_DT_INTERFACE,
+    .bInterfaceNumber = 2,
+    .bAlternateSetting = 0,
+    .bNumEndpoints = 2,
+    .bInterfaceClass = USB_CLASS_VENDOR,
+    .bInterfaceSubClass = 0,
+    .bInterfaceProtocol = 0,
+    .iInterface = 0,
+
+    .endpoint = vnd_endp,
+}};
+
+
 static const struct usb_interface ifaces[] = {{
     .num_altsetting = 1,
+    .iface_assoc = &cdc_iface_assoc,
     .altsetting = comm_iface,
 }, {
     .num_altsetting = 1,
     .altsetting = data_iface,
+}, {
+    .num_altsetting = 1,
+    .altsetting = vnd_iface,
 }};
 
 
@@ -135,7 +196,7 @@ static const struct usb_config_descriptor config = {
     .bLength = USB_DT_CONFIGURATION_SIZE,
     .bDescriptorType = USB_DT_CONFIGURATION,
     .wTotalLength = 0,
-    .bNumInterfaces = 2,
+    .bNumInterfaces = 3,
     .bConfigurationValue = 1,
     .iConfiguration = 0,
     .bmAttributes = 0x80,
@@ -157,6 +218,244 @@ uint8_t usbd_control_buffer[128];
 static void internal_cdcacm_data_rx_cb(usbd_device *usbd_dev, uint8_t ep);
 static usbd_endpoint_callback rxCallBack = internal_cdcacm_data_rx_cb;
 
+/// USB device handle, required to write packets from TX ring buffers
+static usbd_device* usbDev = NULL;
+
+/**
+ * TX ring buffer of one channel. Slots from tail up to head (exclusive) are closed and wait for transmission, slot
+ * pointed by head is open and is being filled by subsequent writes until the endpoint becomes free.
+ */
+typedef struct {
+    uint8_t             buff[CDC_TX_SLOTS_NO][CDC_DATA_BUFFER_LEN];
+    uint8_t             len[CDC_TX_SLOTS_NO];
+    uint8_t             head;
+    uint8_t             tail;
+    /// Number of packets handed to the endpoint and not yet read by the host
+    uint8_t             inFlight;
+    /// Length of space reserved at the end of the open slot, the open slot can not be closed while it is not 0
+    uint8_t             reserved;
+    /// Number of writes rejected because of the full ring
+    uint32_t            overruns;
+    /// Number of bytes committed since start
+    uint32_t            committedBytes;
+    /// Number of bytes handed to the endpoint since start
+    uint32_t            writtenBytes;
+} tx_ring;
+
+/// Type of function which hands the packet to the endpoint of the channel
+typedef bool (*ep_write_func)(const uint8_t* const data, const uint8_t len);
+
+static tx_ring txRings[USB_CH_NO];
+
+#if 1 == CDC_DATA_TX_DOUBLE_BUFFERED
+
+/// Number of packets which can be handed to the endpoint at once
+#define CDC_DATA_TX_BUFFERS_NO 2
+/// Endpoint number (register index) of CDC_DATA_OUT_EP
+#define CDC_DATA_OUT_EP_NO (CDC_DATA_OUT_EP & 0x0F)
+/**
+ * Address of the second transmission buffer of CDC_DATA_OUT_EP in the packet memory. libopencm3 allocates buffers from
+ * the bottom of 512 bytes long packet memory (BTABLE, control endpoint, CDC and vendor endpoints take 0x1A0 bytes), so
+ * the last CDC_DATA_BUFFER_LEN bytes are free.
+ */
+#define CDC_DATA_TX_BUF1_PMA_ADDR (512 - CDC_DATA_BUFFER_LEN)
+
+/// Accesses 16-bit word of the packet memory at given packet memory address (F1 maps each word at 32-bit boundary)
+#define PMA_WORD(pm_addr) MMIO32(USB_PMA_BASE + ((pm_addr) * 2))
+/// Fields of BTABLE entry of double-buffered IN endpoint
+#define BTABLE_ADDR_TX_0(ep)    PMA_WORD(*USB_BTABLE_REG + ((ep) * 8) + 0)
+#define BTABLE_COUNT_TX_0(ep)   PMA_WORD(*USB_BTABLE_REG + ((ep) * 8) + 2)
+#define BTABLE_ADDR_TX_1(ep)    PMA_WORD(*USB_BTABLE_REG + ((ep) * 8) + 4)
+#define BTABLE_COUNT_TX_1(ep)   PMA_WORD(*USB_BTABLE_REG + ((ep) * 8) + 6)
+/// For double-buffered IN endpoint DTOG_RX bit is used as SW_BUF - the buffer which is owned by the application
+#define USB_EP_TX_SW_BUF USB_EP_RX_DTOG
+
+/**
+ * Writes endpoint register. Toggle bits are written as 0 (no change) unless set in toggle_bits and CTR bits are written
+ * as 1 (no change).
+ */
+static void ep_reg_write(const uint8_t ep, const uint32_t bits, const uint32_t toggle_bits) {
+    const uint32_t reg = *USB_EP_REG(ep);
+    *USB_EP_REG(ep) = (reg & USB_EP_NTOGGLE_MSK & ~(USB_EP_KIND)) | USB_EP_RX_CTR | USB_EP_TX_CTR | bits | toggle_bits;
+}
+
+/// Copies data into the packet memory
+static void pma_write(const uint16_t pm_addr, const uint8_t* const data, const uint8_t len) {
+    volatile uint32_t* pDst = &PMA_WORD(pm_addr);
+    for (uint8_t i = 0; i < len; i += 2) {
+        const uint16_t hi = (uint16_t)((i + 1) < len ? data[i + 1] : 0);
+        *pDst++ = (uint32_t)(data[i] | (hi << 8));
+    }
+}
+
+/**
+ * Switches CDC_DATA_OUT_EP, already configured by libopencm3, into double-buffered mode. libopencm3 sets its
+ * ADDR_TX, which becomes ADDR_TX_0.
+ */
+static void cdc_data_ep_setup_double_buffer(void) {
+    const uint32_t reg = *USB_EP_REG(CDC_DATA_OUT_EP_NO);
+
+    BTABLE_ADDR_TX_1(CDC_DATA_OUT_EP_NO) = CDC_DATA_TX_BUF1_PMA_ADDR;
+    BTABLE_COUNT_TX_0(CDC_DATA_OUT_EP_NO) = 0;
+    BTABLE_COUNT_TX_1(CDC_DATA_OUT_EP_NO) = 0;
+
+    // EP_KIND selects double-buffering, DTOG_TX and SW_BUF must be equal (no buffer is ready) and STAT_TX must be VALID.
+    // With DTOG_TX equal to SW_BUF the endpoint NAKs until the application fills the buffer and toggles SW_BUF.
+    ep_reg_write(CDC_DATA_OUT_EP_NO, USB_EP_KIND,
+                 (reg & (USB_EP_TX_DTOG | USB_EP_TX_SW_BUF)) | ((reg ^ USB_EP_TX_STAT_VALID) & USB_EP_TX_STAT));
+}
+
+/// Writes packet into the buffer owned by the application and hands it to the endpoint
+static bool cdc_data_ep_write(const uint8_t* const data, const uint8_t len) {
+    const uint32_t reg = *USB_EP_REG(CDC_DATA_OUT_EP_NO);
+
+    if (0 == (reg & USB_EP_TX_SW_BUF)) {
+        pma_write((uint16_t)BTABLE_ADDR_TX_0(CDC_DATA_OUT_EP_NO), data, len);
+        BTABLE_COUNT_TX_0(CDC_DATA_OUT_EP_NO) = len;
+    } else {
+        pma_write((uint16_t)BTABLE_ADDR_TX_1(CDC_DATA_OUT_EP_NO), data, len);
+        BTABLE_COUNT_TX_1(CDC_DATA_OUT_EP_NO) = len;
+    }
+    // toggling SW_BUF gives the buffer to the USB peripheral
+    ep_reg_write(CDC_DATA_OUT_EP_NO, USB_EP_KIND, USB_EP_TX_SW_BUF);
+    return true;
+}
+
+/**
+ * Returns number of buffers of CDC_DATA_OUT_EP which still wait for the host, called when a transmission completed.
+ * Completions of both buffers may be reported by a single callback, so they are not counted. DTOG_TX (the buffer the
+ * peripheral sends next) differs from SW_BUF while one buffer is pending. Equal bits mean no buffer or both, but both
+ * can't be pending here: a buffer completed since the last write, and no buffer is written while both are in flight.
+ */
+static uint8_t cdc_data_ep_pending(void) {
+    const uint32_t reg = *USB_EP_REG(CDC_DATA_OUT_EP_NO);
+    return ((0 != (reg & USB_EP_TX_DTOG)) != (0 != (reg & USB_EP_TX_SW_BUF))) ? 1 : 0;
+}
+
+#else
+
+/// Number of packets which can be handed to the endpoint at once
+#define CDC_DATA_TX_BUFFERS_NO 1
+
+/// Hands packet to the endpoint
+static bool cdc_data_ep_write(const uint8_t* const data, const uint8_t len) {
+    return (0 != usbd_ep_write_packet(usbDev, CDC_DATA_OUT_EP, data, len));
+}
+
+#endif // CDC_DATA_TX_DOUBLE_BUFFERED
+
+/// Hands packet to the vendor interface's endpoint
+static bool vnd_data_ep_write(const uint8_t* const data, const uint8_t len) {
+    return (0 != usbd_ep_write_packet(usbDev, VND_DATA_OUT_EP, data, len));
+}
+
+/// Frame number and core cycle counter captured at USB Start Of Frame
+typedef struct {
+    uint32_t    cycles;
+    uint16_t    frameNo;
+    bool        valid;
+} sof_capture;
+
+/**
+ * Two copies of the last SOF capture, the current one is selected by lastSofSeq. It is read from the EXTI interrupt,
+ * which must not be masked, so a writer fills the other copy and publishes it by incrementing lastSofSeq. A reader
+ * which preempted the writer reads the published copy, a reader preempted by writers retries when lastSofSeq changed.
+ */
+static sof_capture lastSof[2];
+static uint32_t lastSofSeq = 0;
+
+/// Called when the endpoint accepted data from the TX ring buffer
+static volatile usb_cdc_tx_written_callback txWrittenCallback = NULL;
+
+/// Functions which hand packets to endpoints of channels
+static const ep_write_func epWrite[USB_CH_NO] = {cdc_data_ep_write, vnd_data_ep_write};
+/// Number of packets which can be handed to endpoints of channels at once
+static const uint8_t epBuffersNo[USB_CH_NO] = {CDC_DATA_TX_BUFFERS_NO, 1};
+
+/**
+ * Masks USB interrupt to access TX ring buffers which are shared with it. Interrupts of higher priority (IR timer) still
+ * preempt, they don't access the rings. Returns previous state of the mask.
+ */
+static inline uint32_t tx_ring_lock(void) {
+    return irq_mask_from(IRQ_PRIO_USB);
+}
+
+/// Restores state of interrupts mask returned by \ref tx_ring_lock
+static inline void tx_ring_unlock(const uint32_t mask) {
+    irq_unmask(mask);
+}
+
+/// Returns index of the next slot in TX ring buffer
+static inline uint8_t tx_ring_next(const uint8_t idx) {
+    return (uint8_t)((idx + 1) % CDC_TX_SLOTS_NO);
+}
+
+/// Resets TX ring buffers of all channels, all queued data are lost
+static void tx_rings_reset(void) {
+    for (int ch = 0; ch < USB_CH_NO; ++ch) {
+        tx_ring* const ring = &txRings[ch];
+        ring->head = 0;
+        ring->tail = 0;
+        ring->len[0] = 0;
+        ring->inFlight = 0;
+        ring->reserved = 0;
+        // dropped data are treated as written
+        ring->writtenBytes = ring->committedBytes;
+    }
+}
+
+/// Hands the oldest queued slots of given channel to the endpoint as long as it has free buffers
+static void tx_ring_kick(const usb_channel ch) {
+    if (NULL == usbDev) {
+        return;
+    }
+
+    tx_ring* const ring = &txRings[ch];
+    while (ring->inFlight < epBuffersNo[ch]) {
+        if ((ring->tail == ring->head) && (ring->len[ring->head] > 0) && (0 == ring->reserved)) {
+            // nothing closed but open slot has some data -> close it to send it without waiting for more
+            ring->head = tx_ring_next(ring->head);
+            ring->len[ring->head] = 0;
+        }
+
+        if (ring->tail == ring->head) {
+            break;
+        }
+        const bool written = epWrite[ch](ring->buff[ring->tail], ring->len[ring->tail]);
+        TRACE(TRACE_USB_EP_WRITE, ring->len[ring->tail] | (ch << 8) | ((true == written) ? 0 : 0x8000));
+        if (false == written) {
+            op_stats_add(OP_STAT_USB_WRITE_FAILURES, 1);
+            break;
+        }
+        // data are already copied into the packet memory, the slot can be reused
+        ++ring->inFlight;
+        ring->writtenBytes += ring->len[ring->tail];
+        ring->tail = tx_ring_next(ring->tail);
+        if (NULL != txWrittenCallback) {
+            txWrittenCallback(ch, ring->writtenBytes);
+        }
+    }
+}
+
+/// Called when the host has read the packet from CDC_DATA_OUT_EP or VND_DATA_OUT_EP
+static void data_tx_cb(usbd_device *usbd_dev, uint8_t ep) {
+    (void)usbd_dev;
+
+    const usb_channel ch = usb_cdc_get_channel(ep);
+#if 1 == CDC_DATA_TX_DOUBLE_BUFFERED
+    if (USB_CH_CDC == ch) {
+        txRings[ch].inFlight = cdc_data_ep_pending();
+        tx_ring_kick(ch);
+        return;
+    }
+#endif
+    // single buffer completes once per write
+    if (txRings[ch].inFlight > 0) {
+        --txRings[ch].inFlight;
+    }
+    tx_ring_kick(ch);
+}
+
 
 static int cdcacm_control_request(usbd_device *usbd_dev, struct usb_setup_data *req, uint8_t **buf,
         uint16_t *len, void (**complete)(usbd_device *usbd_dev, struct usb_setup_data *req)) {
@@ -196,23 +495,27 @@ static int cdcacm_control_request(usbd_device *usbd_dev, struct usb_setup_data *
 
 
 static void internal_cdcacm_data_rx_cb(usbd_device *usbd_dev, uint8_t ep) {
-    (void)ep;
-
     char buf[CDC_DATA_BUFFER_LEN];
-    int len = usbd_ep_read_packet(usbd_dev, CDC_DATA_IN_EP, buf, CDC_DATA_BUFFER_LEN);
+    int len = usbd_ep_read_packet(usbd_dev, ep, buf, CDC_DATA_BUFFER_LEN);
 
     if (len) {
-        buf[len] = 0;
-        usbd_ep_write_packet(usbd_dev, CDC_DATA_OUT_EP, buf, len);
+        usb_cdc_write(usb_cdc_get_channel(ep), buf, len);
     }
 }
 
 static void cdcacm_set_config(usbd_device *usbd_dev, uint16_t wValue) {
     (void)wValue;
 
+    tx_rings_reset();
+
     usbd_ep_setup(usbd_dev, CDC_DATA_IN_EP, USB_ENDPOINT_ATTR_BULK, CDC_DATA_BUFFER_LEN, rxCallBack);
-    usbd_ep_setup(usbd_dev, CDC_DATA_OUT_EP, USB_ENDPOINT_ATTR_BULK, CDC_DATA_BUFFER_LEN, NULL);
+    usbd_ep_setup(usbd_dev, CDC_DATA_OUT_EP, USB_ENDPOINT_ATTR_BULK, CDC_DATA_BUFFER_LEN, data_tx_cb);
     usbd_ep_setup(usbd_dev, CDC_COMM_EP, USB_ENDPOINT_ATTR_INTERRUPT, 16, NULL);
+    usbd_ep_setup(usbd_dev, VND_DATA_IN_EP, USB_ENDPOINT_ATTR_BULK, VND_CMD_BUFFER_LEN, rxCallBack);
+    usbd_ep_setup(usbd_dev, VND_DATA_OUT_EP, USB_ENDPOINT_ATTR_BULK, VND_DATA_BUFFER_LEN, data_tx_cb);
+#if 1 == CDC_DATA_TX_DOUBLE_BUFFERED
+    cdc_data_ep_setup_double_buffer();
+#endif
 
     usbd_register_control_callback(
                 usbd_dev,
@@ -228,10 +531,76 @@ usbd_device* usb_cdc_init(void) {
     if (NULL != usbd_dev) {
         // register internal callbacks
         usbd_register_set_config_callback(usbd_dev, cdcacm_set_config);
+
+        // from now the USB device is serviced by the interrupt
+        usbDev = usbd_dev;
+        nvic_set_priority(NVIC_USB_LP_CAN_RX0_IRQ, IRQ_PRIO_USB);
+        nvic_enable_irq(NVIC_USB_LP_CAN_RX0_IRQ);
+#if 1 == CDC_DATA_TX_DOUBLE_BUFFERED
+        nvic_set_priority(NVIC_USB_HP_CAN_TX_IRQ, IRQ_PRIO_USB);
+        nvic_enable_irq(NVIC_USB_HP_CAN_TX_IRQ);
+#endif
     }
     return usbd_dev;
 }
 
+/// Publishes new SOF capture, called from the USB interrupt or with it masked, so writers don't preempt each other
+static void sof_publish(const uint32_t cycles, const uint16_t frameNo, const bool valid) {
+    const uint32_t seq = lastSofSeq + 1;
+    sof_capture* const next = &lastSof[seq & 1];
+
+    next->cycles = cycles;
+    next->frameNo = frameNo;
+    next->valid = valid;
+    __atomic_store_n(&lastSofSeq, seq, __ATOMIC_RELEASE);
+}
+
+/**
+ * Called at each USB Start Of Frame when enabled. Latency of the USB interrupt (usually a few us) is added to the
+ * captured cycles.
+ */
+static void usb_sof_cb(void) {
+    sof_publish(st_get_cycles(), (uint16_t)(*USB_FNR_REG & USB_FNR_FN), true);
+}
+
+void usb_cdc_enable_sof_capture(const bool enable) {
+    if (NULL == usbDev) {
+        return;
+    }
+
+    const uint32_t mask = irq_mask_from(IRQ_PRIO_USB);
+    if (true == enable) {
+        usbd_register_sof_callback(usbDev, usb_sof_cb);
+        SET_REG(USB_CNTR_REG, GET_REG(USB_CNTR_REG) | USB_CNTR_SOFM);
+    } else {
+        SET_REG(USB_CNTR_REG, GET_REG(USB_CNTR_REG) & ~USB_CNTR_SOFM);
+        usbd_register_sof_callback(usbDev, NULL);
+        sof_publish(0, 0, false);
+    }
+    irq_unmask(mask);
+}
+
+bool usb_cdc_get_sof_timestamp(const uint32_t cycles, uint16_t* const frame_no, uint32_t* const offset_cycles) {
+    sof_capture sof;
+
+    uint32_t seq = __atomic_load_n(&lastSofSeq, __ATOMIC_ACQUIRE);
+    for (;;) {
+        sof = lastSof[seq & 1];
+        __atomic_signal_fence(__ATOMIC_SEQ_CST);
+        const uint32_t seqAfter = __atomic_load_n(&lastSofSeq, __ATOMIC_ACQUIRE);
+        if (seqAfter == seq) {
+            break;
+        }
+        seq = seqAfter;
+    }
+
+    if (true == sof.valid) {
+        *frame_no = sof.frameNo;
+        *offset_cycles = cycles - sof.cycles;
+    }
+    return sof.valid;
+}
+
 bool usb_cdc_register_data_in_callback(usbd_endpoint_callback callback) {
     bool retval = false;
     if (NULL != callback) {
@@ -240,3 +609,103 @@ bool usb_cdc_register_data_in_callback(usbd_endpoint_callback callback) {
     }
     return retval;
 }
+
+usb_channel usb_cdc_get_channel(const uint8_t ep) {
+    return ((VND_DATA_OUT_EP == ep) || (VND_DATA_IN_EP == ep)) ? USB_CH_VENDOR : USB_CH_CDC;
+}
+
+void* usb_cdc_tx_reserve(const usb_channel ch, const uint16_t len) {
+    if ((ch >= USB_CH_NO) || (0 == len) || (len > CDC_DATA_BUFFER_LEN) || (txRings[ch].reserved > 0)) {
+        return NULL;
+    }
+
+    tx_ring* const ring = &txRings[ch];
+    void* retval = NULL;
+    const uint32_t mask = tx_ring_lock();
+
+    if ((ring->len[ring->head] + len) > CDC_DATA_BUFFER_LEN) {
+        // data don't fit into open slot -> close it and open next one
+        const uint8_t next = tx_ring_next(ring->head);
+        if (next == ring->tail) {
+            ++ring->overruns;
+        } else {
+            ring->head = next;
+            ring->len[next] = 0;
+        }
+    }
+
+    if ((ring->len[ring->head] + len) <= CDC_DATA_BUFFER_LEN) {
+        ring->reserved = (uint8_t)len;
+        retval = &ring->buff[ring->head][ring->len[ring->head]];
+    }
+
+    tx_ring_unlock(mask);
+    return retval;
+}
+
+void usb_cdc_tx_commit(const usb_channel ch, const uint16_t len) {
+    if (ch >= USB_CH_NO) {
+        return;
+    }
+
+    tx_ring* const ring = &txRings[ch];
+    const uint32_t mask = tx_ring_lock();
+
+    if (len <= ring->reserved) {
+        ring->len[ring->head] += (uint8_t)len;
+        ring->committedBytes += len;
+    }
+    ring->reserved = 0;
+    tx_ring_kick(ch);
+
+    tx_ring_unlock(mask);
+}
+
+bool usb_cdc_write(const usb_channel ch, const void* const data, const uint16_t len) {
+    if (NULL == data) {
+        return false;
+    }
+
+    void* const pDst = usb_cdc_tx_reserve(ch, len);
+    if (NULL == pDst) {
+        return false;
+    }
+
+    memcpy(pDst, data, len);
+    usb_cdc_tx_commit(ch, len);
+    return true;
+}
+
+void usb_cdc_register_tx_written_callback(usb_cdc_tx_written_callback callback) {
+    txWrittenCallback = callback;
+}
+
+uint32_t usb_cdc_get_tx_committed_bytes(const usb_channel ch) {
+    return (ch < USB_CH_NO) ? txRings[ch].committedBytes : 0;
+}
+
+uint32_t usb_cdc_get_tx_overruns(void) {
+    uint32_t retval = 0;
+    for (int ch = 0; ch < USB_CH_NO; ++ch) {
+        retval += txRings[ch].overruns;
+    }
+    return retval;
+}
+
+/// USB low priority interrupt, services all USB events except of isochronous and double-buffered bulk transfers
+void usb_lp_can_rx0_isr(void) {
+    cpu_stats_ctx stats;
+    cpu_stats_enter(&stats);
+    usbd_poll(usbDev);
+    cpu_stats_leave(&stats, CPU_STAT_USB);
+}
+
+#if 1 == CDC_DATA_TX_DOUBLE_BUFFERED
+/// USB high priority interrupt, services correct transfers of double-buffered bulk endpoints
+void usb_hp_can_tx_isr(void) {
+    cpu_stats_ctx stats;
+    cpu_stats_enter(&stats);
+    usbd_poll(usbDev);
+    cpu_stats_leave(&stats, CPU_STAT_USB);
+}
+#endif
@@ -8,9 +8,112 @@
 #define CDC_DATA_OUT_EP 0x82
 #define CDC_DATA_IN_EP 0x01
 #define CDC_COMM_EP 0x83
+/// Number of CDC_DATA_BUFFER_LEN-long slots inside the TX ring buffer of each channel
+#define CDC_TX_SLOTS_NO 8
+
+/// Endpoints of the vendor specific interface. Host sends only commands, so its OUT endpoint is smaller.
+#define VND_DATA_BUFFER_LEN 64
+#define VND_CMD_BUFFER_LEN 16
+#define VND_DATA_OUT_EP 0x84
+#define VND_DATA_IN_EP 0x04
+
+/**
+ * Data channels of the composite device.
+ */
+typedef enum {
+    /// CDC-ACM interface, compatible with Brymen software
+    USB_CH_CDC = 0,
+    /// Vendor specific bulk interface, for software using libusb directly
+    USB_CH_VENDOR,
+    USB_CH_NO
+} usb_channel;
+
+/**
+ * If set to 1 then CDC_DATA_OUT_EP works as double-buffered bulk endpoint: one buffer in the packet memory is filled
+ * while the other is transmitted, so the host doesn't get NAK between subsequent transfers.
+ */
+#ifndef CDC_DATA_TX_DOUBLE_BUFFERED
+#define CDC_DATA_TX_DOUBLE_BUFFERED 1
+#endif
 
 usbd_device* usb_cdc_init(void);
 
+/**
+ * Registers callback called when data from host are received by CDC_DATA_IN_EP or VND_DATA_IN_EP.
+ */
 bool usb_cdc_register_data_in_callback(usbd_endpoint_callback callback);
 
+/**
+ * Returns data channel of given endpoint.
+ */
+usb_channel usb_cdc_get_channel(const uint8_t ep);
+
+/**
+ * Queues data to be sent to the host through given channel. Data written while the endpoint is busy are packed
+ * together into CDC_DATA_BUFFER_LEN-long transfers. Data of one call are never split between two transfers.
+ *
+ * @param ch channel to send data through
+ * @param data pointer to the data to send
+ * @param len length of data, can not be greater than CDC_DATA_BUFFER_LEN
+ * @return true if data was queued, false if there was no space in the TX ring buffer (overrun) or args are invalid
+ */
+bool usb_cdc_write(const usb_channel ch, const void* const data, const uint16_t len);
+
+/**
+ * Reserves space for data at the end of the TX ring buffer of given channel, so data can be built directly in memory
+ * which is handed to the USB peripheral. Space must be released by \ref usb_cdc_tx_commit before next reservation or
+ * write to the same channel.
+ *
+ * @param ch channel to send data through
+ * @param len length of space to reserve, can not be greater than CDC_DATA_BUFFER_LEN
+ * @return pointer to reserved space or NULL if there was no space in the TX ring buffer (overrun) or args are invalid
+ */
+void* usb_cdc_tx_reserve(const usb_channel ch, const uint16_t len);
+
+/**
+ * Queues data written into space returned by \ref usb_cdc_tx_reserve and releases the reservation.
+ *
+ * @param ch channel passed to \ref usb_cdc_tx_reserve
+ * @param len length of written data, 0 cancels the reservation
+ */
+void usb_cdc_tx_commit(const usb_channel ch, const uint16_t len);
+
+/// Returns number of writes rejected because of the full TX ring buffer, summed over all channels
+uint32_t usb_cdc_get_tx_overruns(void);
+
+/**
+ * Type of function called when queued data were handed to the endpoint of given channel.
+ * @param ch channel
+ * @param written_bytes number of bytes handed to the endpoint since start, it wraps around
+ */
+typedef void (*usb_cdc_tx_written_callback)(const usb_channel ch, const uint32_t written_bytes);
+
+/**
+ * Registers function called each time the endpoint accepts data from the TX ring buffer. It is called inside the USB
+ * interrupt or inside \ref usb_cdc_tx_commit. Can be NULL to unregister.
+ */
+void usb_cdc_register_tx_written_callback(usb_cdc_tx_written_callback callback);
+
+/**
+ * Returns number of bytes queued to be sent through given channel since start, it wraps around. Data are handed to the
+ * endpoint when the number passed to \ref usb_cdc_tx_written_callback reaches this value.
+ */
+uint32_t usb_cdc_get_tx_committed_bytes(const usb_channel ch);
+
+/**
+ * Enables or disables capturing of the core cycle counter at each USB Start Of Frame. It costs one interrupt per ms,
+ * so it is enabled only when some host needs timestamps.
+ */
+void usb_cdc_enable_sof_capture(const bool enable);
+
+/**
+ * Converts value of the core cycle counter to the USB bus timeline. Can be called from any interrupt.
+ *
+ * @param cycles value of the core cycle counter, see \ref st_get_cycles
+ * @param[out] frame_no number of the last frame started before (or at) given cycles
+ * @param[out] offset_cycles cycles elapsed since start of that frame
+ * @return false if SOF capture is disabled or no SOF was captured yet
+ */
+bool usb_cdc_get_sof_timestamp(const uint32_t cycles, uint16_t* const frame_no, uint32_t* const offset_cycles);
+
 #endif //USB_CDC_DEV_H_
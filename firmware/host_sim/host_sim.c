@@ -0,0 +1,333 @@
+/*
+ * Host simulator of the adapter.
+ *
+ * The application (../application) is compiled for the host and runs against models of the MCU peripherals, the
+ * Sanwa DMM on the IR interface and the USB host, see sim.h. Virtual time advances only while the application sleeps,
+ * so a scenario of thousands of requests takes a fraction of a second, its result is deterministic and doesn't depend
+ * on the load of the machine.
+ *
+ * Scenario: the host waits until the adapter is ready (USB configured and its startup delay elapsed), then sends
+ * data requests on the CDC interface, each one after the response to the previous one was received (or timed out)
+ * and at least --interval-ms after the previous request. With --stream the adapter is switched into streaming mode
+ * instead and --requests packets are awaited. Latency of each response is measured in the virtual time from sending
+ * the request until the host has read the last byte of the response.
+ *
+ * Usage: host_sim [--requests N] [--interval-ms MS] [--stream] [--wake-us US] [--wake-jitter-us US] [--seed N]
+ *                 [--meter-script FILE] [--in-latency-us US] [--timeout-ms MS] [--max-sim-s S]
+ *                 [--max-p99-us US] [--min-rate HZ]
+ *
+ * Results are printed as key=value lines. Exit code is 1 if some threshold given by --max-p99-us or --min-rate is
+ * violated, 2 if the simulation failed (time limit exceeded, application stuck).
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "sim.h"
+#include "sim_usb.h"
+#include "sanwa_meter.h"
+#include "usb_cdc_dev.h"
+#include "bm_protocol_defs.h"
+
+/// Entry point of the application, renamed by the build
+int app_main(void);
+
+/// Virtual time the adapter needs after the reset before it serves requests (USB enumeration and startup delay)
+#define STARTUP_US 2500000UL
+/// Size of the buffer of bytes received by the host
+#define RX_BUFF_LEN 512
+
+typedef struct {
+    uint32_t requests;
+    uint32_t intervalMs;
+    bool     stream;
+    uint32_t wakeUs;
+    uint32_t wakeJitterUs;
+    uint32_t seed;
+    const char* meterScript;
+    uint32_t inLatencyUs;
+    uint32_t timeoutMs;
+    double   maxSimS;
+    double   maxP99Us;
+    double   minRate;
+} sim_options;
+
+static sim_options opts = {
+    .requests = 1000,
+    .intervalMs = 0,
+    .stream = false,
+    .wakeUs = 2000,
+    .wakeJitterUs = 0,
+    .seed = 1,
+    .meterScript = NULL,
+    .inLatencyUs = 125,
+    .timeoutMs = 3000,
+    .maxSimS = 3600,
+    .maxP99Us = 0,
+    .minRate = 0,
+};
+
+static struct {
+    uint32_t    sent;
+    uint32_t    responses;
+    uint32_t    lost;
+    uint32_t    badPackets;
+    uint64_t    firstSent;
+    uint64_t    lastSent;
+    uint64_t    lastResponse;
+    bool        waiting;
+    double*     latencies;
+    uint8_t     rxBuff[RX_BUFF_LEN];
+    size_t      rxLen;
+    sim_timer   timer;
+    struct timespec wallStart;
+} host;
+
+
+static void send_request(void* ctx);
+
+static double wall_seconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - host.wallStart.tv_sec) + (double)(now.tv_nsec - host.wallStart.tv_nsec) * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    const double da = *(const double*)a;
+    const double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+/// Returns the percentile of sorted values, nearest rank method
+static double percentile(const double* const values, const uint32_t n, const double p) {
+    uint32_t rank = (uint32_t)((p / 100.0) * n + 0.999999);
+    rank = (rank < 1) ? 1 : ((rank > n) ? n : rank);
+    return values[rank - 1];
+}
+
+/// Prints the report and ends the simulation
+static void finish(void) {
+    const double wall = wall_seconds();
+    const double simS = (double)sim_now() / SIM_CORE_HZ;
+    const uint64_t span = host.lastResponse - host.firstSent;
+    const double rate = (span > 0) ? (double)host.responses * SIM_CORE_HZ / (double)span : 0.0;
+    int exitCode = 0;
+
+    printf("sim_time_s=%.6f\n", simS);
+    printf("requests=%u\n", host.sent);
+    printf("responses=%u\n", host.responses);
+    printf("lost=%u\n", host.lost);
+    printf("bad_packets=%u\n", host.badPackets);
+    printf("dmm_frames=%u\n", sanwa_meter_get_frames_sent());
+    printf("rate_hz=%.3f\n", rate);
+
+    double p99 = 0.0;
+    if ((false == opts.stream) && (host.responses > 0)) {
+        qsort(host.latencies, host.responses, sizeof(double), compare_doubles);
+        double sum = 0.0;
+        for (uint32_t i = 0; i < host.responses; ++i) {
+            sum += host.latencies[i];
+        }
+        p99 = percentile(host.latencies, host.responses, 99.0);
+        printf("latency_min_us=%.1f\n", host.latencies[0]);
+        printf("latency_mean_us=%.1f\n", sum / host.responses);
+        printf("latency_p50_us=%.1f\n", percentile(host.latencies, host.responses, 50.0));
+        printf("latency_p99_us=%.1f\n", p99);
+        printf("latency_max_us=%.1f\n", host.latencies[host.responses - 1]);
+    }
+    printf("wall_time_s=%.3f\n", wall);
+    printf("speedup=%.1f\n", (wall > 0.0) ? simS / wall : 0.0);
+
+    if ((opts.maxP99Us > 0) && ((0 == host.responses) || (p99 > opts.maxP99Us))) {
+        fprintf(stderr, "host_sim: p99 latency %.1f us exceeds %.1f us\n", p99, opts.maxP99Us);
+        exitCode = 1;
+    }
+    if ((opts.minRate > 0) && (rate < opts.minRate)) {
+        fprintf(stderr, "host_sim: rate %.3f Hz is below %.3f Hz\n", rate, opts.minRate);
+        exitCode = 1;
+    }
+    fflush(stdout);
+    exit(exitCode);
+}
+
+/// Schedules the next request or ends the scenario when all requests were served
+static void next_request(void) {
+    host.waiting = false;
+    if (host.sent >= opts.requests) {
+        finish();
+    }
+
+    uint64_t due = sim_now();
+    if ((host.sent > 0) && (due < host.lastSent + SIM_US(opts.intervalMs * 1000ULL))) {
+        due = host.lastSent + SIM_US(opts.intervalMs * 1000ULL);
+    }
+    sim_timer_start(&host.timer, due, send_request, NULL);
+}
+
+static void request_timeout(void* ctx) {
+    (void)ctx;
+    ++host.lost;
+    next_request();
+}
+
+static void send_request(void* ctx) {
+    (void)ctx;
+    static const uint8_t dataReq[] = {BM_DLE_CONST, BM_STX_CONST, BM_DATA_REQ_COMMAND, 0x00, 0x00, 0x00,
+                                      BM_DLE_CONST, BM_ETX_CONST};
+
+    if (false == sim_usb_host_send(CDC_DATA_IN_EP, dataReq, sizeof(dataReq))) {
+        sim_fatal("data request can't be sent");
+    }
+    host.lastSent = sim_now();
+    if (0 == host.sent) {
+        host.firstSent = host.lastSent;
+    }
+    ++host.sent;
+    host.waiting = true;
+    sim_timer_start(&host.timer, sim_now() + SIM_US(opts.timeoutMs * 1000ULL), request_timeout, NULL);
+}
+
+static void start_stream(void* ctx) {
+    (void)ctx;
+    const uint8_t arg0 = (uint8_t)(opts.intervalMs & 0xFF);
+    const uint8_t arg1 = (uint8_t)((opts.intervalMs >> 8) & 0xFF);
+    const uint8_t frame[] = {BM_DLE_CONST, BM_STX_CONST, BM_ADAPTER_CMD_STREAM_START, arg0, arg1,
+                             (uint8_t)(BM_ADAPTER_CMD_STREAM_START ^ arg0 ^ arg1), BM_DLE_CONST, BM_ETX_CONST};
+
+    if (false == sim_usb_host_send(CDC_DATA_IN_EP, frame, sizeof(frame))) {
+        sim_fatal("stream command can't be sent");
+    }
+    host.firstSent = sim_now();
+    host.sent = opts.requests;
+}
+
+static void packet_received(const uint8_t cmd) {
+    if ((BM_DATA_RESP_COMMAND != cmd) && (BM_DATA_RESP_OV_COMMAND != cmd)) {
+        return;
+    }
+
+    host.lastResponse = sim_now();
+    if (true == opts.stream) {
+        if (++host.responses >= opts.requests) {
+            finish();
+        }
+    } else if (true == host.waiting) {
+        host.latencies[host.responses++] = (double)(sim_now() - host.lastSent) * 1e6 / SIM_CORE_HZ;
+        next_request();
+    }
+}
+
+/// Finds packets (DLE STX CMD LEN data CHK DLE ETX) in the bytes received from the CDC data endpoint
+static void host_rx(const uint8_t ep, const uint8_t* const data, const uint16_t len) {
+    if (CDC_DATA_OUT_EP != ep) {
+        return;
+    }
+    if (host.rxLen + len > RX_BUFF_LEN) {
+        host.rxLen = 0;
+        ++host.badPackets;
+    }
+    memcpy(&host.rxBuff[host.rxLen], data, len);
+    host.rxLen += len;
+
+    size_t pos = 0;
+    while (pos + 4 <= host.rxLen) {
+        if ((BM_DLE_CONST != host.rxBuff[pos]) || (BM_STX_CONST != host.rxBuff[pos + 1])) {
+            ++pos;
+            continue;
+        }
+        const size_t dataLen = host.rxBuff[pos + 3];
+        const size_t end = pos + 4 + dataLen + 3;
+        if (end > host.rxLen) {
+            break;
+        }
+
+        uint8_t chk = 0;
+        for (size_t i = 0; i < dataLen; ++i) {
+            chk ^= host.rxBuff[pos + 4 + i];
+        }
+        if ((chk == host.rxBuff[end - 3]) && (BM_DLE_CONST == host.rxBuff[end - 2]) &&
+            (BM_ETX_CONST == host.rxBuff[end - 1])) {
+            packet_received(host.rxBuff[pos + 2]);
+            pos = end;
+        } else {
+            ++host.badPackets;
+            ++pos;
+        }
+    }
+    memmove(host.rxBuff, &host.rxBuff[pos], host.rxLen - pos);
+    host.rxLen -= pos;
+}
+
+static void usage(const char* const prog) {
+    fprintf(stderr, "Usage: %s [--requests N] [--interval-ms MS] [--stream] [--wake-us US] [--wake-jitter-us US] "
+                    "[--seed N] [--meter-script FILE] [--in-latency-us US] [--timeout-ms MS] [--max-sim-s S] "
+                    "[--max-p99-us US] [--min-rate HZ]\n", prog);
+    exit(2);
+}
+
+static void parse_options(int argc, char** argv) {
+    static const struct option longOpts[] = {
+        {"requests",       required_argument, NULL, 'n'},
+        {"interval-ms",    required_argument, NULL, 'i'},
+        {"stream",         no_argument,       NULL, 's'},
+        {"wake-us",        required_argument, NULL, 'w'},
+        {"wake-jitter-us", required_argument, NULL, 'j'},
+        {"seed",           required_argument, NULL, 'r'},
+        {"meter-script",   required_argument, NULL, 'm'},
+        {"in-latency-us",  required_argument, NULL, 'l'},
+        {"timeout-ms",     required_argument, NULL, 't'},
+        {"max-sim-s",      required_argument, NULL, 'x'},
+        {"max-p99-us",     required_argument, NULL, 'p'},
+        {"min-rate",       required_argument, NULL, 'q'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while (-1 != (opt = getopt_long(argc, argv, "", longOpts, NULL))) {
+        switch (opt) {
+        case 'n': opts.requests = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'i': opts.intervalMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 's': opts.stream = true; break;
+        case 'w': opts.wakeUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'j': opts.wakeJitterUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'r': opts.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'm': opts.meterScript = optarg; break;
+        case 'l': opts.inLatencyUs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 't': opts.timeoutMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'x': opts.maxSimS = strtod(optarg, NULL); break;
+        case 'p': opts.maxP99Us = strtod(optarg, NULL); break;
+        case 'q': opts.minRate = strtod(optarg, NULL); break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((optind < argc) || (0 == opts.requests)) {
+        usage(argv[0]);
+    }
+}
+
+int main(int argc, char** argv) {
+    parse_options(argc, argv);
+    clock_gettime(CLOCK_MONOTONIC, &host.wallStart);
+
+    sanwa_meter_init(opts.wakeUs, opts.wakeJitterUs, opts.seed);
+    if ((NULL != opts.meterScript) && (false == sanwa_meter_load_script(opts.meterScript))) {
+        return 2;
+    }
+
+    host.latencies = calloc(opts.requests, sizeof(double));
+    if (NULL == host.latencies) {
+        return 2;
+    }
+
+    sim_usb_set_in_latency(SIM_US(opts.inLatencyUs));
+    sim_usb_register_host_rx_callback(host_rx);
+    if (opts.maxSimS > 0) {
+        sim_set_time_limit((uint64_t)(opts.maxSimS * SIM_CORE_HZ));
+    }
+    sim_timer_start(&host.timer, SIM_US(STARTUP_US), (true == opts.stream) ? start_stream : send_request, NULL);
+
+    // never returns, the scenario ends by finish() or sim_fatal()
+    app_main();
+    return 2;
+}
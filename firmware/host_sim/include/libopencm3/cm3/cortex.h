@@ -0,0 +1,6 @@
+#pragma once
+#include "../common.h"
+void cm_enable_interrupts(void);
+void cm_disable_interrupts(void);
+uint32_t cm_mask_interrupts(uint32_t mask);
+bool cm_is_masked_interrupts(void);
@@ -0,0 +1,12 @@
+#pragma once
+#include "../common.h"
+#define NVIC_PENDSV_IRQ -2
+#define NVIC_SYSTICK_IRQ -1
+#define NVIC_EXTI4_IRQ 10
+#define NVIC_USB_HP_CAN_TX_IRQ 19
+#define NVIC_USB_LP_CAN_RX0_IRQ 20
+#define NVIC_TIM2_IRQ 28
+void nvic_enable_irq(uint8_t irqn);
+void nvic_disable_irq(uint8_t irqn);
+void nvic_clear_pending_irq(uint8_t irqn);
+void nvic_set_priority(uint8_t irqn, uint8_t priority);
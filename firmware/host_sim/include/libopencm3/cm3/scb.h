@@ -0,0 +1,9 @@
+#pragma once
+#include "../common.h"
+/// Bits of SysTick follow the state of the simulated interrupt, see sim_mmio32
+#define SCB_ICSR                MMIO32(0xE000ED04)
+#define SCB_ICSR_PENDSTCLR      (1 << 25)
+#define SCB_ICSR_PENDSTSET      (1 << 26)
+#define SCB_ICSR_PENDSVSET      (1 << 28)
+#define SCB_SHCSR               MMIO32(0xE000ED24)
+#define SCB_SHCSR_SYSTICKACT    (1 << 11)
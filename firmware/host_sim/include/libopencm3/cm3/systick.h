@@ -0,0 +1,10 @@
+#pragma once
+#include "../common.h"
+bool systick_set_frequency(uint32_t freq, uint32_t ahb);
+void systick_interrupt_enable(void);
+void systick_counter_enable(void);
+void systick_counter_disable(void);
+void systick_set_reload(uint32_t value);
+uint32_t systick_get_reload(void);
+uint32_t systick_get_value(void);
+void systick_clear(void);
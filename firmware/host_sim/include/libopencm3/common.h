@@ -0,0 +1,15 @@
+/*
+ * Stub of libopencm3 for the host build of the application, see host_sim/sim.h. Only declarations used by the
+ * application are provided. Memory mapped registers are backed by the simulator's storage.
+ */
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+/// Returns storage of the 32 bits register at given address
+volatile uint32_t* sim_mmio32(const uint32_t addr);
+/// Returns storage of the bit-band alias of given bit of the peripheral register
+volatile uint32_t* sim_bitband(const uint32_t addr, const uint8_t bit);
+
+#define MMIO32(a) (*sim_mmio32((uint32_t)(a)))
+#define BBIO_PERIPH(addr, bit) (*sim_bitband((uint32_t)(addr), (uint8_t)(bit)))
@@ -0,0 +1,9 @@
+#pragma once
+#include "../common.h"
+#define EXTI4 (1 << 4)
+enum exti_trigger_type { EXTI_TRIGGER_RISING, EXTI_TRIGGER_FALLING, EXTI_TRIGGER_BOTH };
+void exti_select_source(uint32_t exti, uint32_t gpioport);
+void exti_set_trigger(uint32_t extis, enum exti_trigger_type trig);
+void exti_enable_request(uint32_t extis);
+void exti_disable_request(uint32_t extis);
+void exti_reset_request(uint32_t extis);
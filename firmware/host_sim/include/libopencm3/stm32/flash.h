@@ -0,0 +1,6 @@
+#pragma once
+#include "../common.h"
+#define FLASH_ACR_LATENCY_0WS 0
+#define FLASH_ACR_LATENCY_1WS 1
+#define FLASH_ACR_LATENCY_2WS 2
+void flash_set_ws(uint32_t ws);
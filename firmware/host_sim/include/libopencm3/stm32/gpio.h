@@ -0,0 +1,29 @@
+#pragma once
+#include "../common.h"
+#define GPIOA 0x40010800
+#define GPIOB 0x40010C00
+#define GPIO3 (1 << 3)
+#define GPIO4 (1 << 4)
+#define GPIO5 (1 << 5)
+#define GPIO6 (1 << 6)
+#define GPIO11 (1 << 11)
+#define GPIO12 (1 << 12)
+#define GPIO_MODE_INPUT 0
+#define GPIO_MODE_OUTPUT_10_MHZ 1
+#define GPIO_MODE_OUTPUT_2_MHZ 2
+#define GPIO_MODE_OUTPUT_50_MHZ 3
+#define GPIO_CNF_INPUT_ANALOG 0
+#define GPIO_CNF_INPUT_FLOAT 1
+#define GPIO_CNF_INPUT_PULL_UPDOWN 2
+#define GPIO_CNF_OUTPUT_PUSHPULL 0
+#define GPIO_CNF_OUTPUT_OPENDRAIN 1
+#define GPIO_CNF_OUTPUT_ALTFN_PUSHPULL 2
+#define AFIO_MAPR MMIO32(0x40010004)
+#define AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_ON (2 << 24)
+#define AFIO_MAPR_TIM2_REMAP_PARTIAL_REMAP1 (1 << 8)
+void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios);
+void gpio_set(uint32_t gpioport, uint16_t gpios);
+void gpio_clear(uint32_t gpioport, uint16_t gpios);
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios);
+void gpio_toggle(uint32_t gpioport, uint16_t gpios);
+void gpio_primary_remap(uint32_t swjdisable, uint32_t maps);
@@ -0,0 +1,39 @@
+#pragma once
+#include "../common.h"
+enum rcc_osc { RCC_PLL, RCC_HSE, RCC_HSI, RCC_LSE, RCC_LSI };
+enum rcc_periph_clken { RCC_GPIOA, RCC_GPIOB, RCC_GPIOC, RCC_AFIO, RCC_TIM2, RCC_USB };
+enum rcc_periph_rst { RST_TIM2, RST_USB };
+#define RCC_CFGR_SW_SYSCLKSEL_HSICLK 0
+#define RCC_CFGR_SW_SYSCLKSEL_HSECLK 1
+#define RCC_CFGR_SW_SYSCLKSEL_PLLCLK 2
+#define RCC_CFGR_HPRE_SYSCLK_NODIV 0
+#define RCC_CFGR_ADCPRE_PCLK2_DIV2 0
+#define RCC_CFGR_ADCPRE_PCLK2_DIV4 1
+#define RCC_CFGR_ADCPRE_PCLK2_DIV6 2
+#define RCC_CFGR_ADCPRE_PCLK2_DIV8 3
+#define RCC_CFGR_PPRE1_HCLK_NODIV 0
+#define RCC_CFGR_PPRE1_HCLK_DIV2 4
+#define RCC_CFGR_PPRE2_HCLK_NODIV 0
+#define RCC_CFGR_PPRE2_HCLK_DIV2 4
+#define RCC_CFGR_USBPRE_PLL_CLK_DIV1_5 0
+#define RCC_CFGR_USBPRE_PLL_CLK_NODIV 1
+#define RCC_CFGR_PLLMUL_PLL_CLK_MUL6 4
+#define RCC_CFGR_PLLMUL_PLL_CLK_MUL9 7
+#define RCC_CFGR_PLLSRC_HSE_CLK 1
+#define RCC_CFGR_PLLXTPRE_HSE_CLK 0
+extern uint32_t rcc_ahb_frequency;
+extern uint32_t rcc_apb1_frequency;
+extern uint32_t rcc_apb2_frequency;
+void rcc_osc_on(enum rcc_osc osc);
+void rcc_wait_for_osc_ready(enum rcc_osc osc);
+void rcc_set_sysclk_source(uint32_t clk);
+void rcc_set_hpre(uint32_t hpre);
+void rcc_set_adcpre(uint32_t adcpre);
+void rcc_set_ppre1(uint32_t ppre1);
+void rcc_set_ppre2(uint32_t ppre2);
+void rcc_set_usbpre(uint32_t usbpre);
+void rcc_set_pll_multiplication_factor(uint32_t mul);
+void rcc_set_pll_source(uint32_t pllsrc);
+void rcc_set_pllxtpre(uint32_t pllxtpre);
+void rcc_periph_clock_enable(enum rcc_periph_clken clken);
+void rcc_periph_reset_pulse(enum rcc_periph_rst rst);
@@ -0,0 +1,23 @@
+#pragma once
+#include "../common.h"
+#define USB_FNR_REG (&MMIO32(0x40005C48))
+#define USB_FNR_FN 0x07FF
+#define USB_PMA_BASE 0x40006000
+#define USB_EP_REG(EP) (&MMIO32(0x40005C00) + (EP))
+#define USB_BTABLE_REG (&MMIO32(0x40005C50))
+#define USB_EP_RX_CTR 0x8000
+#define USB_EP_RX_DTOG 0x4000
+#define USB_EP_RX_STAT 0x3000
+#define USB_EP_SETUP 0x0800
+#define USB_EP_TYPE 0x0600
+#define USB_EP_KIND 0x0100
+#define USB_EP_TX_CTR 0x0080
+#define USB_EP_TX_DTOG 0x0040
+#define USB_EP_TX_STAT 0x0030
+#define USB_EP_TX_STAT_VALID 0x0030
+#define USB_EP_ADDR 0x000F
+#define USB_EP_NTOGGLE_MSK (USB_EP_RX_CTR | USB_EP_SETUP | USB_EP_TYPE | USB_EP_KIND | USB_EP_TX_CTR | USB_EP_ADDR)
+#define USB_CNTR_REG (&MMIO32(0x40005C40))
+#define USB_CNTR_SOFM 0x0200
+#define GET_REG(REG) ((uint16_t) *(REG))
+#define SET_REG(REG, VAL) (*(REG) = (uint16_t)(VAL))
@@ -0,0 +1,41 @@
+#pragma once
+#include "../common.h"
+#define TIM2 0x40000000
+enum tim_oc_id { TIM_OC1, TIM_OC2, TIM_OC3, TIM_OC4 };
+enum tim_oc_mode { TIM_OCM_FROZEN, TIM_OCM_ACTIVE, TIM_OCM_INACTIVE, TIM_OCM_TOGGLE, TIM_OCM_FORCE_LOW,
+                   TIM_OCM_FORCE_HIGH, TIM_OCM_PWM1, TIM_OCM_PWM2 };
+#define TIM_CR1_CKD_CK_INT 0
+#define TIM_CR1_CMS_EDGE 0
+#define TIM_CR1_DIR_UP 0
+#define TIM_DIER_UIE (1 << 0)
+#define TIM_DIER_CC1IE (1 << 1)
+#define TIM_DIER_CC2IE (1 << 2)
+#define TIM_SR_UIF (1 << 0)
+#define TIM_SR_CC1IF (1 << 1)
+#define TIM_SR_CC2IF (1 << 2)
+#define TIM_SR_CC3IF (1 << 3)
+#define TIM_SR_CC4IF (1 << 4)
+#define TIM_SR_COMIF (1 << 5)
+#define TIM_SR_TIF (1 << 6)
+#define TIM_SR_BIF (1 << 7)
+#define TIM_EGR_UG (1 << 0)
+void timer_reset(uint32_t timer_peripheral);
+void timer_set_mode(uint32_t timer_peripheral, uint32_t clock_div, uint32_t alignment, uint32_t direction);
+void timer_set_prescaler(uint32_t timer_peripheral, uint32_t value);
+void timer_enable_preload(uint32_t timer_peripheral);
+void timer_one_shot_mode(uint32_t timer_peripheral);
+void timer_continuous_mode(uint32_t timer_peripheral);
+void timer_set_period(uint32_t timer_peripheral, uint32_t period);
+void timer_disable_oc_output(uint32_t timer_peripheral, enum tim_oc_id oc_id);
+void timer_enable_oc_output(uint32_t timer_peripheral, enum tim_oc_id oc_id);
+void timer_set_oc_mode(uint32_t timer_peripheral, enum tim_oc_id oc_id, enum tim_oc_mode oc_mode);
+void timer_enable_oc_preload(uint32_t timer_peripheral, enum tim_oc_id oc_id);
+void timer_set_oc_value(uint32_t timer_peripheral, enum tim_oc_id oc_id, uint32_t value);
+void timer_generate_event(uint32_t timer_peripheral, uint32_t event);
+void timer_clear_flag(uint32_t timer_peripheral, uint32_t flag);
+bool timer_get_flag(uint32_t timer_peripheral, uint32_t flag);
+void timer_enable_counter(uint32_t timer_peripheral);
+void timer_disable_counter(uint32_t timer_peripheral);
+bool timer_interrupt_source(uint32_t timer_peripheral, uint32_t flag);
+void timer_enable_irq(uint32_t timer_peripheral, uint32_t irq);
+void timer_disable_irq(uint32_t timer_peripheral, uint32_t irq);
@@ -0,0 +1,18 @@
+#pragma once
+#include "usbstd.h"
+#define CS_INTERFACE 0x24
+#define USB_CDC_TYPE_HEADER 0
+#define USB_CDC_TYPE_CALL_MANAGEMENT 1
+#define USB_CDC_TYPE_ACM 2
+#define USB_CDC_TYPE_UNION 6
+#define USB_CDC_SUBCLASS_ACM 2
+#define USB_CDC_PROTOCOL_AT 1
+#define USB_CDC_REQ_SET_LINE_CODING 0x20
+#define USB_CDC_REQ_SET_CONTROL_LINE_STATE 0x22
+#define USB_CDC_NOTIFY_SERIAL_STATE 0x20
+struct usb_cdc_header_descriptor { uint8_t bFunctionLength, bDescriptorType, bDescriptorSubtype; uint16_t bcdCDC; } __attribute__((packed));
+struct usb_cdc_call_management_descriptor { uint8_t bFunctionLength, bDescriptorType, bDescriptorSubtype, bmCapabilities, bDataInterface; } __attribute__((packed));
+struct usb_cdc_acm_descriptor { uint8_t bFunctionLength, bDescriptorType, bDescriptorSubtype, bmCapabilities; } __attribute__((packed));
+struct usb_cdc_union_descriptor { uint8_t bFunctionLength, bDescriptorType, bDescriptorSubtype, bControlInterface, bSubordinateInterface0; } __attribute__((packed));
+struct usb_cdc_notification { uint8_t bmRequestType, bNotification; uint16_t wValue, wIndex, wLength; } __attribute__((packed));
+struct usb_cdc_line_coding { uint32_t dwDTERate; uint8_t bCharFormat, bParityType, bDataBits; } __attribute__((packed));
@@ -0,0 +1,22 @@
+#pragma once
+#include "usbstd.h"
+typedef struct _usbd_device usbd_device;
+typedef struct _usbd_driver usbd_driver;
+extern const usbd_driver st_usbfs_v1_usb_driver;
+typedef void (*usbd_endpoint_callback)(usbd_device *usbd_dev, uint8_t ep);
+typedef int (*usbd_control_callback)(usbd_device *usbd_dev, struct usb_setup_data *req, uint8_t **buf, uint16_t *len,
+                                     void (**complete)(usbd_device *usbd_dev, struct usb_setup_data *req));
+typedef void (*usbd_set_config_callback)(usbd_device *usbd_dev, uint16_t wValue);
+usbd_device *usbd_init(const usbd_driver *driver, const struct usb_device_descriptor *dev,
+                       const struct usb_config_descriptor *conf, const char **strings, int num_strings,
+                       uint8_t *control_buffer, uint16_t control_buffer_size);
+void usbd_poll(usbd_device *usbd_dev);
+int usbd_register_set_config_callback(usbd_device *usbd_dev, usbd_set_config_callback callback);
+int usbd_register_control_callback(usbd_device *usbd_dev, uint8_t type, uint8_t type_mask,
+                                   usbd_control_callback callback);
+void usbd_register_sof_callback(usbd_device *usbd_dev, void (*callback)(void));
+void usbd_ep_setup(usbd_device *usbd_dev, uint8_t addr, uint8_t type, uint16_t max_size,
+                   usbd_endpoint_callback callback);
+uint16_t usbd_ep_write_packet(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len);
+uint16_t usbd_ep_read_packet(usbd_device *usbd_dev, uint8_t addr, void *buf, uint16_t len);
+void usbd_ep_nak_set(usbd_device *usbd_dev, uint8_t addr, uint8_t nak);
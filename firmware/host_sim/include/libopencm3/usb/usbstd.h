@@ -0,0 +1,30 @@
+#pragma once
+#include "../common.h"
+#define USB_DT_DEVICE_SIZE 18
+#define USB_DT_DEVICE 1
+#define USB_DT_CONFIGURATION 2
+#define USB_DT_INTERFACE 4
+#define USB_DT_ENDPOINT 5
+#define USB_DT_INTERFACE_ASSOCIATION 11
+#define USB_DT_CONFIGURATION_SIZE 9
+#define USB_DT_INTERFACE_SIZE 9
+#define USB_DT_ENDPOINT_SIZE 7
+#define USB_DT_INTERFACE_ASSOCIATION_SIZE 8
+#define USB_CLASS_CDC 2
+#define USB_CLASS_DATA 0x0A
+#define USB_CLASS_VENDOR 0xFF
+#define USB_CLASS_MISCELLANEOUS 0xEF
+#define USB_ENDPOINT_ATTR_BULK 2
+#define USB_ENDPOINT_ATTR_INTERRUPT 3
+#define USB_REQ_TYPE_CLASS 0x20
+#define USB_REQ_TYPE_VENDOR 0x40
+#define USB_REQ_TYPE_INTERFACE 1
+#define USB_REQ_TYPE_TYPE 0x60
+#define USB_REQ_TYPE_RECIPIENT 0x1F
+struct usb_setup_data { uint8_t bmRequestType, bRequest; uint16_t wValue, wIndex, wLength; } __attribute__((packed));
+struct usb_device_descriptor { uint8_t bLength, bDescriptorType; uint16_t bcdUSB; uint8_t bDeviceClass, bDeviceSubClass, bDeviceProtocol, bMaxPacketSize0; uint16_t idVendor, idProduct, bcdDevice; uint8_t iManufacturer, iProduct, iSerialNumber, bNumConfigurations; } __attribute__((packed));
+struct usb_endpoint_descriptor { uint8_t bLength, bDescriptorType, bEndpointAddress, bmAttributes; uint16_t wMaxPacketSize; uint8_t bInterval; const void *extra; int extralen; } __attribute__((packed));
+struct usb_interface_descriptor { uint8_t bLength, bDescriptorType, bInterfaceNumber, bAlternateSetting, bNumEndpoints, bInterfaceClass, bInterfaceSubClass, bInterfaceProtocol, iInterface; const struct usb_endpoint_descriptor *endpoint; const void *extra; int extralen; } __attribute__((packed));
+struct usb_iface_assoc_descriptor { uint8_t bLength, bDescriptorType, bFirstInterface, bInterfaceCount, bFunctionClass, bFunctionSubClass, bFunctionProtocol, iFunction; } __attribute__((packed));
+struct usb_interface { uint8_t *cur_altsetting; uint8_t num_altsetting; const struct usb_iface_assoc_descriptor *iface_assoc; const struct usb_interface_descriptor *altsetting; };
+struct usb_config_descriptor { uint8_t bLength, bDescriptorType; uint16_t wTotalLength; uint8_t bNumInterfaces, bConfigurationValue, iConfiguration, bmAttributes, bMaxPower; const struct usb_interface *interface; } __attribute__((packed));
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "raw_capture.h"
+
+/// Returns true if the footer at the end of the capture is valid for given number of bytes after the header
+static bool footer_valid(const raw_capture_footer* const footer, const size_t body_len, const size_t record_len) {
+    if (0 != memcmp(footer->magic, RAW_CAPTURE_FOOTER_MAGIC, sizeof(footer->magic))) {
+        return false;
+    }
+    const uint64_t expected = footer->recordsNo * record_len +
+                              (uint64_t)footer->indexEntriesNo * sizeof(raw_capture_index_entry) +
+                              sizeof(raw_capture_footer);
+    return (expected == body_len);
+}
+
+bool raw_capture_open(raw_capture* const cap, const char* const path) {
+    memset(cap, 0, sizeof(*cap));
+
+    const int fd = open(path, O_RDONLY);
+    struct stat st;
+    if ((fd < 0) || (0 != fstat(fd, &st))) {
+        perror(path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    if ((size_t)st.st_size < sizeof(raw_capture_header)) {
+        fprintf(stderr, "%s: too short for a capture\n", path);
+        close(fd);
+        return false;
+    }
+
+    void* const base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (MAP_FAILED == base) {
+        perror(path);
+        return false;
+    }
+    cap->base = base;
+    cap->size = (size_t)st.st_size;
+    cap->header = base;
+
+    const raw_capture_header* const hdr = cap->header;
+    if ((0 != memcmp(hdr->magic, RAW_CAPTURE_MAGIC, sizeof(hdr->magic))) || (RAW_CAPTURE_VERSION != hdr->version) ||
+        (sizeof(raw_capture_header) != hdr->headerLen) || (sizeof(raw_capture_record) != hdr->recordLen) ||
+        (0 == hdr->indexInterval)) {
+        fprintf(stderr, "%s: not a capture of version %d\n", path, RAW_CAPTURE_VERSION);
+        raw_capture_close(cap);
+        return false;
+    }
+
+    cap->records = (const raw_capture_record*)(cap->base + hdr->headerLen);
+    const size_t bodyLen = cap->size - hdr->headerLen;
+    const raw_capture_footer* const footer =
+        (bodyLen >= sizeof(raw_capture_footer)) ? (const raw_capture_footer*)(cap->base + cap->size -
+                                                                               sizeof(raw_capture_footer)) : NULL;
+
+    if ((NULL != footer) && (true == footer_valid(footer, bodyLen, hdr->recordLen))) {
+        cap->recordsNo = footer->recordsNo;
+        cap->index = (const raw_capture_index_entry*)(cap->base + hdr->headerLen + cap->recordsNo * hdr->recordLen);
+        cap->indexEntriesNo = footer->indexEntriesNo;
+        if (0 == cap->indexEntriesNo) {
+            cap->index = NULL;
+        }
+    } else {
+        // recording didn't end properly, complete records are valid
+        cap->recordsNo = bodyLen / hdr->recordLen;
+    }
+    return true;
+}
+
+void raw_capture_close(raw_capture* const cap) {
+    if (NULL != cap->base) {
+        munmap((void*)cap->base, cap->size);
+    }
+    memset(cap, 0, sizeof(*cap));
+}
+
+uint64_t raw_capture_seek_time(const raw_capture* const cap, const uint64_t device_time_us) {
+    uint64_t lo = 0;
+    uint64_t hi = cap->recordsNo;
+
+    // index narrows the search to one interval, only its pages are touched then
+    if (NULL != cap->index) {
+        uint32_t entryLo = 0;
+        uint32_t entryHi = cap->indexEntriesNo;
+        while (entryLo < entryHi) {
+            const uint32_t mid = entryLo + ((entryHi - entryLo) / 2);
+            if (cap->index[mid].deviceTimeUs < device_time_us) {
+                entryLo = mid + 1;
+            } else {
+                entryHi = mid;
+            }
+        }
+        const uint64_t interval = cap->header->indexInterval;
+        lo = (entryLo > 0) ? (entryLo - 1) * interval : 0;
+        hi = (entryLo * interval < cap->recordsNo) ? entryLo * interval : cap->recordsNo;
+    }
+
+    while (lo < hi) {
+        const uint64_t mid = lo + ((hi - lo) / 2);
+        if (cap->records[mid].deviceTimeUs < device_time_us) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
@@ -0,0 +1,96 @@
+#ifndef RAW_CAPTURE_H_
+#define RAW_CAPTURE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @file Capture file of raw DMM frames.
+ *
+ * Frames are sent by the adapter after BM_ADAPTER_CMD_RAW_FRAMES and recorded by tools/raw_capture.py. Layout, all
+ * numbers little endian:
+ *
+ *   header   64 bytes        \ref raw_capture_header
+ *   records  N * 32 bytes    \ref raw_capture_record, in order of reception
+ *   index    M * 16 bytes    \ref raw_capture_index_entry, one per indexInterval records (of record 0, interval, ...)
+ *   footer   24 bytes        \ref raw_capture_footer
+ *
+ * Records are appended to the file while recording, index and footer are written when recording ends. To append to
+ * an existing capture, the recorder cuts off the index and footer, appends records and writes them again. A capture
+ * without valid footer (recorder was killed) is still readable: all complete records after the header are used and
+ * the index is missing.
+ *
+ * The file can be mapped to memory and records accessed as an array, structures below match the layout on little
+ * endian hosts.
+ */
+
+#define RAW_CAPTURE_MAGIC           "SWRAWCAP"
+#define RAW_CAPTURE_FOOTER_MAGIC    "SWRAWIDX"
+#define RAW_CAPTURE_VERSION         1
+/// Number of bytes of the raw frame
+#define RAW_CAPTURE_FRAME_BYTES     16
+
+typedef struct {
+    char        magic[8];
+    uint16_t    version;
+    uint16_t    headerLen;
+    uint16_t    recordLen;
+    /// Number of records per index entry
+    uint16_t    indexInterval;
+    /// Host wall clock at the start of recording, us since the Unix epoch
+    uint64_t    startUnixUs;
+    uint8_t     reserved[40];
+} raw_capture_header;
+
+typedef struct {
+    /// Time of the reading by the adapter's clock, us since its start
+    uint64_t    deviceTimeUs;
+    /// Sequence number of the frame given by the adapter, gap means lost frames
+    uint32_t    seq;
+    /// Reception of the frame by the host, ms since startUnixUs
+    uint32_t    hostOffsetMs;
+    uint8_t     raw[RAW_CAPTURE_FRAME_BYTES];
+} raw_capture_record;
+
+typedef struct {
+    uint64_t    deviceTimeUs;
+    uint32_t    seq;
+    uint32_t    hostOffsetMs;
+} raw_capture_index_entry;
+
+typedef struct {
+    uint64_t    recordsNo;
+    uint32_t    indexEntriesNo;
+    uint32_t    reserved;
+    char        magic[8];
+} raw_capture_footer;
+
+/// Capture mapped to memory
+typedef struct {
+    const uint8_t*                  base;
+    size_t                          size;
+    const raw_capture_header*       header;
+    const raw_capture_record*       records;
+    uint64_t                        recordsNo;
+    /// NULL if the capture has no valid index
+    const raw_capture_index_entry*  index;
+    uint32_t                        indexEntriesNo;
+} raw_capture;
+
+/**
+ * Maps the capture file to memory and validates it.
+ * @return false if the file can't be mapped or it isn't a capture, error is printed to stderr
+ */
+bool raw_capture_open(raw_capture* const cap, const char* const path);
+
+/// Unmaps the capture
+void raw_capture_close(raw_capture* const cap);
+
+/**
+ * Returns number of the first record whose device time is not less than given one, recordsNo if there is no such
+ * record. Device time must not go back in the capture (the adapter wasn't restarted), index is used when present.
+ */
+uint64_t raw_capture_seek_time(const raw_capture* const cap, const uint64_t device_time_us);
+
+#endif // RAW_CAPTURE_H_
@@ -0,0 +1,160 @@
+/*
+ * Replays captures of raw DMM frames (see raw_capture.h) through the decoder of the application at maximal speed.
+ *
+ * Each frame is converted by bm_create_pkt to the Brymen packet. Digest of all packets (FNV-1a, 64 bits) identifies
+ * the decoder output: a change of the decoder which keeps it the same doesn't change anything the host receives.
+ * Decoding rate shows the effect of the change on speed.
+ *
+ * Usage: raw_replay [--repeat N] [--from-us T] [--to-us T] [--dump] capture...
+ *
+ * --from-us/--to-us limit replay to frames read by the adapter in given time range (its clock), --dump prints each
+ * packet in hex. Results are printed as key=value lines.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <time.h>
+#include "raw_capture.h"
+#include "bm_dmm_protocol.h"
+
+#define FNV64_OFFSET 0xCBF29CE484222325ULL
+#define FNV64_PRIME  0x00000100000001B3ULL
+
+static struct {
+    uint32_t repeat;
+    uint64_t fromUs;
+    uint64_t toUs;
+    bool     dump;
+} opts = {
+    .repeat = 1,
+    .fromUs = 0,
+    .toUs = UINT64_MAX,
+    .dump = false,
+};
+
+static struct {
+    uint64_t records;
+    uint64_t seqGaps;
+    uint64_t olPackets;
+    uint64_t invalidDigits;
+    uint64_t errors;
+    uint64_t digest;
+    double   seconds;
+} result = {
+    .digest = FNV64_OFFSET,
+};
+
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t* const data, const size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+/// Decodes frames of given range of records, digest covers all packets in order
+static void replay(const raw_capture* const cap, const uint64_t first, const uint64_t end, const bool collect) {
+    for (uint64_t i = first; i < end; ++i) {
+        const raw_capture_record* const rec = &cap->records[i];
+        data_resp_pkt packet;
+
+        const bm_result res = bm_create_pkt(rec->raw, RAW_CAPTURE_FRAME_BYTES, &packet);
+        const uint32_t invalidDigits = bm_take_invalid_digits_no();
+        if (false == collect) {
+            continue;
+        }
+
+        ++result.records;
+        result.invalidDigits += invalidDigits;
+        if ((i > first) && (rec->seq != cap->records[i - 1].seq + 1)) {
+            ++result.seqGaps;
+        }
+        if (BM_PKG_CREATED != res) {
+            ++result.errors;
+            continue;
+        }
+        if (BM_OL_PACKET_DATA_LENGTH == packet.header.dataLen) {
+            ++result.olPackets;
+        }
+        result.digest = fnv1a(result.digest, (const uint8_t*)&packet, sizeof(packet));
+
+        if (true == opts.dump) {
+            printf("%u %llu", rec->seq, (unsigned long long)rec->deviceTimeUs);
+            for (size_t b = 0; b < sizeof(packet); ++b) {
+                printf(" %02x", ((const uint8_t*)&packet)[b]);
+            }
+            printf("\n");
+        }
+    }
+}
+
+static void usage(const char* const prog) {
+    fprintf(stderr, "Usage: %s [--repeat N] [--from-us T] [--to-us T] [--dump] capture...\n", prog);
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    static const struct option longOpts[] = {
+        {"repeat",  required_argument, NULL, 'n'},
+        {"from-us", required_argument, NULL, 'f'},
+        {"to-us",   required_argument, NULL, 't'},
+        {"dump",    no_argument,       NULL, 'd'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while (-1 != (opt = getopt_long(argc, argv, "", longOpts, NULL))) {
+        switch (opt) {
+        case 'n': opts.repeat = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'f': opts.fromUs = strtoull(optarg, NULL, 0); break;
+        case 't': opts.toUs = strtoull(optarg, NULL, 0); break;
+        case 'd': opts.dump = true; break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((optind >= argc) || (0 == opts.repeat)) {
+        usage(argv[0]);
+    }
+
+    uint64_t bytes = 0;
+    for (int file = optind; file < argc; ++file) {
+        raw_capture cap;
+        if (false == raw_capture_open(&cap, argv[file])) {
+            return 2;
+        }
+
+        const uint64_t first = raw_capture_seek_time(&cap, opts.fromUs);
+        const uint64_t end = (UINT64_MAX == opts.toUs) ? cap.recordsNo : raw_capture_seek_time(&cap, opts.toUs);
+
+        // only the first pass is accounted, the others measure speed of decoding of frames already in cache
+        const double start = now_s();
+        for (uint32_t pass = 0; pass < opts.repeat; ++pass) {
+            replay(&cap, first, (end > first) ? end : first, (0 == pass));
+        }
+        result.seconds += now_s() - start;
+        bytes += (uint64_t)opts.repeat * ((end > first) ? (end - first) : 0) * sizeof(raw_capture_record);
+
+        raw_capture_close(&cap);
+    }
+
+    const uint64_t decoded = result.records * opts.repeat;
+    printf("records=%llu\n", (unsigned long long)result.records);
+    printf("seq_gaps=%llu\n", (unsigned long long)result.seqGaps);
+    printf("ol_packets=%llu\n", (unsigned long long)result.olPackets);
+    printf("invalid_digits=%llu\n", (unsigned long long)result.invalidDigits);
+    printf("errors=%llu\n", (unsigned long long)result.errors);
+    printf("digest=%016llx\n", (unsigned long long)result.digest);
+    printf("seconds=%.6f\n", result.seconds);
+    printf("frames_per_s=%.0f\n", (result.seconds > 0) ? (double)decoded / result.seconds : 0.0);
+    printf("mb_per_s=%.1f\n", (result.seconds > 0) ? (double)bytes / result.seconds / 1e6 : 0.0);
+    return (0 == result.errors) ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/exti.h>
+#include "sim.h"
+#include "sanwa_meter.h"
+
+/// Maximal number of script steps
+#define SANWA_STEPS_NO 64
+/// Number of data bits sent by DMM in one frame
+#define SANWA_FRAME_BITS (SANWA_FRAME_BYTES * 8)
+
+/// Raw frame sent when no script step was added: 12.3458 uV DC
+static const uint8_t defaultFrame[SANWA_FRAME_BYTES] = {
+    0x09, 0xA0, 0xDA, 0xF9, 0xE4, 0x7C, 0xFE, 0xC0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+typedef struct {
+    bool        silent;
+    uint32_t    repeat;
+    uint32_t    wakeUs;
+    uint32_t    jitterUs;
+    uint8_t     frame[SANWA_FRAME_BYTES];
+} sanwa_step;
+
+static sanwa_step steps[SANWA_STEPS_NO];
+static int stepsNo = 0;
+/// Step and its repetition which answers the next start impulse
+static int stepIdx = 0;
+static uint32_t stepRepeat = 0;
+
+static uint32_t wakeUs = 0;
+static uint32_t jitterUs = 0;
+static uint32_t rngState = 1;
+
+/// Frame being sent and the number of the next bit
+static const sanwa_step* sending = NULL;
+static int bitIdx = 0;
+static uint32_t framesSent = 0;
+static sim_timer readyTimer;
+
+
+/// xorshift32, deterministic for given seed
+static uint32_t rng_next(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+void sanwa_meter_init(const uint32_t wake_us, const uint32_t jitter_us, const uint32_t seed) {
+    stepsNo = 0;
+    stepIdx = 0;
+    stepRepeat = 0;
+    wakeUs = wake_us;
+    jitterUs = jitter_us;
+    rngState = (0 != seed) ? seed : 1;
+    sending = NULL;
+    framesSent = 0;
+}
+
+static sanwa_step* add_step(const uint32_t repeat) {
+    if ((stepsNo >= SANWA_STEPS_NO) || (0 == repeat)) {
+        return NULL;
+    }
+    sanwa_step* const step = &steps[stepsNo++];
+    memset(step, 0, sizeof(*step));
+    step->repeat = repeat;
+    step->wakeUs = wakeUs;
+    step->jitterUs = jitterUs;
+    return step;
+}
+
+bool sanwa_meter_add_frame(const uint8_t* const frame, const uint32_t repeat) {
+    sanwa_step* const step = add_step(repeat);
+    if (NULL == step) {
+        return false;
+    }
+    memcpy(step->frame, frame, SANWA_FRAME_BYTES);
+    return true;
+}
+
+bool sanwa_meter_add_silent(const uint32_t repeat) {
+    sanwa_step* const step = add_step(repeat);
+    if (NULL == step) {
+        return false;
+    }
+    step->silent = true;
+    return true;
+}
+
+/// Parses 32 hex digits of the raw frame
+static bool parse_frame(const char* hex, uint8_t* const frame) {
+    for (int i = 0; i < SANWA_FRAME_BYTES; ++i) {
+        unsigned int byte = 0;
+        if (1 != sscanf(&hex[i * 2], "%2x", &byte)) {
+            return false;
+        }
+        frame[i] = (uint8_t)byte;
+    }
+    return true;
+}
+
+bool sanwa_meter_load_script(const char* const path) {
+    FILE* const file = fopen(path, "r");
+    if (NULL == file) {
+        fprintf(stderr, "host_sim: can't open %s\n", path);
+        return false;
+    }
+
+    bool retval = true;
+    char line[256];
+    int lineNo = 0;
+    while ((true == retval) && (NULL != fgets(line, sizeof(line), file))) {
+        ++lineNo;
+        char* const comment = strchr(line, '#');
+        if (NULL != comment) {
+            *comment = '\0';
+        }
+
+        char keyword[16] = "";
+        char arg[64] = "";
+        unsigned long num = 1;
+        const int fields = sscanf(line, "%15s %63s %lu", keyword, arg, &num);
+        if (fields <= 0) {
+            continue;
+        }
+
+        if (0 == strcmp(keyword, "frame")) {
+            uint8_t frame[SANWA_FRAME_BYTES];
+            retval = (fields >= 2) && (SANWA_FRAME_BYTES * 2 == strlen(arg)) && parse_frame(arg, frame) &&
+                     sanwa_meter_add_frame(frame, (uint32_t)num);
+        } else if (0 == strcmp(keyword, "silent")) {
+            num = (fields >= 2) ? strtoul(arg, NULL, 0) : 1;
+            retval = sanwa_meter_add_silent((uint32_t)num);
+        } else if (0 == strcmp(keyword, "wake_us")) {
+            retval = (fields >= 2);
+            wakeUs = (uint32_t)strtoul(arg, NULL, 0);
+            jitterUs = (fields >= 3) ? (uint32_t)num : 0;
+        } else {
+            retval = false;
+        }
+
+        if (false == retval) {
+            fprintf(stderr, "host_sim: %s:%d: invalid step\n", path, lineNo);
+        }
+    }
+
+    fclose(file);
+    return retval;
+}
+
+uint32_t sanwa_meter_get_frames_sent(void) {
+    return framesSent;
+}
+
+/// DMM turns its IR LED on, data line shows the first bit after it
+static void meter_ready(void* ctx) {
+    sending = ctx;
+    bitIdx = 0;
+    // interface v2 detects readiness on the falling edge, data bits are not inverted
+    sim_gpio_set_input(GPIOB, 4, false);
+    sim_exti_trigger(EXTI4);
+}
+
+void sanwa_meter_start_pulse(const uint64_t start, const uint64_t end) {
+    (void)start;
+    if (0 == stepsNo) {
+        sanwa_meter_add_frame(defaultFrame, 1);
+    }
+
+    const sanwa_step* const step = &steps[stepIdx];
+    if (++stepRepeat >= step->repeat) {
+        stepRepeat = 0;
+        stepIdx = (stepIdx + 1) % stepsNo;
+    }
+
+    // previous frame, if it wasn't read completely, is abandoned
+    sending = NULL;
+    if (true == step->silent) {
+        sim_timer_stop(&readyTimer);
+        return;
+    }
+
+    uint64_t wake = step->wakeUs;
+    if (step->jitterUs > 0) {
+        wake += rng_next() % (step->jitterUs + 1);
+    }
+    sim_timer_start(&readyTimer, end + SIM_US(wake), meter_ready, (void*)step);
+}
+
+void sanwa_meter_clock_edge(void) {
+    if (NULL == sending) {
+        return;
+    }
+
+    const bool bit = (0 != ((sending->frame[bitIdx / 8] >> (bitIdx % 8)) & 1));
+    sim_gpio_set_input(GPIOB, 4, bit);
+    if (++bitIdx >= SANWA_FRAME_BITS) {
+        sending = NULL;
+        ++framesSent;
+    }
+}
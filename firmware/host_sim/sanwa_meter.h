@@ -0,0 +1,44 @@
+#ifndef SANWA_METER_H_
+#define SANWA_METER_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file Model of Sanwa DMM on the IR interface.
+ *
+ * After the start impulse DMM waits the wake up time, signals it is ready on EXTI4 and then shifts out 128 bits of the
+ * raw frame, LSB of byte 0 first, one bit on each falling edge of the clock generated by TIM2. Behaviour is driven by
+ * a script: each start impulse consumes one step, the script restarts from the beginning after its last step.
+ *
+ * Script is a text file, one step per line, '#' starts a comment:
+ *   frame <32 hex digits> [repeat]   - answers with the raw frame, repeat times (default 1)
+ *   silent [repeat]                  - doesn't answer
+ *   wake_us <us> [jitter_us]         - sets wake up time of following steps, jitter is uniformly distributed
+ */
+
+/// Number of bytes of the raw frame
+#define SANWA_FRAME_BYTES 16
+
+/// Clears the script and sets the default wake up time
+void sanwa_meter_init(const uint32_t wake_us, const uint32_t jitter_us, const uint32_t seed);
+
+/// Appends step which answers with given frame
+bool sanwa_meter_add_frame(const uint8_t* const frame, const uint32_t repeat);
+
+/// Appends step which doesn't answer
+bool sanwa_meter_add_silent(const uint32_t repeat);
+
+/// Loads steps from the script file, returns false on error
+bool sanwa_meter_load_script(const char* const path);
+
+/// Returns number of frames sent completely
+uint32_t sanwa_meter_get_frames_sent(void);
+
+/// Called by TIM2 model when the start impulse is generated
+void sanwa_meter_start_pulse(const uint64_t start, const uint64_t end);
+
+/// Called by TIM2 model on each falling edge of the clock, DMM presents the next bit on the data line
+void sanwa_meter_clock_edge(void);
+
+#endif // SANWA_METER_H_
@@ -0,0 +1,83 @@
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "clock_profile.h"
+
+/**
+ * @file Core of the host simulator: virtual clock, timed actions and interrupts.
+ *
+ * The application runs natively on the host against the stub of libopencm3 (include/libopencm3). Its code takes no
+ * virtual time: the clock advances only when the application sleeps in \ref sim_wait_for_interrupt. Then the nearest
+ * timed action of some simulated peripheral (SysTick, TIM2, DMM, USB host) is run, which usually makes some interrupt
+ * pending. Pending interrupts are serviced as soon as they are enabled and not masked by PRIMASK, one at a time and in
+ * order of their priority (see irq_prio.h). Interrupts don't nest.
+ */
+
+/// Core clock of the simulated MCU, TIM2 runs at the same clock (see clock_profile.h)
+#define SIM_CORE_HZ ((unsigned long)SYSCLK_HZ)
+
+/// Converts us to core cycles
+#define SIM_US(us) ((uint64_t)(us) * (SIM_CORE_HZ / 1000000UL))
+
+/// Interrupts of the simulated MCU, in order of priority
+typedef enum {
+    SIM_IRQ_TIM2 = 0,
+    SIM_IRQ_EXTI4,
+    /// PendSV has the priority of SysTick, it precedes it by the exception number. It's always enabled.
+    SIM_IRQ_PENDSV,
+    SIM_IRQ_SYSTICK,
+    SIM_IRQ_USB_LP,
+    SIM_IRQ_NO
+} sim_irq;
+
+/// Function run by the timed action
+typedef void (*sim_action)(void* ctx);
+
+/// Timed action, usually a static variable of the peripheral model
+typedef struct sim_timer {
+    uint64_t            due;
+    sim_action          action;
+    void*               ctx;
+    bool                active;
+    bool                registered;
+} sim_timer;
+
+/// Returns the virtual time in core cycles since start
+uint64_t sim_now(void);
+
+/// Schedules the action at given virtual time. Rescheduling of active timer replaces its previous due time.
+void sim_timer_start(sim_timer* const timer, const uint64_t due, sim_action action, void* ctx);
+
+/// Cancels the timed action
+void sim_timer_stop(sim_timer* const timer);
+
+/// Makes the interrupt pending, it is serviced when enabled and not masked
+void sim_irq_set_pending(const sim_irq irq);
+
+/// Enables or disables the interrupt, like NVIC enable bits. SysTick is controlled by its own enable bit.
+void sim_irq_enable(const sim_irq irq, const bool enable);
+
+/// Clears the pending interrupt
+void sim_irq_clear_pending(const sim_irq irq);
+
+/**
+ * Sleeps until some interrupt is serviced or becomes pending while masked: runs timed actions in order of their due
+ * time and advances the virtual clock.
+ */
+void sim_wait_for_interrupt(void);
+
+/// Limits the virtual time, simulation fails when it is exceeded
+void sim_set_time_limit(const uint64_t cycles);
+
+/// Ends the simulation with an error message
+void sim_fatal(const char* const msg) __attribute__((noreturn));
+
+/// Sets level of the input pin, it is seen by gpio_get and the bit-band alias of the input data register
+void sim_gpio_set_input(const uint32_t port, const uint8_t pin_no, const bool level);
+
+/// Signals edge on the EXTI line, it makes the EXTI interrupt pending if the line is enabled
+void sim_exti_trigger(const uint32_t exti_line);
+
+#endif // SIM_H_
@@ -0,0 +1,24 @@
+#include "bsp.h"
+#include "sim.h"
+
+/*
+ * Board support of the host simulator: LED and user button have no model, the core sleeps in the virtual time.
+ */
+
+void bsp_init(void) {
+}
+
+void bsp_set_led_state(bool state) {
+    (void)state;
+}
+
+void bsp_led_toggle(void) {
+}
+
+bool bsp_get_bt_state(void) {
+    return false;
+}
+
+void bsp_wait_for_interrupt(void) {
+    sim_wait_for_interrupt();
+}
@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <libopencm3/cm3/cortex.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
+#include "sim.h"
+#include "irq_prio.h"
+
+/// Interrupt handlers of the application
+void tim2_isr(void);
+void exti4_isr(void);
+void pend_sv_handler(void);
+void sys_tick_handler(void);
+void usb_lp_can_rx0_isr(void);
+
+static void (* const isrHandlers[SIM_IRQ_NO])(void) = {
+    [SIM_IRQ_TIM2]    = tim2_isr,
+    [SIM_IRQ_EXTI4]   = exti4_isr,
+    [SIM_IRQ_PENDSV]  = pend_sv_handler,
+    [SIM_IRQ_SYSTICK] = sys_tick_handler,
+    [SIM_IRQ_USB_LP]  = usb_lp_can_rx0_isr,
+};
+
+static const uint32_t irqPrio[SIM_IRQ_NO] = {
+    [SIM_IRQ_TIM2]    = IRQ_PRIO_IR_TIMER,
+    [SIM_IRQ_EXTI4]   = IRQ_PRIO_IR_EXTI,
+    [SIM_IRQ_PENDSV]  = IRQ_PRIO_SYSTICK,
+    [SIM_IRQ_SYSTICK] = IRQ_PRIO_SYSTICK,
+    [SIM_IRQ_USB_LP]  = IRQ_PRIO_USB,
+};
+
+/// Maximal number of timed actions of all peripheral models
+#define SIM_TIMERS_NO 16
+/// Address of SCB_ICSR, see scb_icsr_sync
+#define SIM_SCB_ICSR 0xE000ED04
+
+/// Maximal number of memory mapped registers and bit-band aliases used by the application
+#define SIM_REGS_NO 32
+
+static uint64_t now = 0;
+static uint64_t timeLimit = UINT64_MAX;
+static sim_timer* timers[SIM_TIMERS_NO];
+static int timersNo = 0;
+
+static bool irqPending[SIM_IRQ_NO];
+static bool irqEnabled[SIM_IRQ_NO] = {[SIM_IRQ_PENDSV] = true};
+static bool primask = false;
+/// Interrupts of this priority and lower are masked, 0 masks none (like BASEPRI)
+static uint32_t basepri = 0;
+static bool inIsr = false;
+/// Set when some interrupt was serviced, it wakes up the core sleeping in WFI
+static bool isrServiced = false;
+
+static struct {
+    uint32_t addr;
+    volatile uint32_t value;
+} regs[SIM_REGS_NO];
+static int regsNo = 0;
+
+static struct {
+    uint32_t addr;
+    uint8_t bit;
+    volatile uint32_t value;
+} bitBands[SIM_REGS_NO];
+static int bitBandsNo = 0;
+
+uint64_t sim_now(void) {
+    return now;
+}
+
+void sim_timer_start(sim_timer* const timer, const uint64_t due, sim_action action, void* ctx) {
+    if (false == timer->registered) {
+        if (timersNo >= SIM_TIMERS_NO) {
+            sim_fatal("too many timed actions");
+        }
+        timers[timersNo++] = timer;
+        timer->registered = true;
+    }
+    timer->due = (due > now) ? due : now;
+    timer->action = action;
+    timer->ctx = ctx;
+    timer->active = true;
+}
+
+void sim_timer_stop(sim_timer* const timer) {
+    timer->active = false;
+}
+
+/// Applies write of PENDSTCLR and PENDSVSET to SCB_ICSR and updates its PENDSTSET from the pending SysTick interrupt
+static void scb_icsr_sync(volatile uint32_t* const icsr) {
+    if (0 != (*icsr & SCB_ICSR_PENDSTCLR)) {
+        irqPending[SIM_IRQ_SYSTICK] = false;
+    }
+    if (0 != (*icsr & SCB_ICSR_PENDSVSET)) {
+        irqPending[SIM_IRQ_PENDSV] = true;
+    }
+    *icsr = (true == irqPending[SIM_IRQ_SYSTICK]) ? SCB_ICSR_PENDSTSET : 0;
+}
+
+/// Services pending interrupts while they are enabled and not masked
+static void service_interrupts(void) {
+    scb_icsr_sync(&SCB_ICSR);
+    if ((true == inIsr) || (true == primask)) {
+        return;
+    }
+
+    bool serviced = true;
+    while (true == serviced) {
+        serviced = false;
+        for (int irq = 0; irq < SIM_IRQ_NO; ++irq) {
+            if ((true == irqPending[irq]) && (true == irqEnabled[irq]) &&
+                ((0 == basepri) || (irqPrio[irq] < basepri))) {
+                irqPending[irq] = false;
+                inIsr = true;
+                SCB_SHCSR = (SIM_IRQ_SYSTICK == irq) ? SCB_SHCSR_SYSTICKACT : 0;
+                isrHandlers[irq]();
+                SCB_SHCSR = 0;
+                scb_icsr_sync(&SCB_ICSR);
+                inIsr = false;
+                serviced = true;
+                isrServiced = true;
+                // handler could make interrupt of higher priority pending
+                break;
+            }
+        }
+    }
+}
+
+void sim_irq_set_pending(const sim_irq irq) {
+    irqPending[irq] = true;
+    service_interrupts();
+}
+
+void sim_irq_enable(const sim_irq irq, const bool enable) {
+    irqEnabled[irq] = enable;
+    if (true == enable) {
+        service_interrupts();
+    }
+}
+
+void sim_irq_clear_pending(const sim_irq irq) {
+    irqPending[irq] = false;
+}
+
+/// Returns true if some enabled interrupt is pending, masked or not
+static bool interrupt_waiting(void) {
+    for (int irq = 0; irq < SIM_IRQ_NO; ++irq) {
+        if ((true == irqPending[irq]) && (true == irqEnabled[irq])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void sim_wait_for_interrupt(void) {
+    isrServiced = false;
+    while ((false == isrServiced) && (false == interrupt_waiting())) {
+        sim_timer* next = NULL;
+        for (int i = 0; i < timersNo; ++i) {
+            if ((true == timers[i]->active) && ((NULL == next) || (timers[i]->due < next->due))) {
+                next = timers[i];
+            }
+        }
+        if (NULL == next) {
+            sim_fatal("application sleeps forever, nothing is scheduled");
+        }
+        if (next->due > timeLimit) {
+            sim_fatal("time limit exceeded");
+        }
+
+        now = next->due;
+        next->active = false;
+        next->action(next->ctx);
+    }
+    service_interrupts();
+}
+
+void sim_set_time_limit(const uint64_t cycles) {
+    timeLimit = cycles;
+}
+
+void sim_fatal(const char* const msg) {
+    fprintf(stderr, "host_sim: %s at %.6f s\n", msg, (double)now / SIM_CORE_HZ);
+    exit(2);
+}
+
+volatile uint32_t* sim_mmio32(const uint32_t addr) {
+    for (int i = 0; i < regsNo; ++i) {
+        if (regs[i].addr == addr) {
+            if (SIM_SCB_ICSR == addr) {
+                scb_icsr_sync(&regs[i].value);
+            }
+            return &regs[i].value;
+        }
+    }
+    if (regsNo >= SIM_REGS_NO) {
+        sim_fatal("too many registers");
+    }
+    regs[regsNo].addr = addr;
+    regs[regsNo].value = 0;
+    return &regs[regsNo++].value;
+}
+
+volatile uint32_t* sim_bitband(const uint32_t addr, const uint8_t bit) {
+    for (int i = 0; i < bitBandsNo; ++i) {
+        if ((bitBands[i].addr == addr) && (bitBands[i].bit == bit)) {
+            return &bitBands[i].value;
+        }
+    }
+    if (bitBandsNo >= SIM_REGS_NO) {
+        sim_fatal("too many bit-band aliases");
+    }
+    bitBands[bitBandsNo].addr = addr;
+    bitBands[bitBandsNo].bit = bit;
+    bitBands[bitBandsNo].value = (*sim_mmio32(addr) >> bit) & 1;
+    return &bitBands[bitBandsNo++].value;
+}
+
+void sim_gpio_set_input(const uint32_t port, const uint8_t pin_no, const bool level) {
+    // input data register is at offset 8 of the port
+    const uint32_t idrAddr = port + 0x08;
+    volatile uint32_t* const idr = sim_mmio32(idrAddr);
+    *idr = (true == level) ? (*idr | (1UL << pin_no)) : (*idr & ~(1UL << pin_no));
+    *sim_bitband(idrAddr, pin_no) = (true == level) ? 1 : 0;
+}
+
+/// Maps NVIC interrupt number to the simulated interrupt, returns SIM_IRQ_NO if it isn't simulated
+static sim_irq nvic_to_sim(const uint8_t irqn) {
+    switch (irqn) {
+    case NVIC_TIM2_IRQ:           return SIM_IRQ_TIM2;
+    case NVIC_EXTI4_IRQ:          return SIM_IRQ_EXTI4;
+    case NVIC_USB_LP_CAN_RX0_IRQ: return SIM_IRQ_USB_LP;
+    default:                      return SIM_IRQ_NO;
+    }
+}
+
+void nvic_enable_irq(uint8_t irqn) {
+    const sim_irq irq = nvic_to_sim(irqn);
+    if (SIM_IRQ_NO != irq) {
+        sim_irq_enable(irq, true);
+    }
+}
+
+void nvic_disable_irq(uint8_t irqn) {
+    const sim_irq irq = nvic_to_sim(irqn);
+    if (SIM_IRQ_NO != irq) {
+        sim_irq_enable(irq, false);
+    }
+}
+
+void nvic_clear_pending_irq(uint8_t irqn) {
+    const sim_irq irq = nvic_to_sim(irqn);
+    if (SIM_IRQ_NO != irq) {
+        sim_irq_clear_pending(irq);
+    }
+}
+
+void nvic_set_priority(uint8_t irqn, uint8_t priority) {
+    // order of servicing is fixed by sim_irq, it matches irq_prio.h
+    (void)irqn;
+    (void)priority;
+}
+
+void cm_enable_interrupts(void) {
+    primask = false;
+    service_interrupts();
+}
+
+void cm_disable_interrupts(void) {
+    primask = true;
+}
+
+uint32_t cm_mask_interrupts(uint32_t mask) {
+    const uint32_t old = (true == primask) ? 1 : 0;
+    primask = (0 != mask);
+    service_interrupts();
+    return old;
+}
+
+bool cm_is_masked_interrupts(void) {
+    return primask;
+}
+
+uint32_t irq_mask_from(const uint32_t prio) {
+    const uint32_t old = basepri;
+    if ((0 != prio) && ((0 == basepri) || (prio < basepri))) {
+        basepri = prio;
+    }
+    return old;
+}
+
+void irq_unmask(const uint32_t mask) {
+    basepri = mask;
+    service_interrupts();
+}
@@ -0,0 +1,360 @@
+#include <stddef.h>
+#include <libopencm3/stm32/rcc.h>
+#include <libopencm3/stm32/gpio.h>
+#include <libopencm3/stm32/flash.h>
+#include <libopencm3/stm32/timer.h>
+#include <libopencm3/stm32/exti.h>
+#include <libopencm3/cm3/systick.h>
+#include "sim.h"
+#include "sanwa_meter.h"
+
+/*
+ * Clock tree: all clocks are fixed at the values set by the application, so RCC functions only store them.
+ */
+
+uint32_t rcc_ahb_frequency = 8000000;
+uint32_t rcc_apb1_frequency = 8000000;
+uint32_t rcc_apb2_frequency = 8000000;
+
+void rcc_osc_on(enum rcc_osc osc) { (void)osc; }
+void rcc_wait_for_osc_ready(enum rcc_osc osc) { (void)osc; }
+void rcc_set_sysclk_source(uint32_t clk) { (void)clk; }
+void rcc_set_hpre(uint32_t hpre) { (void)hpre; }
+void rcc_set_adcpre(uint32_t adcpre) { (void)adcpre; }
+void rcc_set_ppre1(uint32_t ppre1) { (void)ppre1; }
+void rcc_set_ppre2(uint32_t ppre2) { (void)ppre2; }
+void rcc_set_usbpre(uint32_t usbpre) { (void)usbpre; }
+void rcc_set_pll_multiplication_factor(uint32_t mul) { (void)mul; }
+void rcc_set_pll_source(uint32_t pllsrc) { (void)pllsrc; }
+void rcc_set_pllxtpre(uint32_t pllxtpre) { (void)pllxtpre; }
+void rcc_periph_clock_enable(enum rcc_periph_clken clken) { (void)clken; }
+void flash_set_ws(uint32_t ws) { (void)ws; }
+
+/*
+ * GPIO: outputs are stored in the output data register, inputs are driven by models through sim_gpio_set_input.
+ */
+
+void gpio_set_mode(uint32_t gpioport, uint8_t mode, uint8_t cnf, uint16_t gpios) {
+    (void)gpioport;
+    (void)mode;
+    (void)cnf;
+    (void)gpios;
+}
+
+void gpio_set(uint32_t gpioport, uint16_t gpios) {
+    MMIO32(gpioport + 0x0C) |= gpios;
+}
+
+void gpio_clear(uint32_t gpioport, uint16_t gpios) {
+    MMIO32(gpioport + 0x0C) &= ~(uint32_t)gpios;
+}
+
+void gpio_toggle(uint32_t gpioport, uint16_t gpios) {
+    MMIO32(gpioport + 0x0C) ^= gpios;
+}
+
+uint16_t gpio_get(uint32_t gpioport, uint16_t gpios) {
+    return (uint16_t)(MMIO32(gpioport + 0x08) & gpios);
+}
+
+void gpio_primary_remap(uint32_t swjdisable, uint32_t maps) {
+    AFIO_MAPR = swjdisable | maps;
+}
+
+/*
+ * SysTick counts core cycles of the virtual clock. Its value is 0 at the wrap (interrupt), then it counts down from
+ * the reload value.
+ */
+
+static struct {
+    uint32_t    reload;
+    uint64_t    start;
+    bool        counting;
+    bool        irqEnabled;
+    sim_timer   timer;
+} systick;
+
+static void systick_wrap(void* ctx) {
+    (void)ctx;
+    systick.start = sim_now();
+    sim_timer_start(&systick.timer, systick.start + systick.reload + 1, systick_wrap, NULL);
+    if (true == systick.irqEnabled) {
+        sim_irq_set_pending(SIM_IRQ_SYSTICK);
+    }
+}
+
+bool systick_set_frequency(uint32_t freq, uint32_t ahb) {
+    if ((0 == freq) || ((ahb / freq) > 0x01000000)) {
+        return false;
+    }
+    systick.reload = (ahb / freq) - 1;
+    return true;
+}
+
+void systick_interrupt_enable(void) {
+    systick.irqEnabled = true;
+    sim_irq_enable(SIM_IRQ_SYSTICK, true);
+}
+
+void systick_counter_enable(void) {
+    systick.counting = true;
+    systick.start = sim_now();
+    sim_timer_start(&systick.timer, systick.start + systick.reload + 1, systick_wrap, NULL);
+}
+
+void systick_counter_disable(void) {
+    systick.counting = false;
+    sim_timer_stop(&systick.timer);
+}
+
+void systick_set_reload(uint32_t value) {
+    systick.reload = value & 0x00FFFFFF;
+}
+
+uint32_t systick_get_reload(void) {
+    return systick.reload;
+}
+
+uint32_t systick_get_value(void) {
+    const uint32_t elapsed = (uint32_t)((sim_now() - systick.start) % (systick.reload + 1));
+    return (0 == elapsed) ? 0 : (systick.reload + 1 - elapsed);
+}
+
+void systick_clear(void) {
+    if (true == systick.counting) {
+        systick_counter_enable();
+    }
+}
+
+/*
+ * TIM2: only features used by the IR interface are modelled. Timer clock equals the core clock (APB1 prescaler 2
+ * doubles the timer clock). Compare value is preloaded, so it takes effect on the update event. In one shot PWM1 mode
+ * the output generates the start impulse and compare match of channel 2 is its end, in continuous PWM1 mode it
+ * generates the clock and compare match of channel 2 is the falling edge.
+ */
+
+static struct {
+    uint32_t            psc;
+    uint32_t            arr;
+    uint32_t            ccr;
+    uint32_t            ccrShadow;
+    bool                onePulse;
+    bool                preload;
+    bool                enabled;
+    enum tim_oc_mode    mode;
+    uint32_t            dier;
+    uint32_t            sr;
+    sim_timer           timer;
+} tim2;
+
+/// Returns number of core cycles per timer tick
+static uint64_t tim2_tick(void) {
+    return (uint64_t)tim2.psc + 1;
+}
+
+static void tim2_one_pulse_end(void* ctx) {
+    (void)ctx;
+    // update event stops the counter and loads preloaded values
+    tim2.enabled = false;
+    tim2.ccrShadow = tim2.ccr;
+    tim2.sr |= TIM_SR_UIF;
+}
+
+static void tim2_one_pulse_compare_match(void* ctx) {
+    (void)ctx;
+    // output goes low, the counter runs until the update event
+    const uint64_t updateAt = sim_now() + ((uint64_t)tim2.arr + 1 - tim2.ccrShadow) * tim2_tick();
+    sim_timer_start(&tim2.timer, updateAt, tim2_one_pulse_end, NULL);
+    tim2.sr |= TIM_SR_CC2IF;
+    if (0 != (tim2.dier & TIM_DIER_CC2IE)) {
+        sim_irq_set_pending(SIM_IRQ_TIM2);
+    }
+}
+
+static void tim2_compare_match(void* ctx) {
+    (void)ctx;
+    sim_timer_start(&tim2.timer, sim_now() + ((uint64_t)tim2.arr + 1) * tim2_tick(), tim2_compare_match, NULL);
+    if (TIM_OCM_PWM1 == tim2.mode) {
+        sanwa_meter_clock_edge();
+    }
+    tim2.sr |= TIM_SR_CC2IF;
+    if (0 != (tim2.dier & TIM_DIER_CC2IE)) {
+        sim_irq_set_pending(SIM_IRQ_TIM2);
+    }
+}
+
+void timer_reset(uint32_t timer_peripheral) {
+    (void)timer_peripheral;
+    sim_timer_stop(&tim2.timer);
+    tim2.psc = 0;
+    tim2.arr = 0xFFFF;
+    tim2.ccr = 0;
+    tim2.ccrShadow = 0;
+    tim2.onePulse = false;
+    tim2.preload = false;
+    tim2.enabled = false;
+    tim2.mode = TIM_OCM_FROZEN;
+    tim2.dier = 0;
+    tim2.sr = 0;
+}
+
+void rcc_periph_reset_pulse(enum rcc_periph_rst rst) {
+    if (RST_TIM2 == rst) {
+        timer_reset(TIM2);
+    }
+}
+
+void timer_set_mode(uint32_t timer_peripheral, uint32_t clock_div, uint32_t alignment, uint32_t direction) {
+    (void)timer_peripheral;
+    (void)clock_div;
+    (void)alignment;
+    (void)direction;
+}
+
+void timer_set_prescaler(uint32_t timer_peripheral, uint32_t value) {
+    (void)timer_peripheral;
+    tim2.psc = value;
+}
+
+void timer_enable_preload(uint32_t timer_peripheral) {
+    (void)timer_peripheral;
+}
+
+void timer_one_shot_mode(uint32_t timer_peripheral) {
+    (void)timer_peripheral;
+    tim2.onePulse = true;
+}
+
+void timer_continuous_mode(uint32_t timer_peripheral) {
+    (void)timer_peripheral;
+    tim2.onePulse = false;
+}
+
+void timer_set_period(uint32_t timer_peripheral, uint32_t period) {
+    (void)timer_peripheral;
+    tim2.arr = period;
+}
+
+void timer_disable_oc_output(uint32_t timer_peripheral, enum tim_oc_id oc_id) {
+    (void)timer_peripheral;
+    (void)oc_id;
+}
+
+void timer_enable_oc_output(uint32_t timer_peripheral, enum tim_oc_id oc_id) {
+    (void)timer_peripheral;
+    (void)oc_id;
+}
+
+void timer_set_oc_mode(uint32_t timer_peripheral, enum tim_oc_id oc_id, enum tim_oc_mode oc_mode) {
+    (void)timer_peripheral;
+    (void)oc_id;
+    tim2.mode = oc_mode;
+}
+
+void timer_enable_oc_preload(uint32_t timer_peripheral, enum tim_oc_id oc_id) {
+    (void)timer_peripheral;
+    (void)oc_id;
+    tim2.preload = true;
+}
+
+void timer_set_oc_value(uint32_t timer_peripheral, enum tim_oc_id oc_id, uint32_t value) {
+    (void)timer_peripheral;
+    (void)oc_id;
+    tim2.ccr = value;
+    if (false == tim2.preload) {
+        tim2.ccrShadow = value;
+    }
+}
+
+void timer_generate_event(uint32_t timer_peripheral, uint32_t event) {
+    (void)timer_peripheral;
+    if (0 != (event & TIM_EGR_UG)) {
+        tim2.ccrShadow = tim2.ccr;
+        tim2.sr |= TIM_SR_UIF;
+    }
+}
+
+void timer_clear_flag(uint32_t timer_peripheral, uint32_t flag) {
+    (void)timer_peripheral;
+    tim2.sr &= ~flag;
+}
+
+bool timer_get_flag(uint32_t timer_peripheral, uint32_t flag) {
+    (void)timer_peripheral;
+    return (0 != (tim2.sr & flag));
+}
+
+bool timer_interrupt_source(uint32_t timer_peripheral, uint32_t flag) {
+    (void)timer_peripheral;
+    return (0 != (tim2.sr & tim2.dier & flag));
+}
+
+void timer_enable_irq(uint32_t timer_peripheral, uint32_t irq) {
+    (void)timer_peripheral;
+    tim2.dier |= irq;
+}
+
+void timer_disable_irq(uint32_t timer_peripheral, uint32_t irq) {
+    (void)timer_peripheral;
+    tim2.dier &= ~irq;
+}
+
+void timer_enable_counter(uint32_t timer_peripheral) {
+    (void)timer_peripheral;
+    tim2.enabled = true;
+    const uint64_t now = sim_now();
+
+    if (true == tim2.onePulse) {
+        if ((TIM_OCM_PWM1 == tim2.mode) && (tim2.ccrShadow > 0)) {
+            sanwa_meter_start_pulse(now, now + tim2.ccrShadow * tim2_tick());
+        }
+        if (tim2.ccrShadow <= tim2.arr) {
+            const uint64_t matchAt = now + (uint64_t)tim2.ccrShadow * tim2_tick();
+            sim_timer_start(&tim2.timer, matchAt, tim2_one_pulse_compare_match, NULL);
+        } else {
+            sim_timer_start(&tim2.timer, now + ((uint64_t)tim2.arr + 1) * tim2_tick(), tim2_one_pulse_end, NULL);
+        }
+    } else {
+        sim_timer_start(&tim2.timer, now + (uint64_t)tim2.ccrShadow * tim2_tick(), tim2_compare_match, NULL);
+    }
+}
+
+void timer_disable_counter(uint32_t timer_peripheral) {
+    (void)timer_peripheral;
+    tim2.enabled = false;
+    sim_timer_stop(&tim2.timer);
+}
+
+/*
+ * EXTI: only the enable of lines is modelled, trigger edge is decided by the DMM model.
+ */
+
+static uint32_t extiEnabled = 0;
+
+void exti_select_source(uint32_t exti, uint32_t gpioport) {
+    (void)exti;
+    (void)gpioport;
+}
+
+void exti_set_trigger(uint32_t extis, enum exti_trigger_type trig) {
+    (void)extis;
+    (void)trig;
+}
+
+void exti_enable_request(uint32_t extis) {
+    extiEnabled |= extis;
+}
+
+void exti_disable_request(uint32_t extis) {
+    extiEnabled &= ~extis;
+}
+
+void exti_reset_request(uint32_t extis) {
+    (void)extis;
+}
+
+void sim_exti_trigger(const uint32_t exti_line) {
+    if ((EXTI4 == exti_line) && (0 != (extiEnabled & EXTI4))) {
+        sim_irq_set_pending(SIM_IRQ_EXTI4);
+    }
+}
@@ -0,0 +1,250 @@
+#include <stddef.h>
+#include <string.h>
+#include <libopencm3/usb/usbd.h>
+#include <libopencm3/stm32/st_usbfs.h>
+#include "sim.h"
+#include "sim_usb.h"
+
+/// Time between usbd_init and configuration of the device by the host
+#define SIM_USB_ENUMERATION_CYCLES SIM_US(50000)
+/// Period of Start Of Frame
+#define SIM_USB_SOF_CYCLES SIM_US(1000)
+/// Number of endpoints of the device
+#define SIM_USB_EP_NO 8
+/// Maximal number of events waiting for usbd_poll
+#define SIM_USB_EVENTS_NO 32
+
+struct _usbd_device {
+    int dummy;
+};
+
+struct _usbd_driver {
+    int dummy;
+};
+
+const usbd_driver st_usbfs_v1_usb_driver;
+
+typedef enum {
+    USB_EVT_SET_CONFIG,
+    USB_EVT_OUT,
+    USB_EVT_IN_DONE,
+    USB_EVT_SOF
+} usb_event_type;
+
+typedef struct {
+    usb_event_type  type;
+    uint8_t         ep;
+    uint16_t        len;
+    uint8_t         data[SIM_USB_PACKET_LEN];
+} usb_event;
+
+/// IN endpoint, the packet in it waits for the host
+typedef struct {
+    bool            busy;
+    uint16_t        len;
+    uint8_t         data[SIM_USB_PACKET_LEN];
+    sim_timer       timer;
+} in_endpoint;
+
+static usbd_device device;
+static bool configured = false;
+static usbd_set_config_callback setConfigCallback = NULL;
+static void (*sofCallback)(void) = NULL;
+/// Callbacks of endpoints, indexed by number and direction
+static usbd_endpoint_callback epCallbacks[SIM_USB_EP_NO][2];
+static in_endpoint inEps[SIM_USB_EP_NO];
+
+static usb_event events[SIM_USB_EVENTS_NO];
+static int eventsHead = 0;
+static int eventsNo = 0;
+
+/// Packet received by the OUT endpoint and not read by the application yet
+static usb_event* outPending = NULL;
+
+static uint64_t inLatency = SIM_US(125);
+static sim_usb_host_rx_callback hostRxCallback = NULL;
+static sim_timer enumerationTimer;
+static sim_timer sofTimer;
+
+
+/// Queues the event and makes the USB interrupt pending, returns false if the queue is full
+static bool event_push(const usb_event_type type, const uint8_t ep, const void* const data, const uint16_t len) {
+    if (eventsNo >= SIM_USB_EVENTS_NO) {
+        return false;
+    }
+    usb_event* const evt = &events[(eventsHead + eventsNo) % SIM_USB_EVENTS_NO];
+    ++eventsNo;
+    evt->type = type;
+    evt->ep = ep;
+    evt->len = len;
+    if (len > 0) {
+        memcpy(evt->data, data, len);
+    }
+    sim_irq_set_pending(SIM_IRQ_USB_LP);
+    return true;
+}
+
+static void enumeration_done(void* ctx) {
+    (void)ctx;
+    event_push(USB_EVT_SET_CONFIG, 0, NULL, 0);
+}
+
+static void start_of_frame(void* ctx) {
+    (void)ctx;
+    sim_timer_start(&sofTimer, sim_now() + SIM_USB_SOF_CYCLES, start_of_frame, NULL);
+    *USB_FNR_REG = (*USB_FNR_REG + 1) & USB_FNR_FN;
+    if ((0 != (*USB_CNTR_REG & USB_CNTR_SOFM)) && (NULL != sofCallback)) {
+        event_push(USB_EVT_SOF, 0, NULL, 0);
+    }
+}
+
+/// The host has read the packet
+static void in_transfer_done(void* ctx) {
+    in_endpoint* const inEp = ctx;
+    const uint8_t ep = (uint8_t)(0x80 | (inEp - inEps));
+
+    inEp->busy = false;
+    if (NULL != hostRxCallback) {
+        hostRxCallback(ep, inEp->data, inEp->len);
+    }
+    event_push(USB_EVT_IN_DONE, ep, NULL, 0);
+}
+
+usbd_device *usbd_init(const usbd_driver *driver, const struct usb_device_descriptor *dev,
+                       const struct usb_config_descriptor *conf, const char **strings, int num_strings,
+                       uint8_t *control_buffer, uint16_t control_buffer_size) {
+    (void)driver;
+    (void)dev;
+    (void)conf;
+    (void)strings;
+    (void)num_strings;
+    (void)control_buffer;
+    (void)control_buffer_size;
+
+    sim_timer_start(&enumerationTimer, sim_now() + SIM_USB_ENUMERATION_CYCLES, enumeration_done, NULL);
+    sim_timer_start(&sofTimer, sim_now() + SIM_USB_SOF_CYCLES, start_of_frame, NULL);
+    return &device;
+}
+
+void usbd_poll(usbd_device *usbd_dev) {
+    while (eventsNo > 0) {
+        usb_event* const evt = &events[eventsHead];
+        const uint8_t epNo = evt->ep & 0x0F;
+        const int dir = (0 != (evt->ep & 0x80)) ? 1 : 0;
+
+        switch (evt->type) {
+        case USB_EVT_SET_CONFIG:
+            configured = true;
+            if (NULL != setConfigCallback) {
+                setConfigCallback(usbd_dev, 1);
+            }
+            break;
+        case USB_EVT_OUT:
+            outPending = evt;
+            if (NULL != epCallbacks[epNo][dir]) {
+                epCallbacks[epNo][dir](usbd_dev, evt->ep);
+            }
+            outPending = NULL;
+            break;
+        case USB_EVT_IN_DONE:
+            if (NULL != epCallbacks[epNo][dir]) {
+                epCallbacks[epNo][dir](usbd_dev, evt->ep);
+            }
+            break;
+        case USB_EVT_SOF:
+            if (NULL != sofCallback) {
+                sofCallback();
+            }
+            break;
+        }
+
+        eventsHead = (eventsHead + 1) % SIM_USB_EVENTS_NO;
+        --eventsNo;
+    }
+}
+
+int usbd_register_set_config_callback(usbd_device *usbd_dev, usbd_set_config_callback callback) {
+    (void)usbd_dev;
+    setConfigCallback = callback;
+    return 0;
+}
+
+int usbd_register_control_callback(usbd_device *usbd_dev, uint8_t type, uint8_t type_mask,
+                                   usbd_control_callback callback) {
+    // control transfers of CDC class are not issued by the simulated host
+    (void)usbd_dev;
+    (void)type;
+    (void)type_mask;
+    (void)callback;
+    return 0;
+}
+
+void usbd_register_sof_callback(usbd_device *usbd_dev, void (*callback)(void)) {
+    (void)usbd_dev;
+    sofCallback = callback;
+}
+
+void usbd_ep_setup(usbd_device *usbd_dev, uint8_t addr, uint8_t type, uint16_t max_size,
+                   usbd_endpoint_callback callback) {
+    (void)usbd_dev;
+    (void)type;
+    (void)max_size;
+    epCallbacks[addr & 0x0F][(0 != (addr & 0x80)) ? 1 : 0] = callback;
+    if (0 != (addr & 0x80)) {
+        sim_timer_stop(&inEps[addr & 0x0F].timer);
+        inEps[addr & 0x0F].busy = false;
+    }
+}
+
+uint16_t usbd_ep_write_packet(usbd_device *usbd_dev, uint8_t addr, const void *buf, uint16_t len) {
+    (void)usbd_dev;
+    in_endpoint* const inEp = &inEps[addr & 0x0F];
+
+    if ((true == inEp->busy) || (len > SIM_USB_PACKET_LEN)) {
+        return 0;
+    }
+
+    memcpy(inEp->data, buf, len);
+    inEp->len = len;
+    inEp->busy = true;
+    sim_timer_start(&inEp->timer, sim_now() + inLatency, in_transfer_done, inEp);
+    return len;
+}
+
+uint16_t usbd_ep_read_packet(usbd_device *usbd_dev, uint8_t addr, void *buf, uint16_t len) {
+    (void)usbd_dev;
+    if ((NULL == outPending) || (outPending->ep != addr)) {
+        return 0;
+    }
+
+    const uint16_t readLen = (outPending->len < len) ? outPending->len : len;
+    memcpy(buf, outPending->data, readLen);
+    outPending->len = 0;
+    return readLen;
+}
+
+void usbd_ep_nak_set(usbd_device *usbd_dev, uint8_t addr, uint8_t nak) {
+    (void)usbd_dev;
+    (void)addr;
+    (void)nak;
+}
+
+void sim_usb_set_in_latency(const uint64_t cycles) {
+    inLatency = cycles;
+}
+
+void sim_usb_register_host_rx_callback(sim_usb_host_rx_callback callback) {
+    hostRxCallback = callback;
+}
+
+bool sim_usb_is_configured(void) {
+    return configured;
+}
+
+bool sim_usb_host_send(const uint8_t ep, const void* const data, const uint16_t len) {
+    if ((false == configured) || (len > SIM_USB_PACKET_LEN)) {
+        return false;
+    }
+
+    return event_push(USB_EVT_OUT, ep, data, len);
+}
@@ -0,0 +1,34 @@
+#ifndef SIM_USB_H_
+#define SIM_USB_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @file Model of the USB device peripheral together with the USB host.
+ *
+ * Replaces the USB stack of libopencm3: the device is configured by the host shortly after usbd_init, afterwards
+ * bulk packets are transferred in both directions. A packet written by the application to the endpoint is read by
+ * the host after the IN latency, then its transfer complete callback runs. Each event is delivered to the application
+ * by the USB low priority interrupt which calls usbd_poll. Start Of Frame is generated each ms.
+ */
+
+/// Maximal size of bulk packet
+#define SIM_USB_PACKET_LEN 64
+
+/// Called when the host has read the packet from the IN endpoint
+typedef void (*sim_usb_host_rx_callback)(const uint8_t ep, const uint8_t* const data, const uint16_t len);
+
+/// Sets time between the write of the packet to the IN endpoint and its reading by the host
+void sim_usb_set_in_latency(const uint64_t cycles);
+
+/// Registers callback of the host called for each packet read from the device
+void sim_usb_register_host_rx_callback(sim_usb_host_rx_callback callback);
+
+/// Returns true when the host has configured the device
+bool sim_usb_is_configured(void);
+
+/// Sends the packet from the host to the OUT endpoint, returns false if it can't be queued
+bool sim_usb_host_send(const uint8_t ep, const void* const data, const uint16_t len);
+
+#endif // SIM_USB_H_
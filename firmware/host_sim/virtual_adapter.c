@@ -0,0 +1,397 @@
+/*
+ * Virtual adapters on pseudo-terminals, for load testing of host software without hardware.
+ *
+ * Each virtual adapter is a PTY which behaves like the CDC interface of the adapter for Brymen data requests: requests
+ * are found by the parser of the application (check_data_req.c) and answered with data packets built by its
+ * bm_create_pkt from raw DMM frames. Like the adapter, one reading of DMM serves one pending request, so requests sent
+ * while reading is in progress wait for the next readings, one reading each. Adapter specific commands are not
+ * supported.
+ *
+ * Duration of reading is --latency-ms plus uniformly distributed jitter up to --jitter-ms. With probability --drop
+ * the DMM doesn't answer: no packet is sent and the adapter is busy for --drop-timeout-ms, like the real one waiting
+ * for DMM.
+ *
+ * Raw frames are synthetic (a DC voltage counting up with each reading) or read from --frames file. The file uses the
+ * 'frame' and 'silent' steps of the DMM model script (see sanwa_meter.h), other steps are ignored. Each adapter cycles
+ * through the frames independently, a 'silent' step is a dropped reading.
+ *
+ * Usage: virtual_adapter [--count N] [--link-dir DIR] [--latency-ms MS] [--jitter-ms MS] [--drop P]
+ *                        [--drop-timeout-ms MS] [--frames FILE] [--seed N]
+ *
+ * Path of each PTY is printed, with --link-dir a symlink DIR/adapterN is created too. Statistics are printed on
+ * SIGINT or SIGTERM.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "check_data_req.h"
+#include "bm_dmm_protocol.h"
+
+/// Number of bytes of the raw DMM frame
+#define RAW_FRAME_BYTES 16
+/// Maximal number of frames loaded from file
+#define FRAMES_NO 256
+
+typedef struct {
+    bool        silent;
+    uint8_t     raw[RAW_FRAME_BYTES];
+} raw_frame;
+
+typedef struct {
+    int             master;
+    int             slave;
+    char            path[64];
+    data_req_parser parser;
+    /// Requests waiting for readings of DMM
+    uint32_t        pending;
+    /// Reading of DMM in progress, it ends at doneUs
+    bool            busy;
+    bool            answers;
+    uint64_t        doneUs;
+    uint32_t        frameIdx;
+    uint32_t        readings;
+    uint64_t        requests;
+    uint64_t        packets;
+    uint64_t        dropped;
+    uint64_t        writeErrors;
+} adapter;
+
+static struct {
+    uint32_t    count;
+    const char* linkDir;
+    uint32_t    latencyMs;
+    uint32_t    jitterMs;
+    double      drop;
+    uint32_t    dropTimeoutMs;
+    const char* framesFile;
+    uint32_t    seed;
+} opts = {
+    .count = 1,
+    .linkDir = NULL,
+    .latencyMs = 34,
+    .jitterMs = 0,
+    .drop = 0.0,
+    .dropTimeoutMs = 2000,
+    .framesFile = NULL,
+    .seed = 1,
+};
+
+static raw_frame frames[FRAMES_NO];
+static uint32_t framesNo = 0;
+static volatile sig_atomic_t stop = 0;
+
+/// Segments of digits 0..9 in the raw frame
+static const uint8_t rawDigits[10] = {0xBE, 0xA0, 0xDA, 0xF8, 0xE4, 0x7C, 0x7E, 0xA8, 0xFE, 0xFC};
+
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+/// xorshift32, deterministic for given seed
+static uint32_t rng_next(void) {
+    static uint32_t state = 0;
+    if (0 == state) {
+        state = (0 != opts.seed) ? opts.seed : 1;
+    }
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+/// Synthetic frame: positive DC millivolts, six digits counting the readings, decimal point after the first one
+static void synthetic_frame(const uint32_t reading, raw_frame* const frame) {
+    memset(frame, 0, sizeof(*frame));
+    frame->raw[0] = 0x09;
+    uint32_t value = reading % 1000000;
+    for (int digit = 6; digit >= 1; --digit) {
+        frame->raw[digit] = rawDigits[value % 10];
+        value /= 10;
+    }
+    frame->raw[2] |= 0x01;
+    frame->raw[7] = 0xA0;
+}
+
+static bool load_frames(const char* const path) {
+    FILE* const file = fopen(path, "r");
+    if (NULL == file) {
+        fprintf(stderr, "virtual_adapter: can't open %s\n", path);
+        return false;
+    }
+
+    bool retval = true;
+    char line[256];
+    int lineNo = 0;
+    while ((true == retval) && (NULL != fgets(line, sizeof(line), file))) {
+        ++lineNo;
+        char* const comment = strchr(line, '#');
+        if (NULL != comment) {
+            *comment = '\0';
+        }
+
+        char keyword[16] = "";
+        char arg[64] = "";
+        unsigned long repeat = 1;
+        const int fields = sscanf(line, "%15s %63s %lu", keyword, arg, &repeat);
+        raw_frame frame = {0};
+
+        if (0 == strcmp(keyword, "frame")) {
+            retval = (fields >= 2) && (RAW_FRAME_BYTES * 2 == strlen(arg));
+            for (int i = 0; (true == retval) && (i < RAW_FRAME_BYTES); ++i) {
+                unsigned int byte = 0;
+                retval = (1 == sscanf(&arg[i * 2], "%2x", &byte));
+                frame.raw[i] = (uint8_t)byte;
+            }
+        } else if (0 == strcmp(keyword, "silent")) {
+            frame.silent = true;
+            repeat = (fields >= 2) ? strtoul(arg, NULL, 0) : 1;
+        } else {
+            continue;
+        }
+
+        for (unsigned long i = 0; (true == retval) && (i < repeat); ++i) {
+            retval = (framesNo < FRAMES_NO);
+            if (true == retval) {
+                frames[framesNo++] = frame;
+            }
+        }
+        if (false == retval) {
+            fprintf(stderr, "virtual_adapter: %s:%d: invalid or too many frames\n", path, lineNo);
+        }
+    }
+
+    fclose(file);
+    return (true == retval) && (framesNo > 0);
+}
+
+static bool open_adapter(adapter* const adp, const uint32_t no) {
+    memset(adp, 0, sizeof(*adp));
+    adp->master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if ((adp->master < 0) || (0 != grantpt(adp->master)) || (0 != unlockpt(adp->master))) {
+        perror("virtual_adapter: posix_openpt");
+        return false;
+    }
+    snprintf(adp->path, sizeof(adp->path), "%s", ptsname(adp->master));
+
+    // slave side is kept open, so the master doesn't see hang up when clients close the port
+    adp->slave = open(adp->path, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if ((adp->slave < 0) || (0 != tcgetattr(adp->slave, &tio))) {
+        perror("virtual_adapter: slave of PTY");
+        return false;
+    }
+    cfmakeraw(&tio);
+    tcsetattr(adp->slave, TCSANOW, &tio);
+
+    data_req_parser_init(&adp->parser);
+    adp->frameIdx = no;
+
+    if (NULL != opts.linkDir) {
+        char link[256];
+        snprintf(link, sizeof(link), "%s/adapter%u", opts.linkDir, no);
+        unlink(link);
+        if (0 != symlink(adp->path, link)) {
+            perror("virtual_adapter: symlink");
+            return false;
+        }
+        printf("%s -> %s\n", link, adp->path);
+    } else {
+        printf("%s\n", adp->path);
+    }
+    return true;
+}
+
+/// Starts reading of DMM which serves the oldest pending request
+static void start_reading(adapter* const adp, const uint64_t now) {
+    bool answers = (rng_next() / 4294967296.0) >= opts.drop;
+    if (framesNo > 0) {
+        answers = answers && (false == frames[adp->frameIdx % framesNo].silent);
+    }
+
+    uint64_t durationUs = (true == answers) ? (uint64_t)opts.latencyMs * 1000 : (uint64_t)opts.dropTimeoutMs * 1000;
+    if ((true == answers) && (opts.jitterMs > 0)) {
+        durationUs += rng_next() % ((uint64_t)opts.jitterMs * 1000 + 1);
+    }
+
+    --adp->pending;
+    adp->busy = true;
+    adp->answers = answers;
+    adp->doneUs = now + durationUs;
+}
+
+/// Ends reading of DMM, sends the data packet if DMM answered
+static void end_reading(adapter* const adp) {
+    adp->busy = false;
+    ++adp->readings;
+
+    raw_frame frame;
+    if (framesNo > 0) {
+        frame = frames[adp->frameIdx % framesNo];
+    } else {
+        synthetic_frame(adp->frameIdx, &frame);
+    }
+    ++adp->frameIdx;
+
+    if (false == adp->answers) {
+        ++adp->dropped;
+        return;
+    }
+
+    data_resp_pkt packet;
+    if (BM_PKG_CREATED != bm_create_pkt(frame.raw, RAW_FRAME_BYTES, &packet)) {
+        ++adp->dropped;
+        return;
+    }
+    // nobody reading the port, or its buffer is full -> the packet is lost like in USB endpoint without host
+    if (sizeof(packet) == write(adp->master, &packet, sizeof(packet))) {
+        ++adp->packets;
+    } else {
+        ++adp->writeErrors;
+    }
+}
+
+static void print_stats(const adapter* const adapters) {
+    uint64_t requests = 0;
+    uint64_t packets = 0;
+    uint64_t dropped = 0;
+    uint64_t writeErrors = 0;
+    for (uint32_t i = 0; i < opts.count; ++i) {
+        requests += adapters[i].requests;
+        packets += adapters[i].packets;
+        dropped += adapters[i].dropped;
+        writeErrors += adapters[i].writeErrors;
+    }
+    printf("adapters=%u\nrequests=%llu\npackets=%llu\ndropped=%llu\nwrite_errors=%llu\n", opts.count,
+           (unsigned long long)requests, (unsigned long long)packets, (unsigned long long)dropped,
+           (unsigned long long)writeErrors);
+    fflush(stdout);
+}
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static void usage(const char* const prog) {
+    fprintf(stderr, "Usage: %s [--count N] [--link-dir DIR] [--latency-ms MS] [--jitter-ms MS] [--drop P] "
+                    "[--drop-timeout-ms MS] [--frames FILE] [--seed N]\n", prog);
+    exit(2);
+}
+
+static void parse_options(int argc, char** argv) {
+    static const struct option longOpts[] = {
+        {"count",           required_argument, NULL, 'n'},
+        {"link-dir",        required_argument, NULL, 'd'},
+        {"latency-ms",      required_argument, NULL, 'l'},
+        {"jitter-ms",       required_argument, NULL, 'j'},
+        {"drop",            required_argument, NULL, 'p'},
+        {"drop-timeout-ms", required_argument, NULL, 't'},
+        {"frames",          required_argument, NULL, 'f'},
+        {"seed",            required_argument, NULL, 'r'},
+        {NULL, 0, NULL, 0}
+    };
+
+    int opt;
+    while (-1 != (opt = getopt_long(argc, argv, "", longOpts, NULL))) {
+        switch (opt) {
+        case 'n': opts.count = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'd': opts.linkDir = optarg; break;
+        case 'l': opts.latencyMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'j': opts.jitterMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'p': opts.drop = strtod(optarg, NULL); break;
+        case 't': opts.dropTimeoutMs = (uint32_t)strtoul(optarg, NULL, 0); break;
+        case 'f': opts.framesFile = optarg; break;
+        case 'r': opts.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+        default: usage(argv[0]);
+        }
+    }
+    if ((optind < argc) || (0 == opts.count) || (opts.drop < 0.0) || (opts.drop > 1.0)) {
+        usage(argv[0]);
+    }
+}
+
+int main(int argc, char** argv) {
+    parse_options(argc, argv);
+    if ((NULL != opts.framesFile) && (false == load_frames(opts.framesFile))) {
+        return 2;
+    }
+
+    adapter* const adapters = calloc(opts.count, sizeof(adapter));
+    struct pollfd* const fds = calloc(opts.count, sizeof(struct pollfd));
+    if ((NULL == adapters) || (NULL == fds)) {
+        return 2;
+    }
+    for (uint32_t i = 0; i < opts.count; ++i) {
+        if (false == open_adapter(&adapters[i], i)) {
+            return 2;
+        }
+        fds[i].fd = adapters[i].master;
+        fds[i].events = POLLIN;
+    }
+    fflush(stdout);
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    while (0 == stop) {
+        // sleep until some reading ends or requests come
+        uint64_t now = now_us();
+        int timeoutMs = -1;
+        for (uint32_t i = 0; i < opts.count; ++i) {
+            if (true == adapters[i].busy) {
+                const int due = (adapters[i].doneUs > now) ? (int)((adapters[i].doneUs - now + 999) / 1000) : 0;
+                timeoutMs = ((timeoutMs < 0) || (due < timeoutMs)) ? due : timeoutMs;
+            }
+        }
+
+        const int ready = poll(fds, opts.count, timeoutMs);
+        if ((ready < 0) && (EINTR != errno)) {
+            perror("virtual_adapter: poll");
+            break;
+        }
+
+        now = now_us();
+        for (uint32_t i = 0; i < opts.count; ++i) {
+            adapter* const adp = &adapters[i];
+            if ((ready > 0) && (0 != (fds[i].revents & POLLIN))) {
+                uint8_t buff[256];
+                const ssize_t len = read(adp->master, buff, sizeof(buff));
+                if (len > 0) {
+                    const uint8_t requestsNo = data_req_parser_check(&adp->parser, buff, (size_t)len);
+                    adp->pending += requestsNo;
+                    adp->requests += requestsNo;
+                }
+            }
+            if ((true == adp->busy) && (now >= adp->doneUs)) {
+                end_reading(adp);
+            }
+            if ((false == adp->busy) && (adp->pending > 0)) {
+                start_reading(adp, now);
+            }
+        }
+    }
+
+    print_stats(adapters);
+    if (NULL != opts.linkDir) {
+        for (uint32_t i = 0; i < opts.count; ++i) {
+            char link[256];
+            snprintf(link, sizeof(link), "%s/adapter%u", opts.linkDir, i);
+            unlink(link);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+"""
+Smoke test of the reference results of isa_bench.py (isa_bench_reference.csv, written by 'make reference').
+
+Checks that the file has the columns and all cases of isa_bench.py with the number of calls it makes, that the
+figures of each case are consistent (each instruction takes a cycle at least, means don't exceed maximums, us match
+cycles at --mhz) and that the mean time of each interrupt handler fits its budget of wcet.cfg. Needs python3 only, so
+it runs where the reference can't be generated.
+
+Usage: check_reference.py [--mhz 48] [--config wcet.cfg] [CSV]
+Exits with 1 and prints the problems when the check fails.
+"""
+import argparse
+import configparser
+import csv
+import os
+import sys
+
+FIELDS = ['function', 'case', 'calls', 'instructions', 'max_instructions', 'cycles', 'max_cycles', 'us']
+# cases of run_benchmarks in isa_bench.py and the number of calls of each
+CASES = {
+    ('bm_create_pkt', 'corpus'): 8,
+    ('data_req_parser_check', 'single_request'): 1,
+    ('data_req_parser_check', 'full_packet'): 1,
+    ('data_req_parser_check', 'mixed_packet'): 1,
+    ('sys_tick_handler', 'tick'): 10,
+    ('exti4_isr', 'dmm_ready'): 1,
+    ('tim2_isr', 'bit'): 128,
+}
+
+
+def check_row(row, mhz, budgets):
+    """Returns list of problems of the row."""
+    key = '%s,%s' % (row['function'], row['case'])
+    try:
+        calls = int(row['calls'])
+        instructions = float(row['instructions'])
+        max_instructions = int(row['max_instructions'])
+        cycles = float(row['cycles'])
+        max_cycles = int(row['max_cycles'])
+        us = float(row['us'])
+    except (TypeError, ValueError):
+        return ['%s: not a number' % key]
+
+    problems = []
+    expected_calls = CASES[(row['function'], row['case'])]
+    if calls != expected_calls:
+        problems.append('%s: %d calls, %d expected' % (key, calls, expected_calls))
+    if not 0 < instructions <= max_instructions:
+        problems.append('%s: mean of %.1f instructions, maximum %d' % (key, instructions, max_instructions))
+    if not instructions <= cycles <= max_cycles:
+        problems.append('%s: mean of %.1f cycles for %.1f instructions, maximum %d' %
+                        (key, cycles, instructions, max_cycles))
+    if max_cycles < max_instructions:
+        problems.append('%s: maximum of %d cycles for %d instructions' % (key, max_cycles, max_instructions))
+    if abs(us - cycles / mhz) > 0.001:
+        problems.append('%s: %.3f us for %.1f cycles at %g MHz' % (key, us, cycles, mhz))
+    if row['function'] in budgets and us > budgets[row['function']]:
+        problems.append('%s: %.3f us, budget %g us' % (key, us, budgets[row['function']]))
+    return problems
+
+
+def check(path, mhz, budgets):
+    """Returns list of problems of the reference."""
+    with open(path, newline='') as f:
+        reader = csv.DictReader(f)
+        if reader.fieldnames != FIELDS:
+            return ['columns %s, %s expected' % (reader.fieldnames, FIELDS)]
+        rows = list(reader)
+
+    problems = []
+    seen = set()
+    for row in rows:
+        key = (row['function'], row['case'])
+        if key not in CASES:
+            problems.append('%s,%s: unknown case' % key)
+        elif key in seen:
+            problems.append('%s,%s: repeated' % key)
+        else:
+            seen.add(key)
+            problems += check_row(row, mhz, budgets)
+    problems += ['%s,%s: missing' % key for key in CASES if key not in seen]
+    return problems
+
+
+def main():
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('csv', nargs='?', default=os.path.join(here, 'isa_bench_reference.csv'),
+                        help='results of isa_bench.py --csv, default isa_bench_reference.csv')
+    parser.add_argument('--mhz', type=float, default=48, help='core clock the results were made at, default 48')
+    parser.add_argument('--config', default=os.path.join(here, 'wcet.cfg'), help='budgets, default wcet.cfg')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.csv):
+        sys.exit('%s not found, run \'make reference\' where the image can be built' % args.csv)
+    config = configparser.ConfigParser()
+    config.read(args.config)
+    budgets = {name: float(value) for name, value in config.items('budgets_us')} \
+        if config.has_section('budgets_us') else {}
+
+    problems = check(args.csv, args.mhz, budgets)
+    for problem in problems:
+        print(problem, file=sys.stderr)
+    if problems:
+        sys.exit(1)
+    print('%s: %d cases OK' % (args.csv, len(CASES)))
+
+
+if __name__ == '__main__':
+    main()
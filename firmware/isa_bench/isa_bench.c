@@ -0,0 +1,102 @@
+/*
+ * Target side of the instruction set simulator benchmarks, see isa_bench.py.
+ *
+ * The image is the Cortex-M3 build of the measured application modules with this file instead of main.c. It is never
+ * started: isa_bench.py loads it into the simulator and calls the functions below and the interrupt handlers
+ * directly, counting executed instructions. The makefile passes them to the linker as undefined symbols, so they are
+ * kept although nothing calls them.
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include "bm_dmm_protocol.h"
+#include "bm_protocol_defs.h"
+#include "check_data_req.h"
+#include "ir_interface.h"
+
+#define RAW_IR_DIGIT_0 0xbe
+#define RAW_IR_DIGIT_1 0xa0
+#define RAW_IR_DIGIT_2 0xda
+#define RAW_IR_DIGIT_3 0xf8
+#define RAW_IR_DIGIT_4 0xe4
+#define RAW_IR_DIGIT_5 0x7c
+#define RAW_IR_DIGIT_6 0x7e
+#define RAW_IR_DIGIT_7 0xa8
+#define RAW_IR_DIGIT_8 0xfe
+#define RAW_IR_DIGIT_9 0xfc
+#define RAW_IR_DIGIT_L 0x16
+#define RAW_IR_DOT     0x01
+
+#define PACKET_LEN  64
+
+void isa_bench_decode(const uint32_t frame_no);
+void isa_bench_parse(const uint32_t case_no);
+void isa_bench_ir_start(void);
+int main(void);
+
+/// Frames of readings shown usually, the same ones as of the host benchmark of the decoder
+static const uint8_t frames[][IR_DATA_BYTES] = {
+    // -0.1234 mV AC
+    {0x07, RAW_IR_DIGIT_0, RAW_IR_DIGIT_1 | RAW_IR_DOT, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3, RAW_IR_DIGIT_4, 0x00, 0xa0},
+    // 12.3458 uV DC
+    {0x09, RAW_IR_DIGIT_1, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3 | RAW_IR_DOT, RAW_IR_DIGIT_4, RAW_IR_DIGIT_5,
+     RAW_IR_DIGIT_8, 0xc0},
+    // 102.37 kOhm
+    {0x01, RAW_IR_DIGIT_1, RAW_IR_DIGIT_0, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3 | RAW_IR_DOT, RAW_IR_DIGIT_7, 0x00, 0x00,
+     0x06},
+    // 91.3790 nA, autorange
+    {0x8d, RAW_IR_DIGIT_9, RAW_IR_DIGIT_1, RAW_IR_DIGIT_3 | RAW_IR_DOT, RAW_IR_DIGIT_7, RAW_IR_DIGIT_9,
+     RAW_IR_DIGIT_0, 0x0c},
+    // OL
+    {0x0d, 0x00, 0x00, RAW_IR_DIGIT_0 | RAW_IR_DOT, RAW_IR_DIGIT_L, 0x00, 0x00, 0x0c},
+    // 5.6789 V DC, autorange
+    {0x89, RAW_IR_DIGIT_5 | RAW_IR_DOT, RAW_IR_DIGIT_6, RAW_IR_DIGIT_7, RAW_IR_DIGIT_8, RAW_IR_DIGIT_9, 0x00, 0x00},
+    // 230.41 V AC
+    {0x05, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3, RAW_IR_DIGIT_0 | RAW_IR_DOT, RAW_IR_DIGIT_4, RAW_IR_DIGIT_1, 0x00, 0x00},
+    // -0.0003 V DC
+    {0x0b, RAW_IR_DIGIT_0 | RAW_IR_DOT, RAW_IR_DIGIT_0, RAW_IR_DIGIT_0, RAW_IR_DIGIT_0, RAW_IR_DIGIT_3, 0x00, 0x00},
+};
+#define FRAMES_NO   (sizeof(frames) / sizeof(frames[0]))
+
+#define REQ         BM_DLE_CONST, BM_STX_CONST, BM_DATA_REQ_COMMAND, 0, 0, 0, BM_DLE_CONST, BM_ETX_CONST
+#define STREAM_CMD  BM_DLE_CONST, BM_STX_CONST, BM_ADAPTER_CMD_STREAM_START, 100, 0, 100, BM_DLE_CONST, BM_ETX_CONST
+
+/// USB packets of the parser cases: single request, packet full of requests, requests mixed with commands
+static const uint8_t singleRequest[] = {REQ};
+static const uint8_t fullPacket[PACKET_LEN] = {REQ, REQ, REQ, REQ, REQ, REQ, REQ, REQ};
+static const uint8_t mixedPacket[PACKET_LEN] = {STREAM_CMD, REQ, REQ, STREAM_CMD, REQ, REQ, STREAM_CMD, REQ};
+
+static const struct {
+    const uint8_t*  data;
+    size_t          len;
+} parseCases[] = {
+    {singleRequest, sizeof(singleRequest)},
+    {fullPacket, sizeof(fullPacket)},
+    {mixedPacket, sizeof(mixedPacket)},
+};
+#define PARSE_CASES_NO  (sizeof(parseCases) / sizeof(parseCases[0]))
+
+static data_resp_pkt packet;
+static data_req_parser parser;
+static uint8_t irBuffer[IR_DATA_BYTES];
+
+/// Decodes frame of the corpus, frame_no < FRAMES_NO (the caller keeps in range, so no division is measured)
+void isa_bench_decode(const uint32_t frame_no) {
+    bm_create_pkt(frames[frame_no], IR_DATA_BYTES, &packet);
+}
+
+/// Parses USB packet of the case, case_no < PARSE_CASES_NO
+void isa_bench_parse(const uint32_t case_no) {
+    data_req_parser_check(&parser, parseCases[case_no].data, parseCases[case_no].len);
+}
+
+/// Starts reading of the frame, so exti4_isr and tim2_isr find the state they expect
+void isa_bench_ir_start(void) {
+    ir_itf_init_nb();
+    ir_itf_start_read_nb(irBuffer, sizeof(irBuffer));
+}
+
+int main(void) {
+    for (;;) {
+    }
+    return 0;
+}
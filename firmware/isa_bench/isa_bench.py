@@ -0,0 +1,249 @@
+#!/usr/bin/env python3
+"""
+Runs the Cortex-M3 build of the decoder, the data request parser and interrupt handlers (isa_bench.c, see makefile)
+in the unicorn CPU emulator and reports executed instructions and estimated cycles per call.
+
+Instruction counts are exact for the ISA and deterministic, so they are suitable for regression checks. Cycles are
+estimated from the Cortex-M3 instruction timings of m3_timing.py:
+  - change of the program flow (taken branch, BL, BX, POP/LDR to PC) adds the pipeline refill (--refill, 2)
+  - flash wait states (--wait-states, 1 at 48 MHz) are added to each refill from flash and to each data read from
+    flash, code in RAM (ramfunc.h) runs without them
+Sequential fetches from flash are assumed to be hidden by the prefetch buffer. Peripheral accesses are counted, not
+timed, their bus wait states aren't modelled.
+
+Peripherals are plain memory: interrupt handlers run with the register values the previous code left there; the
+benchmark sets the flags a handler checks before calling it.
+
+Usage: isa_bench.py [--mhz 48] [--wait-states 1] [--refill 2] [--csv FILE] [--baseline FILE] [--threshold 5] ELF
+Output: CSV lines function,case,calls,instructions,max_instructions,cycles,max_cycles,us (means per call, us at
+--mhz). With --baseline, reports the change of cycles of each case and exits with 1 when instructions of any case
+grew by more than --threshold percents.
+Requires unicorn 2, capstone and pyelftools.
+"""
+import argparse
+import csv
+import sys
+
+from capstone import Cs, CS_ARCH_ARM, CS_MODE_THUMB, CS_MODE_MCLASS
+from elftools.elf.elffile import ELFFile
+from unicorn import Uc, UcError, UC_ARCH_ARM, UC_MODE_THUMB, UC_MODE_MCLASS, UC_HOOK_CODE, UC_HOOK_MEM_READ, \
+    UC_HOOK_MEM_WRITE, UC_HOOK_MEM_UNMAPPED
+from unicorn.arm_const import UC_ARM_REG_R0, UC_ARM_REG_R1, UC_ARM_REG_R2, UC_ARM_REG_R3, UC_ARM_REG_SP, \
+    UC_ARM_REG_LR, UC_ARM_REG_PC, UC_CPU_ARM_CORTEX_M3
+
+from m3_timing import REFILL, instruction_cycles
+
+FLASH = (0x08000000, 0x20000)
+RAM = (0x20000000, 0x10000)
+RAM_TOP = 0x20005000  # 20 kB of STM32F103C8
+PERIPH = (0x40000000, 0x30000)
+PERIPH_BITBAND = (0x42000000, 0x2000000)
+PPB = (0xE0000000, 0x100000)
+STOP = (0x0FFF0000, 0x1000)  # return address of calls
+MAX_INSTRUCTIONS = 1000000
+
+TIM2_SR = 0x40000010
+TIM_SR_CC2IF = 1 << 2
+
+FRAMES_NO = 8  # frames of isa_bench.c
+PARSE_CASES = ['single_request', 'full_packet', 'mixed_packet']  # parseCases of isa_bench.c
+IR_BITS_NO = 128
+
+
+def in_region(addr, region):
+    return region[0] <= addr < region[0] + region[1]
+
+
+class Counter:
+    """Counts instructions and estimates cycles of one call."""
+
+    def __init__(self, wait_states, refill):
+        self.wait_states = wait_states
+        self.refill = refill
+        self.disasm = Cs(CS_ARCH_ARM, CS_MODE_THUMB | CS_MODE_MCLASS)
+        self.costs = {}
+        self.reset()
+
+    def reset(self):
+        self.instructions = 0
+        self.cycles = 0
+        self.flash_reads = 0
+        self.periph_accesses = 0
+        self.next_addr = None
+
+    def cost(self, uc, addr, size):
+        if addr not in self.costs:
+            insn = next(self.disasm.disasm(bytes(uc.mem_read(addr, size)), addr), None)
+            self.costs[addr] = instruction_cycles(insn.mnemonic, insn.op_str) if insn is not None else 1
+        return self.costs[addr]
+
+    def on_code(self, uc, addr, size, _):
+        if self.next_addr is not None and addr != self.next_addr:
+            self.cycles += self.refill + (self.wait_states if in_region(addr, FLASH) else 0)
+        self.next_addr = addr + size
+        self.instructions += 1
+        self.cycles += self.cost(uc, addr, size)
+
+    def on_mem(self, uc, access, addr, size, value, _):
+        if in_region(addr, FLASH):
+            self.flash_reads += 1
+            self.cycles += self.wait_states
+        elif in_region(addr, PERIPH) or in_region(addr, PERIPH_BITBAND):
+            self.periph_accesses += 1
+
+    def finish(self):
+        # return from the call
+        self.cycles += self.refill + self.wait_states
+
+
+class Target:
+    """The image loaded into the emulator, its functions can be called by name."""
+
+    def __init__(self, elf_path, counter):
+        self.counter = counter
+        self.uc = Uc(UC_ARCH_ARM, UC_MODE_THUMB | UC_MODE_MCLASS)
+        self.uc.ctl_set_cpu_model(UC_CPU_ARM_CORTEX_M3)
+        for base, size in (FLASH, RAM, PERIPH, PERIPH_BITBAND, PPB, STOP):
+            self.uc.mem_map(base, size)
+
+        self.symbols = {}
+        with open(elf_path, 'rb') as f:
+            elf = ELFFile(f)
+            for segment in elf.iter_segments():
+                if segment['p_type'] == 'PT_LOAD' and segment['p_filesz'] > 0:
+                    # initialized data are written to their RAM address too, so no startup code has to run
+                    self.uc.mem_write(segment['p_paddr'], segment.data())
+                    if segment['p_vaddr'] != segment['p_paddr']:
+                        self.uc.mem_write(segment['p_vaddr'], segment.data())
+            for symbol in elf.get_section_by_name('.symtab').iter_symbols():
+                if symbol['st_info']['type'] == 'STT_FUNC':
+                    self.symbols[symbol.name] = symbol['st_value'] | 1
+
+        self.uc.hook_add(UC_HOOK_CODE, counter.on_code)
+        self.uc.hook_add(UC_HOOK_MEM_READ, counter.on_mem)
+        self.uc.hook_add(UC_HOOK_MEM_WRITE, self.on_write)
+        self.uc.hook_add(UC_HOOK_MEM_UNMAPPED, self.on_unmapped)
+
+    def on_write(self, uc, access, addr, size, value, _):
+        if in_region(addr, PERIPH) or in_region(addr, PERIPH_BITBAND):
+            self.counter.periph_accesses += 1
+
+    @staticmethod
+    def on_unmapped(uc, access, addr, size, value, _):
+        pc = uc.reg_read(UC_ARM_REG_PC)
+        sys.exit('access to unmapped address 0x%08x at 0x%08x' % (addr, pc))
+
+    def write32(self, addr, value):
+        self.uc.mem_write(addr, value.to_bytes(4, 'little'))
+
+    def call(self, name, *args):
+        """Calls the function, returns (instructions, cycles) of the call."""
+        if name not in self.symbols:
+            sys.exit('%s not found in the image' % name)
+        for reg, value in zip((UC_ARM_REG_R0, UC_ARM_REG_R1, UC_ARM_REG_R2, UC_ARM_REG_R3), args):
+            self.uc.reg_write(reg, value)
+        self.uc.reg_write(UC_ARM_REG_SP, RAM_TOP)
+        self.uc.reg_write(UC_ARM_REG_LR, STOP[0] | 1)
+
+        self.counter.reset()
+        try:
+            self.uc.emu_start(self.symbols[name], STOP[0], count=MAX_INSTRUCTIONS)
+        except UcError as e:
+            sys.exit('%s failed at 0x%08x: %s' % (name, self.uc.reg_read(UC_ARM_REG_PC), e))
+        if self.uc.reg_read(UC_ARM_REG_PC) != STOP[0]:
+            sys.exit('%s didn\'t return in %d instructions' % (name, MAX_INSTRUCTIONS))
+        self.counter.finish()
+        return self.counter.instructions, self.counter.cycles
+
+
+class Results:
+    def __init__(self, mhz):
+        self.mhz = mhz
+        self.rows = []
+
+    def add(self, function, case, calls):
+        """calls - list of (instructions, cycles) of the calls"""
+        instructions = sum(c[0] for c in calls) / len(calls)
+        cycles = sum(c[1] for c in calls) / len(calls)
+        self.rows.append({
+            'function': function,
+            'case': case,
+            'calls': len(calls),
+            'instructions': '%.1f' % instructions,
+            'max_instructions': max(c[0] for c in calls),
+            'cycles': '%.1f' % cycles,
+            'max_cycles': max(c[1] for c in calls),
+            'us': '%.3f' % (cycles / self.mhz),
+        })
+
+
+def run_benchmarks(target, results):
+    # check_reference.py lists the cases and numbers of calls too
+    calls = [target.call('isa_bench_decode', f) for f in range(FRAMES_NO)]
+    results.add('bm_create_pkt', 'corpus', calls)
+
+    for case_no, case in enumerate(PARSE_CASES):
+        results.add('data_req_parser_check', case, [target.call('isa_bench_parse', case_no)])
+
+    results.add('sys_tick_handler', 'tick', [target.call('sys_tick_handler') for _ in range(10)])
+
+    # reading of one frame: the DMM is ready, then one timer interrupt per bit
+    target.call('isa_bench_ir_start')
+    results.add('exti4_isr', 'dmm_ready', [target.call('exti4_isr')])
+    bits = []
+    for _ in range(IR_BITS_NO):
+        target.write32(TIM2_SR, TIM_SR_CC2IF)
+        bits.append(target.call('tim2_isr'))
+    results.add('tim2_isr', 'bit', bits)
+
+
+def compare(rows, baseline_path, threshold):
+    with open(baseline_path, newline='') as f:
+        baseline = {(r['function'], r['case']): r for r in csv.DictReader(f)}
+    failed = False
+    for row in rows:
+        key = (row['function'], row['case'])
+        if key not in baseline:
+            continue
+        cycles = float(baseline[key]['cycles'])
+        print('%s,%s: %.1f -> %s cycles (%+.1f%%)' % (key[0], key[1], cycles, row['cycles'],
+                                                     (float(row['cycles']) - cycles) * 100 / cycles), file=sys.stderr)
+        instructions = float(baseline[key]['instructions'])
+        change = (float(row['instructions']) - instructions) * 100 / instructions
+        if change > threshold:
+            print('%s,%s: %+.1f%% instructions' % (key[0], key[1], change), file=sys.stderr)
+            failed = True
+    return not failed
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf')
+    parser.add_argument('--mhz', type=float, default=48, help='core clock for us, default 48')
+    parser.add_argument('--wait-states', type=int, default=1, help='flash wait states, default 1')
+    parser.add_argument('--refill', type=int, default=REFILL, help='pipeline refill cycles, default %d' % REFILL)
+    parser.add_argument('--csv', help='write results to the file too')
+    parser.add_argument('--baseline', help='CSV written by --csv to compare instructions with')
+    parser.add_argument('--threshold', type=float, default=5, help='allowed growth in percents, default 5')
+    args = parser.parse_args()
+
+    target = Target(args.elf, Counter(args.wait_states, args.refill))
+    results = Results(args.mhz)
+    run_benchmarks(target, results)
+
+    fields = ['function', 'case', 'calls', 'instructions', 'max_instructions', 'cycles', 'max_cycles', 'us']
+    writer = csv.DictWriter(sys.stdout, fieldnames=fields, lineterminator='\n')
+    writer.writeheader()
+    writer.writerows(results.rows)
+    if args.csv:
+        with open(args.csv, 'w', newline='') as f:
+            writer = csv.DictWriter(f, fieldnames=fields, lineterminator='\n')
+            writer.writeheader()
+            writer.writerows(results.rows)
+
+    if args.baseline and not compare(results.rows, args.baseline, args.threshold):
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+"""
+Cortex-M3 instruction timings shared by isa_bench.py and wcet.py (ARM DDI 0337, Cortex-M3 TRM, instruction timing).
+
+Costs are of the instruction itself without a change of the program flow: the pipeline refill (REFILL) and flash wait
+states are added by the callers, which know whether the flow changed and where the code and data are.
+"""
+
+## Pipeline refill after a change of the program flow (1-3 cycles in the TRM)
+REFILL = 2
+## Exception entry and return without flash wait states, the tail-chaining isn't counted on
+EXCEPTION_ENTRY = 12
+EXCEPTION_RETURN = 12
+
+LONG_MUL = ('umull', 'smull', 'umlal', 'smlal')
+DIVISIONS = ('udiv', 'sdiv')
+MULTI_REG = ('ldm', 'stm', 'push', 'pop')
+TABLE_BRANCHES = ('tbb', 'tbh')
+LOADS = ('ldm', 'pop', 'ldrd', 'ldr') + TABLE_BRANCHES
+
+
+def base_mnemonic(mnemonic):
+    """Strips width, condition and addressing mode suffixes which don't change timing, e.g. ldmia.w -> ldm."""
+    mnemonic = mnemonic.split('.')[0]
+    for base in ('mul', 'mla', 'mls') + LONG_MUL + DIVISIONS + MULTI_REG + ('ldrd', 'strd', 'ldr', 'str'):
+        if mnemonic.startswith(base):
+            return base
+    return mnemonic
+
+
+def instruction_cycles(mnemonic, op_str):
+    """
+    Cycles of the instruction:
+      - data processing and MUL 1, MLA/MLS 2, long multiplications 4, divisions 12 (upper bound)
+      - single loads and stores 2, LDRD/STRD 3, LDM/STM/PUSH/POP 1 + number of registers
+      - TBB/TBH 2, the load of the table entry
+    """
+    mnemonic = base_mnemonic(mnemonic)
+    if mnemonic in ('mla', 'mls'):
+        return 2
+    if mnemonic in LONG_MUL:
+        return 4
+    if mnemonic in DIVISIONS:
+        return 12
+    if mnemonic in MULTI_REG:
+        reg_list = op_str[op_str.find('{') + 1:op_str.rfind('}')]
+        return 1 + len(reg_list.split(','))
+    if mnemonic in ('ldrd', 'strd'):
+        return 3
+    if mnemonic in ('ldr', 'str') or mnemonic in TABLE_BRANCHES:
+        return 2
+    return 1
+
+
+def is_load(mnemonic):
+    return base_mnemonic(mnemonic) in LOADS
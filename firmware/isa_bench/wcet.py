@@ -0,0 +1,448 @@
+#!/usr/bin/env python3
+"""
+Estimates the worst-case execution time of interrupt handlers from the disassembly of the Cortex-M3 image and checks
+it against their budgets (wcet.cfg).
+
+Each function is split into basic blocks, loops are collapsed into single nodes executed as many times as their
+bound allows and the longest path through the resulting graph is taken. Called functions are analysed the same way
+and added to the call site. Instruction cycles are of m3_timing.py, pessimistic where the static analysis can't tell:
+  - each taken branch, call and return adds the pipeline refill and flash wait states when the code it continues with
+    is in flash (always for returns and indirect calls, their targets aren't known)
+  - each load adds flash wait states, as if the data were in flash
+  - exception entry and return are added to the handler
+The configuration tells what the disassembly doesn't:
+  [budgets_us]      handler = budget in us, the handlers to check
+  [loop_bounds]     function = the maximal number of iterations of any loop of the function
+  [indirect_calls]  function = functions its calls through pointers may reach, those not in the image are skipped
+Calls through a register loaded from a literal (long_call, see ramfunc.h) and linker veneers between flash and RAM
+are resolved to their targets. Jump tables of switch statements (TBB/TBH) are followed to all their entries: the table
+follows the instruction and its length is the bound of the index checked just before (CMP index, #N; BHI default),
+like gcc emits it. A loop without a bound, an unresolved indirect call, a jump table without the bounds check and
+recursion fail the analysis.
+
+With --simulate the image must be the isa_bench build (see makefile): the handlers are run in the emulator by
+isa_bench.py and the measured cycles, which must not exceed the static estimate, are reported next to it. Both use
+the timings of m3_timing.py, so the cross-check verifies the paths and loop bounds of the analysis, not the timings.
+With --disassembly the objdump output is read from the file (wcet_test.py analyses a fixture so), the ELF is needed
+for --simulate only.
+
+Usage: wcet.py [--config wcet.cfg] [--mhz 48] [--wait-states N] [--objdump arm-none-eabi-objdump] [--simulate]
+               [--disassembly FILE] [ELF]
+Output: CSV lines handler,wcet_cycles,entry_exit_cycles,wcet_us,budget_us,load_pct[,simulated_cycles]
+Exits with 1 when a handler exceeds its budget, the analysis fails or the simulation exceeds the estimate.
+"""
+import argparse
+import configparser
+import os
+import re
+import subprocess
+import sys
+
+from m3_timing import REFILL, EXCEPTION_ENTRY, EXCEPTION_RETURN, instruction_cycles, is_load
+
+CONDS = ('eq', 'ne', 'cs', 'hs', 'cc', 'lo', 'mi', 'pl', 'vs', 'vc', 'hi', 'ls', 'ge', 'lt', 'gt', 'le', 'al')
+# data directives of the disassembly and their sizes
+DATA = {'.word': 4, '.short': 2, '.byte': 1}
+FLASH = (0x08000000, 0x100000)
+EXIT = 'exit'
+
+FUNC_LINE = re.compile(r'^([0-9a-f]+) <([^>]+)>:$')
+TARGET = re.compile(r'\b([0-9a-f]+) <')
+VENEER = re.compile(r'^__(.+)_veneer$')
+CMP_IMM = re.compile(r'^(\w+),\s*#(0x[0-9a-f]+|\d+)$')
+NOT_WRITING = ('str', 'cmp', 'cmn', 'tst', 'teq', 'push')
+
+
+class AnalysisError(Exception):
+    pass
+
+
+class Insn:
+    def __init__(self, addr, size, mnemonic, op_str):
+        self.addr = addr
+        self.size = size
+        self.mnemonic = mnemonic
+        self.op_str = op_str
+        # address of the literal a PC relative load reads
+        self.literal = None
+        # filled by classify(): normal, call, icall, jump, ijump, ret, table
+        self.kind = 'normal'
+        self.cond = False
+        self.target = None
+        # targets of the jump table, None if they aren't known
+        self.targets = None
+
+
+def flash_wait_states(mhz):
+    """Wait states of STM32F1 flash at the core clock"""
+    return 0 if mhz <= 24 else (1 if mhz <= 48 else 2)
+
+
+def parse_objdump(text):
+    """Returns {function name: [Insn]} and {address: byte} of data (literals, jump tables) of the objdump -d output"""
+    functions, data = {}, {}
+    insns = None
+    for line in text.splitlines():
+        match = FUNC_LINE.match(line)
+        if match:
+            insns = functions.setdefault(match.group(2), [])
+            continue
+        parts = line.split('\t')
+        if insns is None or len(parts) < 3 or not parts[0].strip().endswith(':'):
+            continue
+        addr = int(parts[0].strip()[:-1], 16)
+        mnemonic = parts[2].strip()
+        operands = re.split(r'[@;]', '\t'.join(parts[3:]), maxsplit=1) if len(parts) > 3 else ['']
+        if mnemonic in DATA:
+            value = int(operands[0].strip(), 16)
+            for n in range(DATA[mnemonic]):
+                data[addr + n] = (value >> (8 * n)) & 0xff
+            continue
+        insn = Insn(addr, len(parts[1].replace(' ', '')) // 2, mnemonic, operands[0].strip())
+        if mnemonic.startswith('ldr') and '[pc' in insn.op_str and len(operands) > 1:
+            literal = TARGET.search(operands[1])
+            insn.literal = int(literal.group(1), 16) if literal else None
+        insns.append(insn)
+    return functions, data
+
+
+def read_data(data, addr, size):
+    """Little endian value of size bytes at addr, None if they aren't data of the disassembly"""
+    if any(addr + n not in data for n in range(size)):
+        return None
+    return sum(data[addr + n] << (8 * n) for n in range(size))
+
+
+def loaded_literal(insns, i, reg, data):
+    """Value of the literal last loaded into the register before insns[i], None if it isn't a literal"""
+    for insn in reversed(insns[:i]):
+        if insn.op_str.startswith(reg + ',') and not insn.mnemonic.startswith(NOT_WRITING):
+            return read_data(data, insn.literal, 4) if insn.literal is not None else None
+    return None
+
+
+def table_targets(insns, i, data):
+    """
+    Targets of TBB/TBH insns[i], None if the table isn't of the form gcc emits: the index is checked by CMP index, #N
+    and BHI to the default case just before, N + 1 entries (bytes or halfwords of half the offset) follow at PC.
+    """
+    insn = insns[i]
+    operands = [o.strip() for o in insn.op_str.strip('[]').split(',')]
+    if len(operands) < 2 or operands[0] != 'pc' or i < 2:
+        return None
+    compare, check = insns[i - 2], insns[i - 1]
+    bound = CMP_IMM.match(compare.op_str)
+    if compare.mnemonic.split('.')[0] != 'cmp' or check.mnemonic.split('.')[0] != 'bhi' or not bound or \
+            bound.group(1) != operands[1]:
+        return None
+    base = insn.addr + 4
+    size = 1 if insn.mnemonic.startswith('tbb') else 2
+    offsets = [read_data(data, base + n * size, size) for n in range(int(bound.group(2), 0) + 1)]
+    return None if None in offsets else [base + 2 * offset for offset in offsets]
+
+
+def classify(insns, data):
+    it_remaining = 0
+    for i, insn in enumerate(insns):
+        m = insn.mnemonic.split('.')[0]
+        in_it = it_remaining > 0
+        it_remaining = max(0, it_remaining - 1)
+        if m.startswith('it') and len(m) <= 5 and all(c in 'te' for c in m[1:]):
+            it_remaining = len(m) - 1
+            continue
+        if in_it and len(m) > 2 and m[-2:] in CONDS:
+            m = m[:-2]
+            insn.cond = True
+
+        reg_list = insn.op_str[insn.op_str.find('{') + 1:insn.op_str.rfind('}')] if '{' in insn.op_str else ''
+        target = TARGET.search(insn.op_str)
+        if m in ('bl', 'blx') and target:
+            insn.kind, insn.target = 'call', int(target.group(1), 16)
+        elif m == 'blx':
+            literal = loaded_literal(insns, i, insn.op_str, data)
+            insn.kind, insn.target = ('call', literal & ~1) if literal is not None else ('icall', None)
+        elif (m == 'b' or (m[0] == 'b' and m[1:] in CONDS) or m in ('cbz', 'cbnz')) and target:
+            insn.kind, insn.target = 'jump', int(target.group(1), 16)
+            insn.cond = insn.cond or m != 'b'
+        elif m == 'bx':
+            insn.kind = 'ret' if insn.op_str == 'lr' else 'ijump'
+        elif m in ('tbb', 'tbh'):
+            insn.kind, insn.targets = 'table', table_targets(insns, i, data)
+        elif m in ('pop', 'ldm', 'ldmia', 'ldmfd') and 'pc' in reg_list.replace(' ', '').split(','):
+            insn.kind = 'ret'
+        elif m in ('ldr', 'mov') and insn.op_str.startswith('pc,'):
+            insn.kind = 'ret' if m == 'ldr' or insn.op_str.replace(' ', '') == 'pc,lr' else 'ijump'
+
+
+class Analysis:
+    def __init__(self, functions, data, config, wait_states, refill):
+        self.functions = functions
+        self.config = config
+        self.ws = wait_states
+        self.refill = refill
+        self.addresses = {insns[0].addr: name for name, insns in functions.items() if insns}
+        self.wcets = {}
+        self.in_progress = set()
+        for insns in functions.values():
+            classify(insns, data)
+
+    def wcet(self, name):
+        """WCET of the function in cycles, including its return"""
+        if name in self.wcets:
+            return self.wcets[name]
+        if name in self.in_progress:
+            raise AnalysisError('recursion through %s' % name)
+        if name not in self.functions:
+            raise AnalysisError('%s not found in the image' % name)
+        self.in_progress.add(name)
+        veneer = VENEER.match(name)
+        if veneer:
+            # LDR PC of the veneer jumps to the function, which returns to the caller
+            target = veneer.group(1)
+            self.wcets[name] = sum(instruction_cycles(i.mnemonic, i.op_str) + self.ws for i in self.functions[name]) + \
+                self.refill + self.fetch_ws(self.functions[target][0].addr) + self.wcet(target)
+        else:
+            self.wcets[name] = self.function_wcet(name, self.functions[name])
+        self.in_progress.discard(name)
+        return self.wcets[name]
+
+    def fetch_ws(self, addr):
+        """Wait states of the refill from addr"""
+        return self.ws if FLASH[0] <= addr < FLASH[0] + FLASH[1] else 0
+
+    def callee(self, name, addr):
+        if addr not in self.addresses:
+            raise AnalysisError('call to 0x%x from %s is not a function start' % (addr, name))
+        return self.wcet(self.addresses[addr])
+
+    def indirect_targets(self, name, insn):
+        if not self.config.has_option('indirect_calls', name):
+            raise AnalysisError('indirect call at 0x%x in %s, list its targets in [indirect_calls]' % (insn.addr, name))
+        targets = self.config.get('indirect_calls', name).replace(',', ' ').split()
+        return [t for t in targets if t in self.functions]
+
+    def insn_cycles(self, name, insn):
+        cycles = instruction_cycles(insn.mnemonic, insn.op_str) + (self.ws if is_load(insn.mnemonic) else 0)
+        if insn.kind == 'call':
+            cycles += self.refill + self.fetch_ws(insn.target) + self.callee(name, insn.target)
+        elif insn.kind == 'icall':
+            cycles += self.refill + self.ws + max([self.wcet(t) for t in self.indirect_targets(name, insn)] or [0])
+        elif insn.kind == 'table' and insn.targets is None:
+            raise AnalysisError('jump table at 0x%x in %s without bounds check (CMP, BHI)' % (insn.addr, name))
+        elif insn.kind == 'ijump':
+            raise AnalysisError('computed jump at 0x%x in %s' % (insn.addr, name))
+        return cycles
+
+    def function_wcet(self, name, insns):
+        if not insns:
+            raise AnalysisError('%s has no instructions' % name)
+        start, end = insns[0].addr, insns[-1].addr + insns[-1].size
+        taken = self.refill + self.fetch_ws(start)
+        ret = self.refill + self.ws
+
+        # basic blocks start at the entry, at jump targets and after jumps, jump tables and returns
+        leaders = {start}
+        addresses = {insn.addr for insn in insns}
+        for i, insn in enumerate(insns):
+            if insn.kind in ('jump', 'table', 'ret') and i + 1 < len(insns):
+                leaders.add(insns[i + 1].addr)
+            if insn.kind == 'jump' and start <= insn.target < end:
+                leaders.add(insn.target)
+            elif insn.kind == 'table' and insn.targets is not None:
+                if any(t not in addresses for t in insn.targets):
+                    raise AnalysisError('jump table at 0x%x in %s leads out of its instructions' % (insn.addr, name))
+                leaders.update(insn.targets)
+        weights, succs = {}, {}
+        block = None
+        for i, insn in enumerate(insns):
+            if insn.addr in leaders:
+                block = insn.addr
+                weights[block] = 0
+            weights[block] += self.insn_cycles(name, insn)
+            last = (i + 1 == len(insns)) or (insns[i + 1].addr in leaders)
+            if not last:
+                continue
+            edges = []
+            if insn.kind == 'jump':
+                if start <= insn.target < end:
+                    edges.append((insn.target, taken))
+                else:
+                    # tail call
+                    edges.append((EXIT, self.refill + self.fetch_ws(insn.target) + self.callee(name, insn.target)))
+            elif insn.kind == 'table':
+                edges += [(target, taken) for target in sorted(set(insn.targets))]
+            elif insn.kind == 'ret':
+                edges.append((EXIT, ret))
+            if insn.kind not in ('jump', 'table', 'ret') or insn.cond:
+                edges.append((insns[i + 1].addr, 0) if i + 1 < len(insns) else (EXIT, 0))
+            succs[block] = edges
+
+        self.collapse_loops(name, start, weights, succs)
+        return longest_path(name, start, None, weights, succs)
+
+    def collapse_loops(self, name, entry, weights, succs):
+        """Replaces each loop by its header node which weights bound times the longest iteration"""
+        loops = {}
+        state = {}
+        stack = [(entry, iter(succs[entry]))]
+        state[entry] = 'open'
+        while stack:
+            node, edges = stack[-1]
+            for succ, _ in edges:
+                if succ == EXIT:
+                    continue
+                if state.get(succ) == 'open':
+                    loops.setdefault(succ, set()).add(node)
+                elif succ not in state:
+                    state[succ] = 'open'
+                    stack.append((succ, iter(succs[succ])))
+                    break
+            else:
+                state[node] = 'closed'
+                stack.pop()
+        if not loops:
+            return
+
+        preds = {}
+        for node, edges in succs.items():
+            for succ, _ in edges:
+                preds.setdefault(succ, set()).add(node)
+        bodies = []
+        for header, latches in loops.items():
+            body, work = {header}, list(latches)
+            while work:
+                node = work.pop()
+                if node not in body:
+                    body.add(node)
+                    work.extend(preds.get(node, ()))
+            bodies.append((header, body))
+
+        if not self.config.has_option('loop_bounds', name):
+            raise AnalysisError('loop at 0x%x in %s, set its bound in [loop_bounds]' % (bodies[0][0], name))
+        bound = self.config.getint('loop_bounds', name)
+
+        rep = {}
+        for header, body in sorted(bodies, key=lambda b: len(b[1])):
+            body = {rep.get(n, n) for n in body}
+            iteration = longest_path(name, header, body, weights, succs)
+            exits = {}
+            for node in body:
+                for succ, w in succs[node]:
+                    if succ not in body:
+                        exits[succ] = max(exits.get(succ, 0), w)
+            for node, edges in succs.items():
+                if node not in body and any(s in body and s != header for s, _ in edges):
+                    raise AnalysisError('loop at 0x%x in %s has several entries' % (header, name))
+            for node in body - {header}:
+                del weights[node]
+                del succs[node]
+                rep[node] = header
+            for node, target in list(rep.items()):
+                if target in body:
+                    rep[node] = header
+            weights[header] = bound * iteration
+            succs[header] = list(exits.items())
+
+
+def longest_path(name, start, body, weights, succs):
+    """
+    Longest path from start to the exit of the function, or when body is given, the longest path from start through
+    the body back to start (one iteration of the loop of the header start)
+    """
+    order, state, stack = [], {start: 'open'}, [(start, iter(succs[start]))]
+    while stack:
+        node, edges = stack[-1]
+        for succ, _ in edges:
+            if succ == EXIT or succ == start or (body is not None and succ not in body):
+                continue
+            if state.get(succ) == 'open':
+                raise AnalysisError('irreducible loop at 0x%x in %s' % (succ, name))
+            if succ not in state:
+                state[succ] = 'open'
+                stack.append((succ, iter(succs[succ])))
+                break
+        else:
+            state[node] = 'closed'
+            order.append(node)
+            stack.pop()
+
+    dist = {start: weights[start]}
+    result = 0
+    for node in reversed(order):
+        if node not in dist:
+            continue
+        for succ, w in succs[node]:
+            if (body is None and succ == EXIT) or (body is not None and succ == start):
+                result = max(result, dist[node] + w)
+            elif succ != EXIT and succ != start and (body is None or succ in body):
+                dist[succ] = max(dist.get(succ, 0), dist[node] + w + weights[succ])
+    return result
+
+
+def simulate(elf, wait_states, refill, mhz):
+    """Returns {handler: max cycles} measured by isa_bench.py"""
+    import isa_bench
+    target = isa_bench.Target(elf, isa_bench.Counter(wait_states, refill))
+    results = isa_bench.Results(mhz)
+    isa_bench.run_benchmarks(target, results)
+    return {row['function']: row['max_cycles'] for row in results.rows}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('elf', nargs='?')
+    parser.add_argument('--config', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), 'wcet.cfg'))
+    parser.add_argument('--mhz', type=float, default=48, help='core clock, default 48')
+    parser.add_argument('--wait-states', type=int, help='flash wait states, default of the STM32F1 at --mhz')
+    parser.add_argument('--refill', type=int, default=REFILL, help='pipeline refill cycles, default %d' % REFILL)
+    parser.add_argument('--objdump', default='arm-none-eabi-objdump')
+    parser.add_argument('--simulate', action='store_true', help='cross-check with isa_bench.py')
+    parser.add_argument('--disassembly', help='objdump -d output to analyse instead of the ELF')
+    args = parser.parse_args()
+    if args.elf is None and (args.disassembly is None or args.simulate):
+        parser.error('ELF is required without --disassembly and with --simulate')
+    wait_states = flash_wait_states(args.mhz) if args.wait_states is None else args.wait_states
+
+    config = configparser.ConfigParser()
+    if not config.read(args.config):
+        sys.exit('can\'t read %s' % args.config)
+    if args.disassembly:
+        with open(args.disassembly) as f:
+            text = f.read()
+    else:
+        text = subprocess.run([args.objdump, '-d', args.elf], check=True, stdout=subprocess.PIPE,
+                              universal_newlines=True).stdout
+    functions, data = parse_objdump(text)
+    analysis = Analysis(functions, data, config, wait_states, args.refill)
+    simulated = simulate(args.elf, wait_states, args.refill, args.mhz) if args.simulate else {}
+
+    entry_exit = EXCEPTION_ENTRY + EXCEPTION_RETURN + 2 * wait_states
+    failed = False
+    print('handler,wcet_cycles,entry_exit_cycles,wcet_us,budget_us,load_pct' +
+          (',simulated_cycles' if simulated else ''))
+    for handler, budget in config.items('budgets_us'):
+        try:
+            cycles = analysis.wcet(handler)
+        except AnalysisError as e:
+            print('%s: %s' % (handler, e), file=sys.stderr)
+            failed = True
+            continue
+        us = (cycles + entry_exit) / args.mhz
+        line = '%s,%d,%d,%.2f,%s,%.1f' % (handler, cycles, entry_exit, us, budget, us * 100 / float(budget))
+        if simulated:
+            line += ',%d' % simulated.get(handler, 0)
+        print(line)
+        if us > float(budget):
+            print('%s: %.2f us exceeds the budget of %s us at %g MHz' % (handler, us, budget, args.mhz),
+                  file=sys.stderr)
+            failed = True
+        if simulated.get(handler, 0) > cycles:
+            print('%s: simulation took %d cycles, more than the estimate' % (handler, simulated[handler]),
+                  file=sys.stderr)
+            failed = True
+    if failed:
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
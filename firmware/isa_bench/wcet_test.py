@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+"""
+Test of wcet.py on the disassembly fixture wcet_fixture.dis with wcet_fixture.cfg, needs python3 only.
+
+The expected cycles are counted by hand with 1 flash wait state and the refill of 2 cycles: each load and each
+change of the flow to flash adds a wait state, each change of the flow adds the refill.
+
+Usage: wcet_test.py (or 'make wcet-test')
+"""
+import configparser
+import os
+import subprocess
+import sys
+import unittest
+
+import wcet
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+FIXTURE = os.path.join(HERE, 'wcet_fixture.dis')
+CONFIG = os.path.join(HERE, 'wcet_fixture.cfg')
+WAIT_STATES = 1
+REFILL = 2
+
+
+def analyse(text):
+    config = configparser.ConfigParser()
+    config.read(CONFIG)
+    functions, data = wcet.parse_objdump(text)
+    return functions, wcet.Analysis(functions, data, config, WAIT_STATES, REFILL)
+
+
+class WcetTest(unittest.TestCase):
+    def setUp(self):
+        with open(FIXTURE) as f:
+            self.text = f.read()
+        self.functions, self.analysis = analyse(self.text)
+
+    def test_tbb_targets_are_read_from_the_table(self):
+        tbb = self.functions['timer_set_oc_mode'][2]
+        self.assertEqual('table', tbb.kind)
+        # 7 entries for cmp r1, #6: OC1, OC2, OC3 and OC4 have cases, the N channels go to the default return
+        self.assertEqual([0x8000110, 0x8000148, 0x800011e, 0x8000148, 0x800012c, 0x8000148, 0x800013a], tbb.targets)
+
+    def test_tbb_switch(self):
+        # cmp 1 + bhi 1, tbb 2 + 1, refill 2 + 1 to a case, ldr 2 + 1 + bic 1 + orr 1 + str 2 + bx 1, return 2 + 1
+        self.assertEqual(2 + 3 + 3 + 8 + 3, self.analysis.wcet('timer_set_oc_mode'))
+
+    def test_tbh_switch(self):
+        # cmp 1 + bhi 1, tbh 2 + 1, refill 2 + 1 to the longest case: ldr 2 + 1 + bx 1, return 2 + 1
+        self.assertEqual(2 + 3 + 3 + 4 + 3, self.analysis.wcet('host_cmd_dispatch'))
+
+    def test_handler_with_loop_and_calls(self):
+        entry = 3 + 1  # push 1 + 2, movs 1
+        loop = 4 * (3 + 3 + 1 + 1 + 3)  # 4 iterations of ldr 2 + 1, ldr 2 + 1, subs 1, bne 1, back 2 + 1
+        call = 1 + 1 + 3 + 1 + 2 + 1 + 19  # movs, movs, ldr 2 + 1, bl 1 + 2 + 1 + timer_set_oc_mode
+        icall = 3 + 3 + 1 + 2 + 1 + 15  # ldr 2 + 1, ldr 2 + 1, blx 1 + 2 + 1 + host_cmd_dispatch
+        exit = 1 + 2 + 1 + 2 + 1  # pop 1 + 2 + 1, return 2 + 1
+        self.assertEqual(entry + loop + call + icall + exit, self.analysis.wcet('tim2_isr'))
+
+    def test_table_without_bounds_check_fails(self):
+        with self.assertRaisesRegex(wcet.AnalysisError, 'jump table at 0x800014a'):
+            self.analysis.wcet('bad_switch')
+
+    def test_table_shorter_than_bound_fails(self):
+        # the last entry is missing
+        _, analysis = analyse(self.text.replace(' 800010e:\t19        \t.byte\t0x19\n', ''))
+        with self.assertRaisesRegex(wcet.AnalysisError, 'jump table at 0x8000104'):
+            analysis.wcet('timer_set_oc_mode')
+
+    def test_command_line(self):
+        result = subprocess.run([sys.executable, os.path.join(HERE, 'wcet.py'), '--config', CONFIG, '--wait-states',
+                                 str(WAIT_STATES), '--disassembly', FIXTURE], stdout=subprocess.PIPE,
+                                stderr=subprocess.PIPE, universal_newlines=True)
+        self.assertEqual(1, result.returncode)
+        self.assertIn('tim2_isr,108,26,2.79,166,1.7', result.stdout.splitlines())
+        self.assertIn('bad_switch: jump table', result.stderr)
+
+
+if __name__ == '__main__':
+    unittest.main()
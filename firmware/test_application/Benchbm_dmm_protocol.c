@@ -0,0 +1,85 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <string.h>
+#include "bm_dmm_protocol.h"
+#include "bm_protocol_defs.h"
+#include "bench.h"
+
+/**
+ * @file Host benchmark of the DMM frame decoder: frames of readings the meter shows usually (several functions and
+ * ranges, autorange, OL) are converted in turn, so branches of the decoder are taken as in real use.
+ */
+
+#define OPS_NO  200000
+
+#define RAW_IR_DIGIT_0 0xbe
+#define RAW_IR_DIGIT_1 0xa0
+#define RAW_IR_DIGIT_2 0xda
+#define RAW_IR_DIGIT_3 0xf8
+#define RAW_IR_DIGIT_4 0xe4
+#define RAW_IR_DIGIT_5 0x7c
+#define RAW_IR_DIGIT_6 0x7e
+#define RAW_IR_DIGIT_7 0xa8
+#define RAW_IR_DIGIT_8 0xfe
+#define RAW_IR_DIGIT_9 0xfc
+#define RAW_IR_DIGIT_L 0x16
+#define RAW_IR_DOT     0x01
+
+// functions exposed by the TEST build
+void bm_calculate_pkt_check_sum(data_resp_pkt* const pRespPack);
+uint8_t convert_digit_segs_to_val(uint8_t segments);
+
+static const uint8_t frames[][16] = {
+    // -0.1234 mV AC
+    {0x07, RAW_IR_DIGIT_0, RAW_IR_DIGIT_1 | RAW_IR_DOT, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3, RAW_IR_DIGIT_4, 0x00, 0xa0},
+    // 12.3458 uV DC
+    {0x09, RAW_IR_DIGIT_1, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3 | RAW_IR_DOT, RAW_IR_DIGIT_4, RAW_IR_DIGIT_5,
+     RAW_IR_DIGIT_8, 0xc0},
+    // 102.37 kOhm
+    {0x01, RAW_IR_DIGIT_1, RAW_IR_DIGIT_0, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3 | RAW_IR_DOT, RAW_IR_DIGIT_7, 0x00, 0x00,
+     0x06},
+    // 91.3790 nA, autorange
+    {0x8d, RAW_IR_DIGIT_9, RAW_IR_DIGIT_1, RAW_IR_DIGIT_3 | RAW_IR_DOT, RAW_IR_DIGIT_7, RAW_IR_DIGIT_9,
+     RAW_IR_DIGIT_0, 0x0c},
+    // OL
+    {0x0d, 0x00, 0x00, RAW_IR_DIGIT_0 | RAW_IR_DOT, RAW_IR_DIGIT_L, 0x00, 0x00, 0x0c},
+    // 5.6789 V DC, autorange
+    {0x89, RAW_IR_DIGIT_5 | RAW_IR_DOT, RAW_IR_DIGIT_6, RAW_IR_DIGIT_7, RAW_IR_DIGIT_8, RAW_IR_DIGIT_9, 0x00, 0x00},
+    // 230.41 V AC
+    {0x05, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3, RAW_IR_DIGIT_0 | RAW_IR_DOT, RAW_IR_DIGIT_4, RAW_IR_DIGIT_1, 0x00, 0x00},
+    // -0.0003 V DC
+    {0x0b, RAW_IR_DIGIT_0 | RAW_IR_DOT, RAW_IR_DIGIT_0, RAW_IR_DIGIT_0, RAW_IR_DIGIT_0, RAW_IR_DIGIT_3, 0x00, 0x00},
+};
+#define FRAMES_NO   (sizeof(frames) / sizeof(frames[0]))
+
+static const uint8_t digitSegs[] = {
+    RAW_IR_DIGIT_0, RAW_IR_DIGIT_1, RAW_IR_DIGIT_2, RAW_IR_DIGIT_3, RAW_IR_DIGIT_4, RAW_IR_DIGIT_5, RAW_IR_DIGIT_6,
+    RAW_IR_DIGIT_7, RAW_IR_DIGIT_8, RAW_IR_DIGIT_9 | RAW_IR_DOT, 0x00, RAW_IR_DIGIT_L, RAW_IR_DIGIT_1 | RAW_IR_DOT,
+    0x00, RAW_IR_DIGIT_7, RAW_IR_DIGIT_0,
+};
+#define DIGIT_SEGS_NO   (sizeof(digitSegs) / sizeof(digitSegs[0]))
+
+static data_resp_pkt packets[FRAMES_NO];
+
+int main(void) {
+    BENCH_CASE("bm_dmm_protocol", "bm_create_pkt", OPS_NO,
+        for (uint32_t i = 0; i < OPS_NO; ++i) {
+            bm_create_pkt(frames[i % FRAMES_NO], sizeof(frames[0]), &packets[i % FRAMES_NO]);
+            bench_sink = packets[i % FRAMES_NO].asciiAndTailLong.pktTail.chkSum;
+        });
+
+    BENCH_CASE("bm_dmm_protocol", "convert_digit_segs_to_val", OPS_NO,
+        for (uint32_t i = 0; i < OPS_NO; ++i) {
+            bench_sink = convert_digit_segs_to_val(digitSegs[i % DIGIT_SEGS_NO]);
+        });
+
+    // packets of the corpus, normal and OL ones
+    BENCH_CASE("bm_dmm_protocol", "bm_calculate_pkt_check_sum", OPS_NO,
+        for (uint32_t i = 0; i < OPS_NO; ++i) {
+            bm_calculate_pkt_check_sum(&packets[i % FRAMES_NO]);
+            bench_sink = packets[i % FRAMES_NO].asciiAndTailLong.pktTail.chkSum;
+        });
+
+    bm_take_invalid_digits_no();
+    return 0;
+}
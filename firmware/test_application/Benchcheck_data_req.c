@@ -0,0 +1,61 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <string.h>
+#include "check_data_req.h"
+#include "bm_protocol_defs.h"
+#include "bench.h"
+
+/**
+ * @file Host benchmark of the data request parser on USB packets the host sends: a single request per packet (polling
+ * host), packets full of requests (host queuing requests) and requests mixed with adapter commands and split between
+ * packets.
+ */
+
+#define OPS_NO      200000
+#define PACKET_LEN  64
+
+static const uint8_t request[8] = {BM_DLE_CONST, BM_STX_CONST, BM_DATA_REQ_COMMAND, 0, 0, 0, BM_DLE_CONST,
+                                   BM_ETX_CONST};
+static const uint8_t streamStart[8] = {BM_DLE_CONST, BM_STX_CONST, BM_ADAPTER_CMD_STREAM_START, 100, 0, 100,
+                                       BM_DLE_CONST, BM_ETX_CONST};
+
+static uint8_t fullPacket[PACKET_LEN];
+/// Two packets, the request at the end of the first one continues in the second one
+static uint8_t mixedPackets[2][PACKET_LEN];
+
+static void fill_corpus(void) {
+    for (size_t i = 0; i < PACKET_LEN; i += sizeof(request)) {
+        memcpy(&fullPacket[i], request, sizeof(request));
+    }
+
+    uint8_t stream[2 * PACKET_LEN];
+    for (size_t i = 0; i < sizeof(stream); i += sizeof(request)) {
+        memcpy(&stream[i], (0 == (i / sizeof(request)) % 3) ? streamStart : request, sizeof(request));
+    }
+    // shift by 4 bytes, so requests cross packet boundary
+    memcpy(mixedPackets, &stream[4], sizeof(stream) - 4);
+    memcpy(&mixedPackets[1][PACKET_LEN - 4], stream, 4);
+}
+
+int main(void) {
+    data_req_parser parser;
+    data_req_parser_init(&parser);
+    fill_corpus();
+
+    BENCH_CASE("check_data_req", "single_request", OPS_NO,
+        for (uint32_t i = 0; i < OPS_NO; ++i) {
+            bench_sink = check_buffer_for_data_request(request, sizeof(request));
+        });
+
+    BENCH_CASE("check_data_req", "full_packet", OPS_NO,
+        for (uint32_t i = 0; i < OPS_NO; ++i) {
+            bench_sink = check_buffer_for_data_request(fullPacket, sizeof(fullPacket));
+        });
+
+    BENCH_CASE("check_data_req", "mixed_split", OPS_NO,
+        for (uint32_t i = 0; i < OPS_NO; ++i) {
+            bench_sink = data_req_parser_check(&parser, mixedPackets[i & 1], PACKET_LEN);
+        });
+
+    return 0;
+}
@@ -0,0 +1,47 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdint.h>
+#include <stdlib.h>
+#include "soft_timer.h"
+#include "bench.h"
+
+/**
+ * @file Host benchmark of software timers: many continuous timers of different periods run while the fake tick counter
+ * advances, average costs of starting a timer and of polling (callbacks included) are reported.
+ */
+
+#define TIMERS_NO   1024
+#define TICKS_NO    100000
+
+/// Fake tick counter, replaces the one driven by SysTick
+static systick_t ticks;
+
+systick_t st_get_ticks(void) {
+    return ticks;
+}
+
+static soft_timer_descr timers[TIMERS_NO];
+static uint32_t callsNo;
+
+static void timer_callback(void) {
+    ++callsNo;
+}
+
+int main(void) {
+    srand(1);
+
+    // timers are started again in each run (restart), periods from 10 ms to 10 s, like periodic tasks of several
+    // channels
+    BENCH_CASE("soft_timer", "start", TIMERS_NO,
+        for (int i = 0; i < TIMERS_NO; ++i) {
+            soft_timer_start_continuous(&timers[i], 10 + (rand() % 10000), timer_callback);
+        });
+
+    BENCH_CASE("soft_timer", "poll", TICKS_NO,
+        for (int i = 0; i < TICKS_NO; ++i) {
+            ++ticks;
+            soft_timer_poll();
+        });
+
+    bench_sink = callsNo;
+    return 0;
+}
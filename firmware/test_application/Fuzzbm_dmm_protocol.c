@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bm_dmm_protocol.h"
+#include "bm_protocol_defs.h"
+#include "bm_reference.h"
+
+/**
+ * @file Fuzzer of the DMM frame decoder (libFuzzer entry point).
+ *
+ * Input is split into 16-byte frames, the rest shorter than a frame is decoded too (it must be refused). Each packet
+ * is checked for a valid structure and check sum and, when FUZZ_DIFFERENTIAL is 1, compared with the packet of the
+ * reference model together with the number of invalid digits.
+ */
+
+#ifndef FUZZ_DIFFERENTIAL
+#define FUZZ_DIFFERENTIAL 1
+#endif
+
+#define FRAME_LEN   16
+
+static void fail(const char* const what, const uint8_t* const frame, const size_t frame_len) {
+    fprintf(stderr, "%s, frame:", what);
+    for (size_t i = 0; i < frame_len; ++i) {
+        fprintf(stderr, " %02x", frame[i]);
+    }
+    fprintf(stderr, "\n");
+    abort();
+}
+
+static void check_structure(const uint8_t* const pkt, const uint8_t* const frame) {
+    const uint8_t dataLen = pkt[3];
+    if ((BM_NORMAL_PACKET_DATA_LENGTH != dataLen) && (BM_OL_PACKET_DATA_LENGTH != dataLen)) {
+        fail("invalid data length", frame, FRAME_LEN);
+    }
+    const size_t len = BM_ADAPTER_PKT_LEN(dataLen);
+    const uint8_t cmd = (BM_OL_PACKET_DATA_LENGTH == dataLen) ? BM_DATA_RESP_OV_COMMAND : BM_DATA_RESP_COMMAND;
+    if ((BM_DLE_CONST != pkt[0]) || (BM_STX_CONST != pkt[1]) || (cmd != pkt[2]) ||
+        (BM_DLE_CONST != pkt[len - 2]) || (BM_ETX_CONST != pkt[len - 1])) {
+        fail("invalid header or tail", frame, FRAME_LEN);
+    }
+    uint8_t chk = 0;
+    for (size_t i = sizeof(data_resp_header); i < len - sizeof(data_resp_tail); ++i) {
+        chk ^= pkt[i];
+    }
+    if (chk != pkt[len - 3]) {
+        fail("invalid check sum", frame, FRAME_LEN);
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    bm_take_invalid_digits_no();
+
+    for (size_t offset = 0; offset < size; offset += FRAME_LEN) {
+        const uint8_t* const frame = &data[offset];
+        const size_t frameLen = (size - offset < FRAME_LEN) ? (size - offset) : FRAME_LEN;
+        data_resp_pkt packet;
+
+        const bm_result res = bm_create_pkt(frame, (uint8_t)frameLen, &packet);
+        if (frameLen < FRAME_LEN) {
+            if (BM_RAW_DATA_LEN_TOO_SHORT != res) {
+                fail("short frame accepted", frame, frameLen);
+            }
+            break;
+        }
+        if (BM_PKG_CREATED != res) {
+            fail("frame refused", frame, frameLen);
+        }
+        check_structure((const uint8_t*)&packet, frame);
+
+#if 1 == FUZZ_DIFFERENTIAL
+        uint8_t expected[sizeof(data_resp_pkt)];
+        uint32_t expectedInvalidNo = 0;
+        const size_t len = ref_packet(frame, expected, &expectedInvalidNo);
+        if (0 != memcmp(expected, &packet, len)) {
+            fail("packet differs from the reference", frame, frameLen);
+        }
+        if (bm_take_invalid_digits_no() != expectedInvalidNo) {
+            fail("invalid digits count differs from the reference", frame, frameLen);
+        }
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "check_data_req.h"
+#include "bm_reference.h"
+
+/**
+ * @file Fuzzer of the data request parser (libFuzzer entry point).
+ *
+ * The first two bytes of the input select how the rest is split into USB packets (0-64 bytes each), the rest is the
+ * byte stream from the host. The number of requests found must not depend on the split: the stream is parsed in
+ * the selected packets and byte by byte and, when FUZZ_DIFFERENTIAL is 1, the result is compared with the reference
+ * model too. check_buffer_for_data_request wraps the same parser with shared state, so a parser per run is used
+ * instead.
+ */
+
+#ifndef FUZZ_DIFFERENTIAL
+#define FUZZ_DIFFERENTIAL 1
+#endif
+
+#define MAX_PACKET_LEN  64
+
+static void fail(const char* const what, const uint32_t found, const uint32_t expected) {
+    fprintf(stderr, "%s: %u requests found, %u expected\n", what, (unsigned)found, (unsigned)expected);
+    abort();
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size < 2) {
+        return 0;
+    }
+    uint32_t split = ((uint32_t)data[0] << 8) | data[1];
+    const uint8_t* const stream = &data[2];
+    const size_t len = size - 2;
+
+    data_req_parser parser;
+    data_req_parser_init(&parser);
+    uint32_t inPackets = 0;
+    for (size_t offset = 0; offset < len; ) {
+        split = split * 1103515245u + 12345u;
+        size_t packetLen = (split >> 16) % (MAX_PACKET_LEN + 1);
+        if (packetLen > len - offset) {
+            packetLen = len - offset;
+        }
+        const uint8_t found = data_req_parser_check(&parser, &stream[offset], packetLen);
+        if ((0 == packetLen) && (0 != found)) {
+            fail("empty packet", found, 0);
+        }
+        inPackets += found;
+        offset += packetLen;
+    }
+
+    data_req_parser_init(&parser);
+    uint32_t byBytes = 0;
+    for (size_t i = 0; i < len; ++i) {
+        byBytes += data_req_parser_check(&parser, &stream[i], 1);
+    }
+    if (byBytes != inPackets) {
+        fail("result depends on the split", inPackets, byBytes);
+    }
+
+#if 1 == FUZZ_DIFFERENTIAL
+    const uint32_t expected = ref_data_requests(stream, len);
+    if (expected != inPackets) {
+        fail("result differs from the reference", inPackets, expected);
+    }
+#endif
+    return 0;
+}
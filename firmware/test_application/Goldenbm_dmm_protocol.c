@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "bm_dmm_protocol.h"
+#include "bm_protocol_defs.h"
+#include "bench.h"
+#include "bm_reference.h"
+
+/**
+ * @file Golden regression of the DMM frame decoder.
+ *
+ * A corpus of raw frames is generated, covering what the meter can display: every digit value (0-9, blank, L and an
+ * invalid segment pattern) in every position, in all combinations, and independently every dot position combined
+ * with every combination of unit and prefix bits of bytes 7 and 8. Symbol bits of byte 0, the beep bit and the bar
+ * graph bytes are filled pseudo-randomly. All frames go through bm_create_pkt and each packet is compared with the one
+ * built by the reference model (bm_reference.h).
+ *
+ * The digest (FNV-1a, 64 bits) of all packets is compared with GOLDEN_DIGEST, so the corpus and the model can't change
+ * unnoticed either. When the decoder output changes on purpose, the model and the digest are updated together.
+ *
+ * Decoding rate is measured in the same run (decoder calls only), results are printed as key=value lines.
+ */
+
+/// Digest of packets of the whole corpus
+#define GOLDEN_DIGEST       0x910e0c68a442f43cULL
+
+#define DIGIT_VALUES_NO     13
+#define DIGITS_NO           6
+/// 13^6, every combination of digits
+#define CORPUS_FRAMES_NO    4826809UL
+/// No dot, dot after digit 1-5 combined with all values of bytes 7 and 8
+#define UNIT_COMBINATIONS_NO (6UL * 256 * 256)
+#define BATCH_FRAMES_NO     4096
+#define FRAME_LEN           16
+#define MAX_PKT_LEN         sizeof(data_resp_pkt)
+/// Mismatches printed in detail
+#define REPORTED_MISMATCHES_NO 10
+
+#define FNV64_OFFSET 0xCBF29CE484222325ULL
+#define FNV64_PRIME  0x00000100000001B3ULL
+
+/// Segments of digit values of the corpus: 0-9, blank, L and E segment only (not a digit, sent as blank)
+static const uint8_t digitSegs[DIGIT_VALUES_NO] = {
+    0xbe, 0xa0, 0xda, 0xf8, 0xe4, 0x7c, 0x7e, 0xa8, 0xfe, 0xfc, 0x00, 0x16, 0x02,
+};
+
+static uint8_t frames[BATCH_FRAMES_NO][FRAME_LEN];
+static data_resp_pkt packets[BATCH_FRAMES_NO];
+
+static struct {
+    uint64_t frames;
+    uint64_t olFrames;
+    uint64_t invalidDigits;
+    uint64_t mismatches;
+    uint64_t digest;
+    double   decodeNs;
+} result = {
+    .digest = FNV64_OFFSET,
+};
+
+
+static uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/// Builds frame of given number of the corpus
+static void make_frame(const uint32_t n, uint8_t* const frame) {
+    const uint64_t rnd = splitmix64(n);
+
+    uint32_t digits = n;
+    for (int d = 0; d < DIGITS_NO; ++d) {
+        frame[1 + d] = digitSegs[digits % DIGIT_VALUES_NO];
+        digits /= DIGIT_VALUES_NO;
+    }
+
+    const uint32_t units = n % UNIT_COMBINATIONS_NO;
+    const uint32_t dot = units / (256 * 256);
+    if (0 != dot) {
+        frame[1 + dot] |= 0x01;
+    }
+    frame[7] = (uint8_t)(units >> 8);
+    frame[8] = (uint8_t)units;
+
+    // start bit and symbols
+    frame[0] = (uint8_t)(0x01 | (rnd & 0xFE));
+    // beep
+    frame[1] |= (uint8_t)((rnd >> 8) & 0x01);
+    // bar graph, ignored by the decoder
+    for (int b = 9; b < FRAME_LEN; ++b) {
+        frame[b] = (uint8_t)(rnd >> (8 * (b - 7)));
+    }
+}
+
+static uint64_t fnv1a(uint64_t hash, const uint8_t* const data, const size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= data[i];
+        hash *= FNV64_PRIME;
+    }
+    return hash;
+}
+
+static void print_hex(const char* const name, const uint8_t* const data, const size_t len) {
+    printf("  %s:", name);
+    for (size_t i = 0; i < len; ++i) {
+        printf(" %02x", data[i]);
+    }
+    printf("\n");
+}
+
+static void check_batch(const uint32_t first, const uint32_t count, const uint32_t decoder_invalid_no) {
+    uint32_t refInvalidNo = 0;
+
+    for (uint32_t i = 0; i < count; ++i) {
+        uint8_t expected[MAX_PKT_LEN];
+        const size_t len = ref_packet(frames[i], expected, &refInvalidNo);
+        const uint8_t* const actual = (const uint8_t*)&packets[i];
+
+        result.digest = fnv1a(result.digest, actual, BM_ADAPTER_PKT_LEN(packets[i].header.dataLen));
+        if (BM_OL_PACKET_DATA_LENGTH == expected[3]) {
+            ++result.olFrames;
+        }
+        if (0 != memcmp(expected, actual, len)) {
+            if (result.mismatches < REPORTED_MISMATCHES_NO) {
+                printf("mismatch at frame %u\n", (unsigned)(first + i));
+                print_hex("frame   ", frames[i], FRAME_LEN);
+                print_hex("expected", expected, len);
+                print_hex("actual  ", actual, len);
+            }
+            ++result.mismatches;
+        }
+    }
+
+    result.invalidDigits += decoder_invalid_no;
+    if (decoder_invalid_no != refInvalidNo) {
+        printf("frames %u-%u: %u invalid digits counted, %u expected\n", (unsigned)first,
+               (unsigned)(first + count - 1), (unsigned)decoder_invalid_no, (unsigned)refInvalidNo);
+        ++result.mismatches;
+    }
+}
+
+int main(void) {
+    bm_take_invalid_digits_no();
+
+    for (uint32_t first = 0; first < CORPUS_FRAMES_NO; first += BATCH_FRAMES_NO) {
+        const uint32_t count = (CORPUS_FRAMES_NO - first < BATCH_FRAMES_NO) ? (uint32_t)(CORPUS_FRAMES_NO - first)
+                                                                            : BATCH_FRAMES_NO;
+        for (uint32_t i = 0; i < count; ++i) {
+            make_frame(first + i, frames[i]);
+        }
+
+        const double start = bench_now_ns();
+        for (uint32_t i = 0; i < count; ++i) {
+            bm_create_pkt(frames[i], FRAME_LEN, &packets[i]);
+        }
+        result.decodeNs += bench_now_ns() - start;
+
+        check_batch(first, count, bm_take_invalid_digits_no());
+        result.frames += count;
+    }
+
+    const bool digestOk = (GOLDEN_DIGEST == result.digest);
+    printf("frames=%llu\n", (unsigned long long)result.frames);
+    printf("ol_frames=%llu\n", (unsigned long long)result.olFrames);
+    printf("invalid_digits=%llu\n", (unsigned long long)result.invalidDigits);
+    printf("mismatches=%llu\n", (unsigned long long)result.mismatches);
+    printf("digest=%016llx%s\n", (unsigned long long)result.digest, digestOk ? "" : " (golden differs)");
+    printf("ns_per_frame=%.2f\n", result.decodeNs / (double)result.frames);
+    printf("frames_per_s=%.0f\n", 1e9 * (double)result.frames / result.decodeNs);
+    return ((0 == result.mismatches) && digestOk) ? 0 : 1;
+}
@@ -242,6 +242,19 @@ void test_convert_digit_segs_to_val(void) {
     TEST_ASSERT_EQUAL_UINT8(0x20, convert_digit_segs_to_val(digit_empty));
 } // test_convert_digit_segs_to_val
 
+void test_bm_take_invalid_digits_no(void) {
+    const uint8_t a = (1 << 3);
+    const uint8_t b = (1 << 7);
+
+    bm_take_invalid_digits_no();
+    TEST_ASSERT_EQUAL_UINT8(0xFF, convert_digit_segs_to_val(a+b));
+    TEST_ASSERT_EQUAL_UINT8(0xFF, convert_digit_segs_to_val(a));
+    // known patterns are not counted
+    TEST_ASSERT_EQUAL_UINT8(0x20, convert_digit_segs_to_val(0));
+    TEST_ASSERT_EQUAL_UINT32(2, bm_take_invalid_digits_no());
+    TEST_ASSERT_EQUAL_UINT32(0, bm_take_invalid_digits_no());
+} // test_bm_take_invalid_digits_no
+
 void test_convert_sanwa_ir_data_to_bm_pkt(void) {
     data_resp_pkt packet = {0};
 
@@ -399,15 +412,51 @@ void test_bm_create_pkt_OVER_LIMIT(void) {
 } // test_bm_create_pkt_OVER_LIMIT
 
 
+void test_bm_create_timestamp_pkt(void) {
+    timestamp_resp_pkt packet = {0};
+    const uint8_t expected[sizeof(timestamp_resp_pkt)] = {0x10, 0x02, 0x50, 0x06, 0x34, 0x07, 0x78, 0x56, 0x34, 0x12,
+                                                          0x34 ^ 0x07 ^ 0x78 ^ 0x56 ^ 0x34 ^ 0x12, 0x10, 0x03};
+
+    bm_result result = bm_create_timestamp_pkt(0x0734, 0x12345678, &packet);
+    TEST_ASSERT_EQUAL(BM_PKG_CREATED, result);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, &packet, sizeof(expected));
+
+    TEST_ASSERT_EQUAL(BM_ERROR, bm_create_timestamp_pkt(0, 0, NULL));
+}
+
+
+void test_bm_create_adapter_pkt(void) {
+    const uint8_t data[3] = {0x01, 0x10, 0xFF};
+    const uint8_t expected[BM_ADAPTER_PKT_LEN(3)] = {0x10, 0x02, 0x51, 0x03, 0x01, 0x10, 0xFF, 0x01 ^ 0x10 ^ 0xFF,
+                                                     0x10, 0x03};
+    uint8_t packet[sizeof(expected) + 1];
+    memset(packet, 0xAA, sizeof(packet));
+
+    uint16_t len = bm_create_adapter_pkt(0x51, data, sizeof(data), packet, sizeof(packet));
+    TEST_ASSERT_EQUAL_UINT16(sizeof(expected), len);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, packet, sizeof(expected));
+    TEST_ASSERT_EQUAL_HEX8(0xAA, packet[sizeof(expected)]);
+
+    // doesn't fit
+    len = bm_create_adapter_pkt(0x51, data, sizeof(data), packet, sizeof(expected) - 1);
+    TEST_ASSERT_EQUAL_UINT16(0, len);
+    // without data
+    len = bm_create_adapter_pkt(0x51, NULL, 0, packet, sizeof(packet));
+    TEST_ASSERT_EQUAL_UINT16(BM_ADAPTER_PKT_LEN(0), len);
+    TEST_ASSERT_EQUAL_HEX8(0, packet[4]);
+}
 
 int main(void) {
     UNITY_BEGIN();
     RUN_TEST(test_bm_calculate_pkt_check_sum);
     RUN_TEST(test_bm_fill_pkt_constants);
     RUN_TEST(test_convert_digit_segs_to_val);
+    RUN_TEST(test_bm_take_invalid_digits_no);
     RUN_TEST(test_convert_sanwa_ir_data_to_bm_pkt);
     RUN_TEST(test_convert_sanwa_ir_data_to_bm_pkt_OVER_LIMIT);
     RUN_TEST(test_bm_create_pkt);
     RUN_TEST(test_bm_create_pkt_OVER_LIMIT);
+    RUN_TEST(test_bm_create_timestamp_pkt);
+    RUN_TEST(test_bm_create_adapter_pkt);
     return UNITY_END();
 }
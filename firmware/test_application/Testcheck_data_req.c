@@ -39,6 +39,31 @@ void test_for_invalid_part_of_req_and_valid_req(void) {
     TEST_ASSERT_EQUAL(1, retval);
 }
 
+void test_parsers_keep_own_state(void) {
+    data_req_parser first;
+    data_req_parser second;
+    data_req_parser_init(&first);
+    data_req_parser_init(&second);
+
+    TEST_ASSERT_EQUAL(0, data_req_parser_check(&first, validReq, 5));
+    TEST_ASSERT_EQUAL(0, data_req_parser_check(&second, invalidReqAt4, 5));
+
+    TEST_ASSERT_EQUAL(1, data_req_parser_check(&first, &validReq[5], sizeof(validReq) - 5));
+    TEST_ASSERT_EQUAL(0, data_req_parser_check(&second, &validReq[5], sizeof(validReq) - 5));
+}
+
+void test_request_after_truncated_one(void) {
+    data_req_parser parser;
+    data_req_parser_init(&parser);
+
+    // DLE which breaks the match starts the next request
+    TEST_ASSERT_EQUAL(0, data_req_parser_check(&parser, validReq, 4));
+    TEST_ASSERT_EQUAL(1, data_req_parser_check(&parser, validReq, sizeof(validReq)));
+
+    // DLE before ETX followed by the next request
+    TEST_ASSERT_EQUAL(0, data_req_parser_check(&parser, validReq, 7));
+    TEST_ASSERT_EQUAL(1, data_req_parser_check(&parser, &validReq[1], sizeof(validReq) - 1));
+}
 
 int main (void) {
     UNITY_BEGIN();
@@ -46,5 +71,7 @@ int main (void) {
     RUN_TEST(test_for_valid_request);
     RUN_TEST(test_for_valid_request_in_2_parts);
     RUN_TEST(test_for_invalid_part_of_req_and_valid_req);
+    RUN_TEST(test_parsers_keep_own_state);
+    RUN_TEST(test_request_after_truncated_one);
     return UNITY_END();
 }
@@ -0,0 +1,120 @@
+#include "unity.h"
+#include "event_loop.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// Order of handler calls, each handler appends its event identifier
+static uint8_t callsOrder[8];
+static int callsNo;
+
+static void record_call(const event_id ev) {
+    if (callsNo < (int)sizeof(callsOrder)) {
+        callsOrder[callsNo] = (uint8_t)ev;
+    }
+    ++callsNo;
+}
+
+static void soft_timer_handler(void) {
+    record_call(EVENT_SOFT_TIMER);
+}
+
+static void acq_req_handler(void) {
+    record_call(EVENT_ACQ_REQ);
+}
+
+/// Posts other event from inside the handler, like a task which continues its work
+static void ir_end_handler(void) {
+    record_call(EVENT_IR_END);
+    event_post(EVENT_ACQ_REQ);
+}
+
+void setUp(void) {
+    callsNo = 0;
+    for (int ev = 0; ev < EVENT_NO; ++ev) {
+        event_loop_register((event_id)ev, NULL);
+    }
+    // drop events left by previous test
+    event_loop_dispatch();
+    event_loop_register(EVENT_SOFT_TIMER, soft_timer_handler);
+    event_loop_register(EVENT_IR_END, ir_end_handler);
+    event_loop_register(EVENT_ACQ_REQ, acq_req_handler);
+}
+
+void tearDown(void) {
+}
+
+void test_idle_without_events(void) {
+    TEST_ASSERT_TRUE(event_loop_is_idle());
+    TEST_ASSERT_EQUAL(0, event_loop_dispatch());
+    TEST_ASSERT_EQUAL(0, callsNo);
+}
+
+void test_register_invalid_event(void) {
+    TEST_ASSERT_FALSE(event_loop_register(EVENT_NO, soft_timer_handler));
+}
+
+void test_multiple_posts_are_coalesced(void) {
+    event_post(EVENT_SOFT_TIMER);
+    event_post(EVENT_SOFT_TIMER);
+    TEST_ASSERT_FALSE(event_loop_is_idle());
+
+    TEST_ASSERT_EQUAL(1, event_loop_dispatch());
+    TEST_ASSERT_EQUAL(1, callsNo);
+    TEST_ASSERT_TRUE(event_loop_is_idle());
+}
+
+void test_handlers_are_called_in_order_of_identifiers(void) {
+    event_post(EVENT_ACQ_REQ);
+    event_post(EVENT_SOFT_TIMER);
+
+    TEST_ASSERT_EQUAL(2, event_loop_dispatch());
+    TEST_ASSERT_EQUAL(2, callsNo);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_SOFT_TIMER, callsOrder[0]);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_ACQ_REQ, callsOrder[1]);
+}
+
+void test_event_posted_by_handler_waits_for_next_dispatch(void) {
+    event_post(EVENT_IR_END);
+
+    TEST_ASSERT_EQUAL(1, event_loop_dispatch());
+    TEST_ASSERT_EQUAL(1, callsNo);
+    TEST_ASSERT_FALSE(event_loop_is_idle());
+
+    TEST_ASSERT_EQUAL(1, event_loop_dispatch());
+    TEST_ASSERT_EQUAL(2, callsNo);
+    TEST_ASSERT_EQUAL_UINT8(EVENT_ACQ_REQ, callsOrder[1]);
+    TEST_ASSERT_TRUE(event_loop_is_idle());
+}
+
+void test_event_without_handler_is_consumed(void) {
+    event_post(EVENT_HOST_CMD);
+
+    TEST_ASSERT_EQUAL(1, event_loop_dispatch());
+    TEST_ASSERT_EQUAL(0, callsNo);
+    TEST_ASSERT_TRUE(event_loop_is_idle());
+}
+
+void test_dispatch_count(void) {
+    const uint32_t count = event_loop_get_dispatch_count(EVENT_SOFT_TIMER);
+
+    event_post(EVENT_SOFT_TIMER);
+    event_post(EVENT_SOFT_TIMER);
+    TEST_ASSERT_EQUAL_UINT32(count, event_loop_get_dispatch_count(EVENT_SOFT_TIMER));
+
+    event_loop_dispatch();
+    TEST_ASSERT_EQUAL_UINT32(count + 1, event_loop_get_dispatch_count(EVENT_SOFT_TIMER));
+    TEST_ASSERT_EQUAL_UINT32(0, event_loop_get_dispatch_count(EVENT_NO));
+}
+
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_without_events);
+    RUN_TEST(test_register_invalid_event);
+    RUN_TEST(test_multiple_posts_are_coalesced);
+    RUN_TEST(test_handlers_are_called_in_order_of_identifiers);
+    RUN_TEST(test_event_posted_by_handler_waits_for_next_dispatch);
+    RUN_TEST(test_event_without_handler_is_consumed);
+    RUN_TEST(test_dispatch_count);
+    return UNITY_END();
+}
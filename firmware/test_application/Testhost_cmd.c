@@ -0,0 +1,115 @@
+#include "unity.h"
+#include "host_cmd.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "bm_protocol_defs.h"
+
+#define CMD_FRAME(cmd, arg0, arg1) {BM_DLE_CONST, BM_STX_CONST, (cmd), (arg0), (arg1), (cmd) ^ (arg0) ^ (arg1), \
+                                    BM_DLE_CONST, BM_ETX_CONST}
+
+static const uint8_t streamStartCmd[8] = CMD_FRAME(BM_ADAPTER_CMD_STREAM_START, 0xE8, 0x03);
+static const uint8_t streamStopCmd[8] = CMD_FRAME(BM_ADAPTER_CMD_STREAM_STOP, 0, 0);
+static const uint8_t dataReq[8] = CMD_FRAME(BM_DATA_REQ_COMMAND, 0, 0);
+static const uint8_t invalidChkSum[8] = {BM_DLE_CONST, BM_STX_CONST, BM_ADAPTER_CMD_STREAM_START, 1, 2, 0,
+                                         BM_DLE_CONST, BM_ETX_CONST};
+
+static host_cmd_parser parser;
+static uint8_t lastSource;
+static uint8_t lastCmd;
+static uint16_t lastArg;
+static int callsNo;
+
+static void cmd_callback(const uint8_t source, const uint8_t cmd, const uint8_t arg0, const uint8_t arg1) {
+    lastSource = source;
+    lastCmd = cmd;
+    lastArg = (uint16_t)(arg0 | (arg1 << 8));
+    ++callsNo;
+}
+
+void setUp(void) {
+    host_cmd_parser_init(&parser, 0);
+    lastSource = 0xFF;
+    lastCmd = 0;
+    lastArg = 0;
+    callsNo = 0;
+}
+
+void tearDown(void) {
+}
+
+void test_for_valid_command(void) {
+    uint8_t retval = check_buffer_for_host_cmd(&parser, streamStartCmd, sizeof(streamStartCmd), cmd_callback);
+    TEST_ASSERT_EQUAL(1, retval);
+    TEST_ASSERT_EQUAL(1, callsNo);
+    TEST_ASSERT_EQUAL_UINT8(BM_ADAPTER_CMD_STREAM_START, lastCmd);
+    TEST_ASSERT_EQUAL_UINT16(1000, lastArg);
+    TEST_ASSERT_EQUAL_UINT8(0, lastSource);
+}
+
+void test_for_invalid_checksum(void) {
+    uint8_t retval = check_buffer_for_host_cmd(&parser, invalidChkSum, sizeof(invalidChkSum), cmd_callback);
+    TEST_ASSERT_EQUAL(0, retval);
+    TEST_ASSERT_EQUAL(0, callsNo);
+}
+
+void test_data_request_is_not_a_command(void) {
+    uint8_t retval = check_buffer_for_host_cmd(&parser, dataReq, sizeof(dataReq), cmd_callback);
+    TEST_ASSERT_EQUAL(0, retval);
+    TEST_ASSERT_EQUAL(0, callsNo);
+}
+
+void test_for_valid_command_in_2_parts(void) {
+    uint8_t retval = check_buffer_for_host_cmd(&parser, streamStopCmd, 3, cmd_callback);
+    TEST_ASSERT_EQUAL(0, retval);
+
+    retval = check_buffer_for_host_cmd(&parser, &streamStopCmd[3], sizeof(streamStopCmd) - 3, cmd_callback);
+    TEST_ASSERT_EQUAL(1, retval);
+    TEST_ASSERT_EQUAL_UINT8(BM_ADAPTER_CMD_STREAM_STOP, lastCmd);
+}
+
+void test_for_broken_frame_followed_by_command(void) {
+    uint8_t buff[3 + sizeof(streamStartCmd)];
+    memcpy(buff, invalidChkSum, 3);
+    memcpy(&buff[3], streamStartCmd, sizeof(streamStartCmd));
+
+    uint8_t retval = check_buffer_for_host_cmd(&parser, buff, sizeof(buff), cmd_callback);
+    TEST_ASSERT_EQUAL(1, retval);
+    TEST_ASSERT_EQUAL_UINT8(BM_ADAPTER_CMD_STREAM_START, lastCmd);
+}
+
+void test_for_many_commands_without_callback(void) {
+    uint8_t buff[2 * sizeof(streamStartCmd)];
+    memcpy(buff, streamStartCmd, sizeof(streamStartCmd));
+    memcpy(&buff[sizeof(streamStartCmd)], streamStopCmd, sizeof(streamStopCmd));
+
+    uint8_t retval = check_buffer_for_host_cmd(&parser, buff, sizeof(buff), NULL);
+    TEST_ASSERT_EQUAL(2, retval);
+}
+
+void test_for_independent_parsers(void) {
+    host_cmd_parser other;
+    host_cmd_parser_init(&other, 1);
+
+    // the first part of frame goes to one parser, the rest to the other one -> no match
+    uint8_t retval = check_buffer_for_host_cmd(&parser, streamStopCmd, 3, cmd_callback);
+    retval += check_buffer_for_host_cmd(&other, &streamStopCmd[3], sizeof(streamStopCmd) - 3, cmd_callback);
+    TEST_ASSERT_EQUAL(0, retval);
+
+    retval = check_buffer_for_host_cmd(&other, streamStartCmd, sizeof(streamStartCmd), cmd_callback);
+    TEST_ASSERT_EQUAL(1, retval);
+    TEST_ASSERT_EQUAL_UINT8(1, lastSource);
+}
+
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_for_valid_command);
+    RUN_TEST(test_for_invalid_checksum);
+    RUN_TEST(test_data_request_is_not_a_command);
+    RUN_TEST(test_for_valid_command_in_2_parts);
+    RUN_TEST(test_for_broken_frame_followed_by_command);
+    RUN_TEST(test_for_many_commands_without_callback);
+    RUN_TEST(test_for_independent_parsers);
+    return UNITY_END();
+}
@@ -0,0 +1,77 @@
+#include "unity.h"
+#include "latency_hist.h"
+#include <stdint.h>
+#include <stddef.h>
+
+static latency_hist hist;
+
+void setUp(void) {
+    latency_hist_reset(&hist);
+}
+
+void tearDown(void) {
+}
+
+void test_bin_boundaries(void) {
+    TEST_ASSERT_EQUAL_UINT8(0, latency_hist_bin(0));
+    TEST_ASSERT_EQUAL_UINT8(0, latency_hist_bin(1));
+    TEST_ASSERT_EQUAL_UINT8(1, latency_hist_bin(2));
+    TEST_ASSERT_EQUAL_UINT8(1, latency_hist_bin(3));
+    TEST_ASSERT_EQUAL_UINT8(2, latency_hist_bin(4));
+    TEST_ASSERT_EQUAL_UINT8(9, latency_hist_bin(1023));
+    TEST_ASSERT_EQUAL_UINT8(10, latency_hist_bin(1024));
+    TEST_ASSERT_EQUAL_UINT8(13, latency_hist_bin(10000));
+    TEST_ASSERT_EQUAL_UINT8(LATENCY_HIST_BINS - 1, latency_hist_bin(1UL << (LATENCY_HIST_BINS - 1)));
+}
+
+void test_long_durations_go_to_last_bin(void) {
+    TEST_ASSERT_EQUAL_UINT8(LATENCY_HIST_BINS - 1, latency_hist_bin(1UL << LATENCY_HIST_BINS));
+    TEST_ASSERT_EQUAL_UINT8(LATENCY_HIST_BINS - 1, latency_hist_bin(UINT32_MAX));
+}
+
+void test_add(void) {
+    latency_hist_add(&hist, 0);
+    latency_hist_add(&hist, 5);
+    latency_hist_add(&hist, 6);
+    latency_hist_add(&hist, 10000);
+
+    TEST_ASSERT_EQUAL_UINT32(1, hist.bins[0]);
+    TEST_ASSERT_EQUAL_UINT32(2, hist.bins[2]);
+    TEST_ASSERT_EQUAL_UINT32(1, hist.bins[13]);
+    TEST_ASSERT_EQUAL_UINT32(4, hist.samples);
+    TEST_ASSERT_EQUAL_UINT32(10000, hist.max_us);
+}
+
+void test_bin_saturates(void) {
+    hist.bins[3] = UINT32_MAX;
+    latency_hist_add(&hist, 8);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, hist.bins[3]);
+}
+
+void test_reset(void) {
+    latency_hist_add(&hist, 100);
+    latency_hist_reset(&hist);
+
+    for (int i = 0; i < LATENCY_HIST_BINS; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(0, hist.bins[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, hist.samples);
+    TEST_ASSERT_EQUAL_UINT32(0, hist.max_us);
+}
+
+void test_null_histogram(void) {
+    latency_hist_add(NULL, 1);
+    latency_hist_reset(NULL);
+}
+
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_bin_boundaries);
+    RUN_TEST(test_long_durations_go_to_last_bin);
+    RUN_TEST(test_add);
+    RUN_TEST(test_bin_saturates);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_null_histogram);
+    return UNITY_END();
+}
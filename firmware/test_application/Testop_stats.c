@@ -0,0 +1,96 @@
+#include "unity.h"
+#include "op_stats.h"
+#include <stdint.h>
+#include <stddef.h>
+
+void setUp(void) {
+    op_stats_snapshot stats;
+    // start each test with cleared statistics
+    op_stats_get(&stats, true);
+}
+
+void tearDown(void) {
+}
+
+void test_empty_statistics(void) {
+    op_stats_snapshot stats;
+    op_stats_get(&stats, false);
+
+    for (int i = 0; i < OP_STAT_COUNTERS_NO; ++i) {
+        TEST_ASSERT_EQUAL_UINT32(0, stats.counters[i]);
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latencyNo);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latencyMin_us);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latencyMean_us);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latencyMax_us);
+}
+
+void test_counters(void) {
+    op_stats_add(OP_STAT_REQUESTS, 3);
+    op_stats_add(OP_STAT_REQUESTS, 1);
+    op_stats_add(OP_STAT_DMM_TIMEOUTS, 1);
+    op_stats_add(OP_STAT_COUNTERS_NO, 1);
+
+    op_stats_snapshot stats;
+    op_stats_get(&stats, false);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.counters[OP_STAT_REQUESTS]);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.counters[OP_STAT_DMM_TIMEOUTS]);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.counters[OP_STAT_ACQUISITIONS]);
+
+    // reading without reset keeps the values
+    op_stats_get(&stats, false);
+    TEST_ASSERT_EQUAL_UINT32(4, stats.counters[OP_STAT_REQUESTS]);
+}
+
+void test_latency(void) {
+    op_stats_add_latency(300);
+    op_stats_add_latency(100);
+    op_stats_add_latency(500);
+
+    op_stats_snapshot stats;
+    op_stats_get(&stats, false);
+    TEST_ASSERT_EQUAL_UINT32(3, stats.latencyNo);
+    TEST_ASSERT_EQUAL_UINT32(100, stats.latencyMin_us);
+    TEST_ASSERT_EQUAL_UINT32(300, stats.latencyMean_us);
+    TEST_ASSERT_EQUAL_UINT32(500, stats.latencyMax_us);
+}
+
+void test_reset(void) {
+    op_stats_add(OP_STAT_OL_PACKETS, 2);
+    op_stats_add_latency(1000);
+
+    op_stats_snapshot stats;
+    op_stats_get(&stats, true);
+    TEST_ASSERT_EQUAL_UINT32(2, stats.counters[OP_STAT_OL_PACKETS]);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.latencyNo);
+
+    op_stats_get(&stats, false);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.counters[OP_STAT_OL_PACKETS]);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.latencyNo);
+
+    // minimum starts again from the first sample after reset
+    op_stats_add_latency(2000);
+    op_stats_get(&stats, false);
+    TEST_ASSERT_EQUAL_UINT32(2000, stats.latencyMin_us);
+    TEST_ASSERT_EQUAL_UINT32(2000, stats.latencyMax_us);
+}
+
+void test_null_snapshot(void) {
+    op_stats_add(OP_STAT_REQUESTS, 1);
+    op_stats_get(NULL, true);
+
+    op_stats_snapshot stats;
+    op_stats_get(&stats, false);
+    TEST_ASSERT_EQUAL_UINT32(1, stats.counters[OP_STAT_REQUESTS]);
+}
+
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_empty_statistics);
+    RUN_TEST(test_counters);
+    RUN_TEST(test_latency);
+    RUN_TEST(test_reset);
+    RUN_TEST(test_null_snapshot);
+    return UNITY_END();
+}
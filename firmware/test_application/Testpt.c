@@ -0,0 +1,198 @@
+#include "unity.h"
+#include "pt.h"
+#include "soft_timer.h"
+#include "event_loop.h"
+#include <stdint.h>
+#include <stddef.h>
+
+/// Fake tick counter, replaces the one driven by SysTick
+static systick_t ticks;
+
+systick_t st_get_ticks(void) {
+    return ticks;
+}
+
+static pt_ctx ptA;
+static pt_ctx ptB;
+/// Progress of the coroutines, each step sets it to the tick when it was reached
+static systick_t stepsA[8];
+static int stepsANo;
+static int stepsBNo;
+static pt_result resultA;
+static pt_result resultB;
+/// Number of resumes of coroutine A
+static int resumesA;
+/// Coroutine B exits when this is set
+static bool exitB;
+
+/// Awaits time: 5 ms, 1 ms, 0 ms
+static PT_THREAD(coroutine_a(pt_ctx* const pt)) {
+    PT_BEGIN(pt);
+    stepsA[stepsANo++] = ticks;
+    PT_AWAIT_MS(pt, 5);
+    stepsA[stepsANo++] = ticks;
+    PT_AWAIT_MS(pt, 1);
+    stepsA[stepsANo++] = ticks;
+    PT_AWAIT_MS(pt, 0);
+    stepsA[stepsANo++] = ticks;
+    PT_END(pt);
+}
+
+/// Awaits host commands until exitB is set
+static PT_THREAD(coroutine_b(pt_ctx* const pt)) {
+    PT_BEGIN(pt);
+    for (;;) {
+        PT_AWAIT_EVENT(pt, EVENT_HOST_CMD);
+        ++stepsBNo;
+        if (exitB) {
+            PT_EXIT(pt);
+        }
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+static void resume_a(void) {
+    if (PT_WAITING == resultA) {
+        ++resumesA;
+        resultA = coroutine_a(&ptA);
+    }
+}
+
+static void resume_b(void) {
+    if (PT_WAITING == resultB) {
+        resultB = coroutine_b(&ptB);
+    }
+}
+
+/// Works like the main loop: the tick posts EVENT_SOFT_TIMER, then all events are dispatched
+static void advance(void) {
+    ++ticks;
+    event_post(EVENT_SOFT_TIMER);
+    while (0 != event_loop_dispatch()) {;}
+}
+
+void setUp(void) {
+    // drop events left by the previous test
+    for (int ev = 0; ev < EVENT_NO; ++ev) {
+        event_loop_register((event_id)ev, NULL);
+    }
+    event_loop_dispatch();
+    soft_timer_cancel(&ptA.timer);
+    soft_timer_cancel(&ptB.timer);
+
+    ticks = 100;
+    stepsANo = 0;
+    stepsBNo = 0;
+    resumesA = 0;
+    exitB = false;
+    PT_INIT(&ptA);
+    PT_INIT(&ptB);
+    resultA = PT_WAITING;
+    resultB = PT_WAITING;
+    event_loop_register(EVENT_SOFT_TIMER, soft_timer_poll);
+    event_loop_register(EVENT_PT_WAKEUP, resume_a);
+    event_loop_register(EVENT_HOST_CMD, resume_b);
+}
+
+void tearDown(void) {
+}
+
+void test_await_ms_resumes_on_wakeup(void) {
+    TEST_ASSERT_EQUAL(PT_WAITING, coroutine_a(&ptA));
+    TEST_ASSERT_EQUAL(1, stepsANo);
+    TEST_ASSERT_EQUAL(100, stepsA[0]);
+
+    for (int i = 0; i < 4; ++i) {
+        advance();
+        TEST_ASSERT_EQUAL(1, stepsANo);
+    }
+    TEST_ASSERT_EQUAL(0, resumesA);
+    advance();
+    TEST_ASSERT_EQUAL(2, stepsANo);
+    TEST_ASSERT_EQUAL(105, stepsA[1]);
+    TEST_ASSERT_EQUAL(PT_WAITING, resultA);
+
+    advance();
+    TEST_ASSERT_EQUAL(3, stepsANo);
+    TEST_ASSERT_EQUAL(106, stepsA[2]);
+    // zero delay passes at the next tick
+    advance();
+    TEST_ASSERT_EQUAL(4, stepsANo);
+    TEST_ASSERT_EQUAL(107, stepsA[3]);
+    TEST_ASSERT_EQUAL(PT_ENDED, resultA);
+    TEST_ASSERT_EQUAL(3, resumesA);
+
+    // the next call starts it again
+    TEST_ASSERT_EQUAL(PT_WAITING, coroutine_a(&ptA));
+    TEST_ASSERT_EQUAL(5, stepsANo);
+}
+
+void test_await_ms_ignores_other_wakeups(void) {
+    coroutine_a(&ptA);
+    advance();
+    // wake-up posted for another coroutine resumes this one too, it must keep waiting
+    event_post(EVENT_PT_WAKEUP);
+    event_loop_dispatch();
+    TEST_ASSERT_EQUAL(1, resumesA);
+    TEST_ASSERT_EQUAL(1, stepsANo);
+    for (int i = 0; i < 4; ++i) {
+        advance();
+    }
+    TEST_ASSERT_EQUAL(2, stepsANo);
+    TEST_ASSERT_EQUAL(105, stepsA[1]);
+}
+
+void test_await_event_counts_from_now(void) {
+    // event dispatched before the coroutine starts waiting doesn't count
+    event_post(EVENT_HOST_CMD);
+    event_loop_register(EVENT_HOST_CMD, NULL);
+    event_loop_dispatch();
+    event_loop_register(EVENT_HOST_CMD, resume_b);
+
+    TEST_ASSERT_EQUAL(PT_WAITING, coroutine_b(&ptB));
+    TEST_ASSERT_EQUAL(0, stepsBNo);
+    advance();
+    TEST_ASSERT_EQUAL(0, stepsBNo);
+
+    event_post(EVENT_HOST_CMD);
+    event_loop_dispatch();
+    TEST_ASSERT_EQUAL(1, stepsBNo);
+    TEST_ASSERT_EQUAL(PT_WAITING, resultB);
+    // yielded, the next resume starts waiting for a new event
+    resume_b();
+    TEST_ASSERT_EQUAL(1, stepsBNo);
+
+    exitB = true;
+    event_post(EVENT_HOST_CMD);
+    event_loop_dispatch();
+    TEST_ASSERT_EQUAL(2, stepsBNo);
+    TEST_ASSERT_EQUAL(PT_EXITED, resultB);
+}
+
+void test_coroutines_wait_independently(void) {
+    coroutine_a(&ptA);
+    coroutine_b(&ptB);
+    advance();
+    advance();
+    event_post(EVENT_HOST_CMD);
+    advance();
+    TEST_ASSERT_EQUAL(1, stepsBNo);
+    TEST_ASSERT_EQUAL(1, stepsANo);
+    advance();
+    advance();
+    TEST_ASSERT_EQUAL(2, stepsANo);
+    TEST_ASSERT_EQUAL(105, stepsA[1]);
+    TEST_ASSERT_EQUAL(1, stepsBNo);
+    TEST_ASSERT_EQUAL(PT_WAITING, resultB);
+}
+
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_await_ms_resumes_on_wakeup);
+    RUN_TEST(test_await_ms_ignores_other_wakeups);
+    RUN_TEST(test_await_event_counts_from_now);
+    RUN_TEST(test_coroutines_wait_independently);
+    return UNITY_END();
+}
@@ -0,0 +1,267 @@
+#include "unity.h"
+#include "soft_timer.h"
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+/// Fake tick counter, replaces the one driven by SysTick
+static systick_t ticks;
+
+systick_t st_get_ticks(void) {
+    return ticks;
+}
+
+static soft_timer_descr timA;
+static soft_timer_descr timB;
+static soft_timer_descr timC;
+static int callsA;
+static int callsB;
+static int callsC;
+/// Order of callback calls, each callback appends its letter
+static char callsOrder[16];
+
+static void record_call(const char name) {
+    const size_t len = strlen(callsOrder);
+    if (len < (sizeof(callsOrder) - 1)) {
+        callsOrder[len] = name;
+    }
+}
+
+static void callback_a(void) {
+    ++callsA;
+    record_call('A');
+}
+
+static void callback_b(void) {
+    ++callsB;
+    record_call('B');
+}
+
+/// Cancels timer A from inside the callback
+static void callback_c(void) {
+    ++callsC;
+    record_call('C');
+    soft_timer_cancel(&timA);
+}
+
+static void advance(const int ticks_no) {
+    for (int i = 0; i < ticks_no; ++i) {
+        ++ticks;
+        soft_timer_poll();
+    }
+}
+
+void setUp(void) {
+    // timers left by previous test
+    soft_timer_cancel(&timA);
+    soft_timer_cancel(&timB);
+    soft_timer_cancel(&timC);
+    ticks = 1000;
+    callsA = 0;
+    callsB = 0;
+    callsC = 0;
+    memset(callsOrder, 0, sizeof(callsOrder));
+}
+
+void tearDown(void) {
+}
+
+void test_one_shot_times_out_once(void) {
+    TEST_ASSERT_TRUE(soft_timer_start_one_shot(&timA, 10, callback_a));
+    TEST_ASSERT_TRUE(soft_timer_is_running(&timA));
+
+    advance(9);
+    TEST_ASSERT_EQUAL(0, callsA);
+    TEST_ASSERT_FALSE(timA.is_timed_out);
+
+    advance(1);
+    TEST_ASSERT_EQUAL(1, callsA);
+    TEST_ASSERT_TRUE(timA.is_timed_out);
+    TEST_ASSERT_FALSE(soft_timer_is_running(&timA));
+
+    advance(20);
+    TEST_ASSERT_EQUAL(1, callsA);
+}
+
+void test_continuous_keeps_period(void) {
+    TEST_ASSERT_TRUE(soft_timer_start_continuous(&timA, 5, callback_a));
+    advance(25);
+    TEST_ASSERT_EQUAL(5, callsA);
+    TEST_ASSERT_TRUE(soft_timer_is_running(&timA));
+}
+
+void test_continuous_skips_missed_events(void) {
+    TEST_ASSERT_TRUE(soft_timer_start_continuous(&timA, 5, callback_a));
+    // polling delayed by 3 periods
+    ticks += 17;
+    soft_timer_poll();
+    TEST_ASSERT_EQUAL(1, callsA);
+
+    advance(4);
+    TEST_ASSERT_EQUAL(1, callsA);
+    advance(1);
+    TEST_ASSERT_EQUAL(2, callsA);
+}
+
+void test_continuous_requires_period(void) {
+    TEST_ASSERT_FALSE(soft_timer_start_continuous(&timA, 0, callback_a));
+    TEST_ASSERT_FALSE(soft_timer_is_running(&timA));
+}
+
+void test_timers_time_out_in_order_of_expiry(void) {
+    soft_timer_start_one_shot(&timA, 30, callback_a);
+    soft_timer_start_one_shot(&timB, 10, callback_b);
+    soft_timer_start_one_shot(&timC, 20, callback_c);
+
+    advance(30);
+    TEST_ASSERT_EQUAL_STRING("BC", callsOrder);
+    // timer A was cancelled by C
+    TEST_ASSERT_EQUAL(0, callsA);
+}
+
+void test_timers_expiring_at_the_same_tick(void) {
+    soft_timer_start_one_shot(&timA, 10, callback_a);
+    soft_timer_start_one_shot(&timB, 10, callback_b);
+
+    advance(10);
+    TEST_ASSERT_EQUAL_STRING("AB", callsOrder);
+}
+
+void test_restart_postpones_timeout(void) {
+    soft_timer_start_one_shot(&timA, 10, callback_a);
+    advance(8);
+    TEST_ASSERT_TRUE(soft_timer_restart(&timA));
+
+    advance(9);
+    TEST_ASSERT_EQUAL(0, callsA);
+    advance(1);
+    TEST_ASSERT_EQUAL(1, callsA);
+}
+
+void test_cancel(void) {
+    soft_timer_start_continuous(&timA, 10, callback_a);
+    soft_timer_start_continuous(&timB, 10, callback_b);
+
+    TEST_ASSERT_TRUE(soft_timer_cancel(&timA));
+    TEST_ASSERT_FALSE(soft_timer_cancel(&timA));
+
+    advance(10);
+    TEST_ASSERT_EQUAL(0, callsA);
+    TEST_ASSERT_EQUAL(1, callsB);
+}
+
+void test_terminating_request(void) {
+    soft_timer_start_one_shot(&timA, 10, callback_a);
+    // set inside the interrupt
+    timA.terminating_req = 1;
+    TEST_ASSERT_FALSE(soft_timer_is_running(&timA));
+
+    advance(10);
+    TEST_ASSERT_EQUAL(0, callsA);
+    TEST_ASSERT_FALSE(timA.is_linked);
+}
+
+void test_terminating_request_before_expiry(void) {
+    uint32_t nextTimeout = 0;
+    soft_timer_start_one_shot(&timA, 30, callback_a);
+    soft_timer_start_one_shot(&timB, 10, callback_b);
+    soft_timer_start_one_shot(&timC, 20, callback_c);
+    // timers deep in the heap, set inside the interrupt
+    timA.terminating_req = 1;
+    timC.terminating_req = 1;
+
+    advance(1);
+    TEST_ASSERT_FALSE(timA.is_linked);
+    TEST_ASSERT_TRUE(timA.is_timed_out);
+    TEST_ASSERT_FALSE(timC.is_linked);
+    TEST_ASSERT_TRUE(timC.is_timed_out);
+    TEST_ASSERT_TRUE(soft_timer_is_running(&timB));
+
+    // the root is skipped when the next wake-up is computed
+    timB.terminating_req = 1;
+    TEST_ASSERT_FALSE(soft_timer_get_next_timeout(&nextTimeout));
+    TEST_ASSERT_FALSE(timB.is_linked);
+
+    advance(30);
+    TEST_ASSERT_EQUAL(0, callsA + callsB + callsC);
+}
+
+void test_tick_counter_wrap_around(void) {
+    ticks = -5;
+    soft_timer_start_one_shot(&timA, 10, callback_a);
+    advance(9);
+    TEST_ASSERT_EQUAL(0, callsA);
+    advance(1);
+    TEST_ASSERT_EQUAL(1, callsA);
+}
+
+void test_next_timeout(void) {
+    uint32_t nextTimeout = 0;
+    TEST_ASSERT_FALSE(soft_timer_get_next_timeout(&nextTimeout));
+
+    soft_timer_start_one_shot(&timA, 30, callback_a);
+    soft_timer_start_one_shot(&timB, 10, callback_b);
+    TEST_ASSERT_TRUE(soft_timer_get_next_timeout(&nextTimeout));
+    TEST_ASSERT_EQUAL_UINT32(10, nextTimeout);
+
+    // poll delayed after timeout
+    ticks += 12;
+    TEST_ASSERT_TRUE(soft_timer_get_next_timeout(&nextTimeout));
+    TEST_ASSERT_EQUAL_UINT32(0, nextTimeout);
+
+    soft_timer_poll();
+    TEST_ASSERT_TRUE(soft_timer_get_next_timeout(&nextTimeout));
+    TEST_ASSERT_EQUAL_UINT32(18, nextTimeout);
+}
+
+/// Many timers, some cancelled while deep inside the heap, the rest must time out in order of expiry
+void test_many_timers_with_cancellation(void) {
+    enum {MANY_NO = 64};
+    static soft_timer_descr many[MANY_NO];
+
+    for (int i = 0; i < MANY_NO; ++i) {
+        // expiry order differs from start order
+        soft_timer_start_one_shot(&many[i], 1 + ((i * 37) % MANY_NO), NULL);
+    }
+    // pop a few so the heap gets deeper structure
+    advance(4);
+    for (int i = 0; i < MANY_NO; i += 3) {
+        soft_timer_cancel(&many[i]);
+    }
+
+    int lastExpiredTick = 0;
+    for (int tick = 5; tick <= MANY_NO; ++tick) {
+        advance(1);
+        for (int i = 0; i < MANY_NO; ++i) {
+            const int timeout = 1 + ((i * 37) % MANY_NO);
+            if ((timeout == tick) && (0 != (i % 3))) {
+                TEST_ASSERT_TRUE(many[i].is_timed_out);
+                TEST_ASSERT_FALSE(many[i].is_linked);
+                lastExpiredTick = tick;
+            } else if ((timeout > tick) && (0 != (i % 3))) {
+                TEST_ASSERT_FALSE(many[i].is_timed_out);
+                TEST_ASSERT_TRUE(many[i].is_linked);
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(MANY_NO, lastExpiredTick);
+}
+
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_one_shot_times_out_once);
+    RUN_TEST(test_continuous_keeps_period);
+    RUN_TEST(test_continuous_skips_missed_events);
+    RUN_TEST(test_continuous_requires_period);
+    RUN_TEST(test_timers_time_out_in_order_of_expiry);
+    RUN_TEST(test_timers_expiring_at_the_same_tick);
+    RUN_TEST(test_restart_postpones_timeout);
+    RUN_TEST(test_cancel);
+    RUN_TEST(test_terminating_request);
+    RUN_TEST(test_terminating_request_before_expiry);
+    RUN_TEST(test_tick_counter_wrap_around);
+    RUN_TEST(test_next_timeout);
+    RUN_TEST(test_many_timers_with_cancellation);
+    return UNITY_END();
+}
@@ -0,0 +1,173 @@
+#include "unity.h"
+#include "systick_local.h"
+#include <libopencm3/cm3/systick.h>
+#include <libopencm3/cm3/nvic.h>
+#include <libopencm3/cm3/scb.h>
+#include <stdint.h>
+#include <stddef.h>
+
+/// Interrupt handlers of systick_local.c
+void sys_tick_handler(void);
+void pend_sv_handler(void);
+
+enum {
+    AHB_HZ = 72000000,
+    TICK_HZ = 1000,
+    /// SysTick period in cycles
+    LEN = AHB_HZ / TICK_HZ
+};
+
+/// Fake SysTick: reload and current value registers
+static uint32_t reload;
+static uint32_t value;
+/// Fake SCB registers, written by the code under test directly
+static volatile uint32_t icsr;
+static volatile uint32_t shcsr;
+static volatile uint32_t otherReg;
+
+/// Cycles at the start of the current SysTick period
+static uint64_t periodStart;
+/// Time read by the tick callback
+static uint64_t readInCallback;
+
+volatile uint32_t* sim_mmio32(const uint32_t addr) {
+    switch (addr) {
+    case 0xE000ED04: return &icsr;
+    case 0xE000ED24: return &shcsr;
+    default:         return &otherReg;
+    }
+}
+
+bool systick_set_frequency(uint32_t freq, uint32_t ahb) {
+    reload = (ahb / freq) - 1;
+    return true;
+}
+
+void systick_interrupt_enable(void) {
+}
+
+void systick_counter_enable(void) {
+}
+
+void systick_counter_disable(void) {
+}
+
+void systick_set_reload(uint32_t val) {
+    reload = val;
+}
+
+uint32_t systick_get_reload(void) {
+    return reload;
+}
+
+uint32_t systick_get_value(void) {
+    return value;
+}
+
+void systick_clear(void) {
+    value = 0;
+}
+
+void nvic_set_priority(uint8_t irqn, uint8_t priority) {
+    (void)irqn;
+    (void)priority;
+}
+
+static void read_time(void) {
+    readInCallback = st_get_cycles64();
+}
+
+/// Sets SysTick given number of cycles after the wrap which starts the next period
+static void wrap(const uint32_t cycles_after) {
+    periodStart += LEN;
+    value = LEN - cycles_after;
+}
+
+/// Returns from SysTick interrupt, PendSV runs if it was pended like on the core
+static void return_from_sys_tick(void) {
+    shcsr = 0;
+    if (0 != (icsr & SCB_ICSR_PENDSVSET)) {
+        icsr &= ~SCB_ICSR_PENDSVSET;
+        pend_sv_handler();
+    }
+}
+
+void setUp(void) {
+    static bool initialized = false;
+    if (false == initialized) {
+        TEST_ASSERT_TRUE(st_init(TICK_HZ, AHB_HZ));
+        initialized = true;
+    }
+    icsr = 0;
+    shcsr = 0;
+    // 1 cycle after the start of the current period
+    value = LEN - 1;
+    periodStart = st_get_cycles64() - 1;
+    readInCallback = 0;
+}
+
+void tearDown(void) {
+    st_register_tick_callback(NULL);
+}
+
+void test_read_without_wrap(void) {
+    value = LEN - 1000;
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 1000, st_get_cycles64());
+}
+
+void test_read_with_wrap_pending(void) {
+    // a reader of higher priority than SysTick runs after the wrap
+    wrap(20);
+    icsr = SCB_ICSR_PENDSTSET;
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 20, st_get_cycles64());
+
+    shcsr = SCB_SHCSR_SYSTICKACT;
+    icsr = 0;
+    sys_tick_handler();
+    return_from_sys_tick();
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 20, st_get_cycles64());
+}
+
+void test_read_from_tick_callback(void) {
+    st_register_tick_callback(read_time);
+    wrap(100);
+    shcsr = SCB_SHCSR_SYSTICKACT;
+    sys_tick_handler();
+    // the period is published, the active SysTick interrupt must not add its wrap again
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 100, readInCallback);
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 100, st_get_cycles64());
+    TEST_ASSERT_TRUE(0 != (icsr & SCB_ICSR_PENDSVSET));
+
+    // a reader of higher priority than SysTick runs after the return, before PendSV
+    shcsr = 0;
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 100, st_get_cycles64());
+    return_from_sys_tick();
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 100, st_get_cycles64());
+}
+
+void test_read_preempting_sys_tick_before_publish(void) {
+    // previous SysTick interrupt was handled, the next one enters and is preempted before it publishes the period
+    wrap(1);
+    shcsr = SCB_SHCSR_SYSTICKACT;
+    sys_tick_handler();
+    return_from_sys_tick();
+
+    wrap(50);
+    shcsr = SCB_SHCSR_SYSTICKACT;
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 50, st_get_cycles64());
+
+    st_register_tick_callback(read_time);
+    sys_tick_handler();
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 50, readInCallback);
+    return_from_sys_tick();
+    TEST_ASSERT_EQUAL_UINT64(periodStart + 50, st_get_cycles64());
+}
+
+int main (void) {
+    UNITY_BEGIN();
+    RUN_TEST(test_read_without_wrap);
+    RUN_TEST(test_read_with_wrap_pending);
+    RUN_TEST(test_read_from_tick_callback);
+    RUN_TEST(test_read_preempting_sys_tick_before_publish);
+    return UNITY_END();
+}
@@ -0,0 +1,60 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @file Helpers of host benchmarks.
+ *
+ * Each benchmark prints one CSV line per measured case: bench,case,ns_per_op,ops_per_s (the header is printed by
+ * 'make bench'). A case is run several times and the median run is reported, neither a disturbed run nor a lucky one
+ * moves it. 'make bench' repeats all benchmarks several times and compares medians of the passes too.
+ */
+
+/// Number of runs of each case, odd so the median is one of them
+#define BENCH_RUNS  15
+
+/// Written by benchmarks, so the compiler can't remove results of measured calls
+static volatile uint32_t bench_sink;
+
+static inline double bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/// Prints the result of the case, ns is total time of ops operations
+static inline void bench_report(const char* const bench, const char* const name, const double ns, const uint32_t ops) {
+    const double nsPerOp = ns / ops;
+    printf("%s,%s,%.2f,%.0f\n", bench, name, nsPerOp, 1e9 / nsPerOp);
+}
+
+/// Returns the median of BENCH_RUNS times, the times are sorted
+static inline double bench_median(double* const ns) {
+    for (int i = 1; i < BENCH_RUNS; ++i) {
+        const double t = ns[i];
+        int j = i;
+        for (; (j > 0) && (ns[j - 1] > t); --j) {
+            ns[j] = ns[j - 1];
+        }
+        ns[j] = t;
+    }
+    return ns[BENCH_RUNS / 2];
+}
+
+/// Runs the case BENCH_RUNS times and reports the median run, body does ops operations
+#define BENCH_CASE(bench, name, ops, body)                      \
+    do {                                                        \
+        double runs[BENCH_RUNS];                                \
+        for (int run = 0; run < BENCH_RUNS; ++run) {            \
+            const double start = bench_now_ns();                \
+            body;                                               \
+            runs[run] = bench_now_ns() - start;                 \
+        }                                                       \
+        const double median = bench_median(runs);               \
+        bench_report((bench), (name), median, (ops));           \
+    } while (0)
+
+#endif // BENCH_H_
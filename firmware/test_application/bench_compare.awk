@@ -0,0 +1,80 @@
+# Compares results of benchmarks with the baseline, both CSV files made by 'make bench'.
+#
+# Usage: awk -v threshold=PERCENT -f bench_compare.awk baseline.csv result.csv
+#
+# Each file can hold several passes of the benchmarks, the median of each case is compared. Prints results with the
+# change against the baseline and exits with 1 if any case is slower by more than threshold percents. Cases missing in
+# the baseline are only printed.
+
+# Returns the median of n values in v[1..n], sorts them
+function median(v, n,    i, j, t) {
+    for (i = 2; i <= n; ++i) {
+        t = v[i]
+        for (j = i - 1; (j > 0) && (v[j] > t); --j) {
+            v[j + 1] = v[j]
+        }
+        v[j + 1] = t
+    }
+    return (n % 2) ? v[(n + 1) / 2] : (v[n / 2] + v[n / 2 + 1]) / 2
+}
+
+BEGIN {
+    FS = ","
+    failed = 0
+    baselineFile = ARGV[1]
+    while ((getline line < baselineFile) > 0) {
+        split(line, f, ",")
+        if ("bench" != f[1]) {
+            key = f[1] "," f[2]
+            baseNo[key]++
+            baseRuns[key, baseNo[key]] = f[3]
+        }
+    }
+    close(baselineFile)
+    ARGV[1] = ""
+    for (key in baseNo) {
+        for (i = 1; i <= baseNo[key]; ++i) {
+            v[i] = baseRuns[key, i]
+        }
+        baseline[key] = median(v, baseNo[key])
+    }
+    printf "%-18s %-28s %12s %14s %9s\n", "bench", "case", "ns_per_op", "ops_per_s", "change"
+}
+
+"bench" == $1 {
+    next
+}
+
+{
+    key = $1 "," $2
+    if (!(key in resNo)) {
+        order[++keysNo] = key
+    }
+    resNo[key]++
+    resRuns[key, resNo[key]] = $3
+}
+
+END {
+    for (k = 1; k <= keysNo; ++k) {
+        key = order[k]
+        for (i = 1; i <= resNo[key]; ++i) {
+            v[i] = resRuns[key, i]
+        }
+        nsPerOp = median(v, resNo[key])
+        change = "new"
+        if (key in baseline) {
+            percent = (nsPerOp - baseline[key]) * 100 / baseline[key]
+            change = sprintf("%+.1f%%", percent)
+            if (percent > threshold) {
+                change = change " SLOWER"
+                failed = 1
+            }
+        }
+        split(key, names, ",")
+        printf "%-18s %-28s %12.2f %14.0f %9s\n", names[1], names[2], nsPerOp, 1e9 / nsPerOp, change
+    }
+    if (failed) {
+        printf "\nregression over %s%% of the baseline\n", threshold
+        exit 1
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef BM_REFERENCE_H_
+#define BM_REFERENCE_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "bm_dmm_protocol.h"
+#include "bm_protocol_defs.h"
+
+/**
+ * @file Reference models of the DMM frame decoder and of the data request parser.
+ *
+ * They are written from the description of the frame and of the request, not from the application code, and kept
+ * simple rather than fast. Golden regression and fuzzers compare the application implementations with them, so
+ * a faster implementation can replace the current one without changing anything the host receives.
+ */
+
+/// Segments of digits as sent by the meter with the dot/beep bit cleared, and characters shown
+static const struct {
+    uint8_t segs;
+    uint8_t ch;
+} ref_digits[] = {
+    {0xbe, '0'}, {0xa0, '1'}, {0xda, '2'}, {0xf8, '3'}, {0xe4, '4'}, {0x7c, '5'}, {0x7e, '6'}, {0xa8, '7'},
+    {0xfe, '8'}, {0xfc, '9'}, {0x00, ' '}, {0x16, 'L'},
+};
+
+/// Character shown by the segments of the digit, blank for unknown patterns which are counted
+static inline uint8_t ref_digit(const uint8_t segs, uint32_t* const invalid_no) {
+    for (size_t v = 0; v < sizeof(ref_digits) / sizeof(ref_digits[0]); ++v) {
+        if ((segs & 0xFE) == ref_digits[v].segs) {
+            return ref_digits[v].ch;
+        }
+    }
+    ++*invalid_no;
+    return ' ';
+}
+
+/**
+ * Builds the Brymen packet of the 16-byte frame.
+ * @param invalid_no incremented by the number of digits with unknown segments pattern
+ * @return packet length
+ */
+static inline size_t ref_packet(const uint8_t* const frame, uint8_t* const pkt, uint32_t* const invalid_no) {
+    uint8_t func[4] = {0};
+    const uint8_t b0 = frame[0];
+    const uint8_t b7 = frame[7];
+    const uint8_t b8 = frame[8];
+
+    func[0] |= (b0 & 0x04) ? BM_PROTO_SYM_AC : 0;
+    func[0] |= (b0 & 0x08) ? BM_PROTO_SYM_DC : 0;
+    func[0] |= (b7 & 0x02) ? BM_PROTO_SYM_Cx : 0;
+    func[0] |= (b7 & 0x80) ? BM_PROTO_SYM_V : 0;
+    func[0] |= (b8 & 0x02) ? BM_PROTO_SYM_Ohm : 0;
+    func[1] |= (frame[1] & 0x01) ? BM_PROTO_SYM_BEEP : 0;
+    func[1] |= (b7 & 0x08) ? BM_PROTO_SYM_A : 0;
+    func[1] |= (b7 & 0x10) ? BM_PROTO_SYM_dB : 0;
+    func[1] |= (b8 & 0x01) ? BM_PROTO_SYM_Hz : 0;
+    func[1] |= (b8 & 0x80) ? BM_PROTO_SYM_PERCENTAGE : 0;
+    func[3] |= (b0 & 0x20) ? BM_PROTO_SYM_LOWBAT : 0;
+
+    // digits up to the 4th one are decoded always, L there means OL and the rest isn't decoded
+    enum {REF_DIGITS_NO = 6, REF_OL_DIGIT = 3};
+    uint8_t chars[REF_DIGITS_NO];
+    const bool overLimit = ((frame[1 + REF_OL_DIGIT] & 0xFE) == 0x16);
+    const int digitsNo = overLimit ? (REF_OL_DIGIT + 1) : REF_DIGITS_NO;
+    for (int d = 0; d < digitsNo; ++d) {
+        chars[d] = ref_digit(frame[1 + d], invalid_no);
+    }
+
+    size_t len = 0;
+    pkt[len++] = BM_DLE_CONST;
+    pkt[len++] = BM_STX_CONST;
+    pkt[len++] = overLimit ? BM_DATA_RESP_OV_COMMAND : BM_DATA_RESP_COMMAND;
+    pkt[len++] = overLimit ? BM_OL_PACKET_DATA_LENGTH : BM_NORMAL_PACKET_DATA_LENGTH;
+    memcpy(&pkt[len], func, sizeof(func));
+    len += sizeof(func);
+    pkt[len++] = (b0 & 0x02) ? '-' : ' ';
+
+    if (overLimit) {
+        pkt[len++] = 'O';
+        pkt[len++] = 'L';
+    } else {
+        // value is d1.d2d3d4d5d6, dot after digit k means exponent k-1; prefixes are applied in the order of bits
+        // of bytes 7 and 8, modulo 256 like the single byte of the packet
+        uint8_t exponent = 0;
+        for (int d = 1; d <= 5; ++d) {
+            if (0 != (frame[1 + d] & 0x01)) {
+                exponent = (uint8_t)(d - 1);
+            }
+        }
+        const bool negative = (0 != (b7 & (0x04 | 0x20 | 0x40)));
+        exponent = (b7 & 0x04) ? (uint8_t)(9 - exponent) : exponent;
+        exponent = (b7 & 0x20) ? (uint8_t)(3 - exponent) : exponent;
+        exponent = (b7 & 0x40) ? (uint8_t)(6 - exponent) : exponent;
+        exponent = (b8 & 0x04) ? (uint8_t)(exponent + 3) : exponent;
+        exponent = (b8 & 0x08) ? (uint8_t)(exponent + 6) : exponent;
+
+        pkt[len++] = chars[0];
+        pkt[len++] = '.';
+        memcpy(&pkt[len], &chars[1], REF_DIGITS_NO - 1);
+        len += REF_DIGITS_NO - 1;
+        pkt[len++] = 'E';
+        pkt[len++] = negative ? '-' : '+';
+        pkt[len++] = (uint8_t)(exponent + '0');
+    }
+
+    uint8_t chk = 0;
+    for (size_t i = sizeof(data_resp_header); i < len; ++i) {
+        chk ^= pkt[i];
+    }
+    pkt[len++] = chk;
+    pkt[len++] = BM_DLE_CONST;
+    pkt[len++] = BM_ETX_CONST;
+    return len;
+}
+
+/// Number of data requests in the byte stream, however it is split into USB packets
+static inline uint32_t ref_data_requests(const uint8_t* const stream, const size_t len) {
+    static const uint8_t request[8] = {BM_DLE_CONST, BM_STX_CONST, BM_DATA_REQ_COMMAND, 0, 0, 0, BM_DLE_CONST,
+                                       BM_ETX_CONST};
+    uint32_t requestsNo = 0;
+
+    for (size_t i = 0; i + sizeof(request) <= len; ) {
+        if (0 == memcmp(&stream[i], request, sizeof(request))) {
+            ++requestsNo;
+            i += sizeof(request);
+        } else {
+            ++i;
+        }
+    }
+    return requestsNo;
+}
+
+#endif // BM_REFERENCE_H_
@@ -0,0 +1,340 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/**
+ * @file Minimal coverage guided fuzzing driver for targets with libFuzzer entry point, for hosts without clang.
+ *
+ * Code under test is built with gcc -fsanitize-coverage=trace-pc, each executed block calls
+ * __sanitizer_cov_trace_pc. Transitions between blocks are hashed into a map (like AFL does); an input which hits
+ * a transition not seen before is added to the corpus and mutated further. The driver itself isn't instrumented.
+ *
+ * Command line follows libFuzzer, so the makefile runs both the same way:
+ *
+ *   Fuzzxxx.out [-runs=N] [-max_total_time=S] [-seed=N] [-max_len=N] [dir|file]...
+ *
+ * Files are executed once each (reproduction of a crash) and the driver exits. Directories are loaded as the seed
+ * corpus, new inputs are written to the first one. The input of a crash (sanitizer error or abort of the target) is
+ * written to crash-<digest> in the current directory.
+ */
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+int LLVMFuzzerInitialize(int* argc, char*** argv) __attribute__((weak));
+void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+#define COV_MAP_SIZE    (1 << 16)
+#define MAX_CORPUS      4096
+#define MAX_PATH        512
+#define MUTATIONS_MAX   8
+
+/// Transitions hit by the current input
+static uint8_t covMap[COV_MAP_SIZE];
+/// Transitions hit by any input so far
+static uint8_t covTotal[COV_MAP_SIZE];
+static uintptr_t prevPc;
+
+static struct {
+    uint8_t* data;
+    size_t   size;
+} corpus[MAX_CORPUS];
+static size_t corpusNo;
+
+static struct {
+    uint64_t runs;
+    uint32_t maxTotalTime;
+    uint32_t seed;
+    size_t   maxLen;
+} opts = {
+    .runs = UINT64_MAX,
+    .maxTotalTime = 0,
+    .seed = 1,
+    .maxLen = 4096,
+};
+
+static const char* outDir;
+static const uint8_t* volatile currentData;
+static volatile size_t currentSize;
+static uint64_t rngState;
+static uint32_t covered;
+
+void __sanitizer_cov_trace_pc(void) {
+    const uintptr_t pc = (uintptr_t)__builtin_return_address(0);
+    covMap[(pc ^ prevPc) & (COV_MAP_SIZE - 1)] = 1;
+    prevPc = pc >> 1;
+}
+
+static uint32_t rnd(void) {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 7;
+    rngState ^= rngState << 17;
+    return (uint32_t)(rngState >> 16);
+}
+
+static uint64_t fnv1a(const uint8_t* const data, const size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x00000100000001B3ULL;
+    }
+    return hash;
+}
+
+static void write_input(const char* const dir, const char* const prefix, const uint8_t* const data,
+                        const size_t size, const bool verbose) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s%s%s%016llx", (NULL != dir) ? dir : "", (NULL != dir) ? "/" : "", prefix,
+             (unsigned long long)fnv1a(data, size));
+    FILE* const f = fopen(path, "wb");
+    if (NULL != f) {
+        fwrite(data, 1, size, f);
+        fclose(f);
+        if (verbose) {
+            fprintf(stderr, "input written to %s\n", path);
+        }
+    }
+}
+
+static void on_death(void) {
+    if (NULL != currentData) {
+        write_input(NULL, "crash-", (const uint8_t*)currentData, currentSize, true);
+    }
+}
+
+static void on_signal(const int sig) {
+    on_death();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+/// Runs the input, returns number of transitions it hit first
+static uint32_t execute(const uint8_t* const data, const size_t size) {
+    // copy of exact size, so sanitizers catch reading after the input
+    uint8_t* const copy = malloc(size ? size : 1);
+    memcpy(copy, data, size);
+    currentData = copy;
+    currentSize = size;
+
+    memset(covMap, 0, sizeof(covMap));
+    prevPc = 0;
+    LLVMFuzzerTestOneInput(copy, size);
+
+    currentData = NULL;
+    free(copy);
+
+    uint32_t newNo = 0;
+    for (uint32_t i = 0; i < COV_MAP_SIZE; ++i) {
+        if ((0 != covMap[i]) && (0 == covTotal[i])) {
+            covTotal[i] = 1;
+            ++newNo;
+        }
+    }
+    covered += newNo;
+    return newNo;
+}
+
+static void corpus_add(const uint8_t* const data, const size_t size) {
+    if (corpusNo < MAX_CORPUS) {
+        corpus[corpusNo].data = malloc(size ? size : 1);
+        memcpy(corpus[corpusNo].data, data, size);
+        corpus[corpusNo].size = size;
+        ++corpusNo;
+    }
+}
+
+static bool read_file(const char* const path, uint8_t** const data, size_t* const size) {
+    FILE* const f = fopen(path, "rb");
+    if (NULL == f) {
+        return false;
+    }
+    *data = malloc(opts.maxLen ? opts.maxLen : 1);
+    *size = fread(*data, 1, opts.maxLen, f);
+    fclose(f);
+    return true;
+}
+
+static void load_dir(const char* const dir) {
+    DIR* const d = opendir(dir);
+    if (NULL == d) {
+        return;
+    }
+    const struct dirent* entry;
+    while (NULL != (entry = readdir(d))) {
+        char path[MAX_PATH];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        uint8_t* data;
+        size_t size;
+        if ((0 == stat(path, &st)) && S_ISREG(st.st_mode) && read_file(path, &data, &size)) {
+            if (execute(data, size) > 0) {
+                corpus_add(data, size);
+            }
+            free(data);
+        }
+    }
+    closedir(d);
+}
+
+/// Applies few random mutations to the input in buff, returns new size
+static size_t mutate(uint8_t* const buff, size_t size) {
+    static const uint8_t interesting[] = {0x00, 0x01, 0x02, 0x03, 0x10, 0x7F, 0x80, 0xFE, 0xFF};
+    const uint32_t mutationsNo = 1 + (rnd() % MUTATIONS_MAX);
+
+    for (uint32_t m = 0; m < mutationsNo; ++m) {
+        const uint32_t op = rnd() % 7;
+        switch (op) {
+        case 0: // flip bit
+            if (size > 0) {
+                buff[rnd() % size] ^= (uint8_t)(1 << (rnd() % 8));
+            }
+            break;
+        case 1: // random byte
+            if (size > 0) {
+                buff[rnd() % size] = (uint8_t)rnd();
+            }
+            break;
+        case 2: // interesting byte
+            if (size > 0) {
+                buff[rnd() % size] = interesting[rnd() % sizeof(interesting)];
+            }
+            break;
+        case 3: // insert byte
+            if (size < opts.maxLen) {
+                const size_t at = rnd() % (size + 1);
+                memmove(&buff[at + 1], &buff[at], size - at);
+                buff[at] = (uint8_t)rnd();
+                ++size;
+            }
+            break;
+        case 4: // erase bytes
+            if (size > 0) {
+                const size_t at = rnd() % size;
+                const size_t len = 1 + (rnd() % (size - at));
+                memmove(&buff[at], &buff[at + len], size - at - len);
+                size -= len;
+            }
+            break;
+        case 5: // copy part of the input to another place
+        case 6: // insert part of another input of the corpus
+        default: {
+            const uint8_t* src = buff;
+            size_t srcSize = size;
+            if ((6 == op) && (corpusNo > 0)) {
+                const size_t other = rnd() % corpusNo;
+                src = corpus[other].data;
+                srcSize = corpus[other].size;
+            }
+            if ((srcSize > 0) && (size < opts.maxLen)) {
+                const size_t from = rnd() % srcSize;
+                size_t len = 1 + (rnd() % (srcSize - from));
+                if (len > opts.maxLen - size) {
+                    len = opts.maxLen - size;
+                }
+                uint8_t part[len];
+                memcpy(part, &src[from], len);
+                const size_t at = rnd() % (size + 1);
+                memmove(&buff[at + len], &buff[at], size - at);
+                memcpy(&buff[at], part, len);
+                size += len;
+            }
+            break;
+        }
+        }
+    }
+    return size;
+}
+
+int main(int argc, char** argv) {
+    if (NULL != LLVMFuzzerInitialize) {
+        LLVMFuzzerInitialize(&argc, &argv);
+    }
+    if (NULL != __sanitizer_set_death_callback) {
+        __sanitizer_set_death_callback(on_death);
+    }
+    signal(SIGABRT, on_signal);
+    signal(SIGSEGV, on_signal);
+    signal(SIGILL, on_signal);
+    signal(SIGFPE, on_signal);
+
+    bool filesOnly = true;
+    bool anyPath = false;
+    for (int i = 1; i < argc; ++i) {
+        if (1 == sscanf(argv[i], "-runs=%llu", (unsigned long long*)&opts.runs)) continue;
+        if (1 == sscanf(argv[i], "-max_total_time=%u", &opts.maxTotalTime)) continue;
+        if (1 == sscanf(argv[i], "-seed=%u", &opts.seed)) continue;
+        if (1 == sscanf(argv[i], "-max_len=%zu", &opts.maxLen)) continue;
+        if ('-' == argv[i][0]) {
+            fprintf(stderr, "unknown option %s ignored\n", argv[i]);
+            continue;
+        }
+        struct stat st;
+        anyPath = true;
+        if ((0 == stat(argv[i], &st)) && S_ISDIR(st.st_mode)) {
+            filesOnly = false;
+        }
+    }
+    rngState = 0x9E3779B97F4A7C15ULL ^ opts.seed;
+
+    // reproduction of given inputs
+    if (anyPath && filesOnly) {
+        for (int i = 1; i < argc; ++i) {
+            uint8_t* data;
+            size_t size;
+            if (('-' != argv[i][0]) && read_file(argv[i], &data, &size)) {
+                fprintf(stderr, "running %s (%zu bytes)\n", argv[i], size);
+                execute(data, size);
+                free(data);
+            }
+        }
+        fprintf(stderr, "done\n");
+        return 0;
+    }
+
+    for (int i = 1; i < argc; ++i) {
+        if ('-' != argv[i][0]) {
+            if (NULL == outDir) {
+                outDir = argv[i];
+                mkdir(outDir, 0755);
+            }
+            load_dir(argv[i]);
+        }
+    }
+    if (0 == corpusNo) {
+        const uint8_t empty = 0;
+        execute(&empty, 0);
+        corpus_add(&empty, 0);
+    }
+    fprintf(stderr, "seed corpus: %zu inputs, %u transitions\n", corpusNo, (unsigned)covered);
+
+    uint8_t* const buff = malloc(opts.maxLen);
+    const time_t start = time(NULL);
+    uint64_t run = 0;
+    for (; run < opts.runs; ++run) {
+        if ((0 != opts.maxTotalTime) && (0 == (run & 0x3FF)) && (time(NULL) - start >= opts.maxTotalTime)) {
+            break;
+        }
+        const size_t from = rnd() % corpusNo;
+        size_t size = (corpus[from].size < opts.maxLen) ? corpus[from].size : opts.maxLen;
+        memcpy(buff, corpus[from].data, size);
+        size = mutate(buff, size);
+
+        if (execute(buff, size) > 0) {
+            corpus_add(buff, size);
+            if (NULL != outDir) {
+                write_input(outDir, "", buff, size, false);
+            }
+        }
+    }
+    free(buff);
+
+    fprintf(stderr, "done: %llu runs, corpus: %zu inputs, %u transitions\n", (unsigned long long)run, corpusNo,
+            (unsigned)covered);
+    return 0;
+}
@@ -0,0 +1,70 @@
+#!/usr/bin/env python3
+"""
+Measures throughput of the adapter's CDC data endpoint on the host side.
+
+The adapter is switched into streaming mode and every received byte is counted. Brymen packets (DLE STX ... DLE ETX)
+are counted separately and gaps between them are reported, so the effect of endpoint buffering can be seen directly.
+
+Usage: cdc_throughput.py /dev/ttyACM0 [--interval-ms 0] [--seconds 10]
+Requires pyserial.
+"""
+import argparse
+import time
+
+import serial
+
+DLE = 0x10
+STX = 0x02
+ETX = 0x03
+CMD_STREAM_START = 0x40
+CMD_STREAM_STOP = 0x41
+
+
+def cmd_frame(cmd, arg0=0, arg1=0):
+    return bytes([DLE, STX, cmd, arg0, arg1, cmd ^ arg0 ^ arg1, DLE, ETX])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port')
+    parser.add_argument('--interval-ms', type=int, default=0, help='streaming interval, 0 - as fast as possible')
+    parser.add_argument('--seconds', type=float, default=10.0, help='duration of the measurement')
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, timeout=0.1) as port:
+        port.reset_input_buffer()
+        port.write(cmd_frame(CMD_STREAM_START, args.interval_ms & 0xFF, (args.interval_ms >> 8) & 0xFF))
+
+        total_bytes = 0
+        packets = 0
+        gaps = []
+        last_packet_time = None
+        prev_byte = None
+        start = time.monotonic()
+        while time.monotonic() - start < args.seconds:
+            chunk = port.read(4096)
+            now = time.monotonic()
+            total_bytes += len(chunk)
+            for byte in chunk:
+                # packet ends with DLE ETX
+                if prev_byte == DLE and byte == ETX:
+                    packets += 1
+                    if last_packet_time is not None:
+                        gaps.append(now - last_packet_time)
+                    last_packet_time = now
+                prev_byte = byte
+        elapsed = time.monotonic() - start
+
+        port.write(cmd_frame(CMD_STREAM_STOP))
+
+    print('elapsed       : %.3f s' % elapsed)
+    print('bytes         : %d (%.1f B/s)' % (total_bytes, total_bytes / elapsed))
+    print('packets       : %d (%.2f pkt/s)' % (packets, packets / elapsed))
+    if gaps:
+        gaps.sort()
+        print('packet gap ms : min %.3f, median %.3f, max %.3f'
+              % (gaps[0] * 1e3, gaps[len(gaps) // 2] * 1e3, gaps[-1] * 1e3))
+
+
+if __name__ == '__main__':
+    main()
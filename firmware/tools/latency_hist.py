@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Reads histograms of data request latency from the adapter and prints them per phase.
+
+Each served data request is split into phases: queueing, start impulse, DMM wake up, clocking data in, decoding and
+handing the packet to the USB endpoint. The adapter answers the histogram command with two packets per phase
+(DLE STX 0x54 LEN data CHK DLE ETX). Bin 0 counts durations shorter than 2 us, bin n counts 2^n .. 2^(n+1)-1 us.
+
+Usage: latency_hist.py /dev/ttyACM0 [--reset]
+Requires pyserial.
+"""
+import argparse
+import struct
+import time
+
+import serial
+
+DLE = 0x10
+STX = 0x02
+ETX = 0x03
+CMD_LATENCY_HIST = 0x47
+LATENCY_COMMAND = 0x54
+
+PHASES = ['queue', 'start pulse', 'DMM wake', 'clock-in', 'decode', 'USB']
+BINS = 22
+
+
+def cmd_frame(cmd, arg0=0, arg1=0):
+    return bytes([DLE, STX, cmd, arg0, arg1, cmd ^ arg0 ^ arg1, DLE, ETX])
+
+
+def read_packets(port, count, timeout_s):
+    """Returns data of given number of histogram packets."""
+    packets = []
+    buff = bytearray()
+    deadline = time.monotonic() + timeout_s
+    while len(packets) < count:
+        if time.monotonic() > deadline:
+            raise TimeoutError('received %d of %d packets' % (len(packets), count))
+        buff += port.read(4096)
+        while True:
+            start = buff.find(bytes([DLE, STX, LATENCY_COMMAND]))
+            if start < 0 or len(buff) < start + 4:
+                break
+            data_len = buff[start + 3]
+            end = start + 4 + data_len + 3
+            if len(buff) < end:
+                break
+            data = bytes(buff[start + 4:start + 4 + data_len])
+            chk = 0
+            for byte in data:
+                chk ^= byte
+            valid = chk == buff[end - 3] and buff[end - 2] == DLE and buff[end - 1] == ETX
+            del buff[:end if valid else start + 1]
+            if valid:
+                packets.append(data)
+    return packets
+
+
+def bin_label(n):
+    if n == 0:
+        return '< 2 us'
+    if n == BINS - 1:
+        return '>= %d us' % (1 << n)
+    return '%d .. %d us' % (1 << n, (1 << (n + 1)) - 1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port')
+    parser.add_argument('--reset', action='store_true', help='clear histograms after reading')
+    parser.add_argument('--timeout', type=float, default=2.0, help='timeout in seconds')
+    args = parser.parse_args()
+
+    with serial.Serial(args.port, timeout=0.1) as port:
+        port.reset_input_buffer()
+        port.write(cmd_frame(CMD_LATENCY_HIST, 1 if args.reset else 0))
+        packets = read_packets(port, len(PHASES) * 2, args.timeout)
+
+    hists = {}
+    for data in packets:
+        phase, first_bin, samples, max_us = struct.unpack_from('<BBII', data, 0)
+        counts = struct.unpack_from('<%dI' % ((len(data) - 10) // 4), data, 10)
+        hist = hists.setdefault(phase, {'samples': samples, 'max_us': max_us, 'bins': [0] * BINS})
+        for i, count in enumerate(counts):
+            if first_bin + i < BINS:
+                hist['bins'][first_bin + i] = count
+
+    for phase, name in enumerate(PHASES):
+        hist = hists.get(phase)
+        if hist is None:
+            continue
+        print('%s: %d samples, max %d us' % (name, hist['samples'], hist['max_us']))
+        top = max(hist['bins']) or 1
+        for n, count in enumerate(hist['bins']):
+            if count:
+                print('  %-22s %10d %s' % (bin_label(n), count, '#' * max(1, count * 40 // top)))
+
+
+if __name__ == '__main__':
+    main()
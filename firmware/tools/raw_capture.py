@@ -0,0 +1,158 @@
+#!/usr/bin/env python3
+"""
+Records raw DMM frames sent by the adapter into a capture file.
+
+The adapter is asked to send each raw frame (command 0x48) and to acquire continuously (stream start, 0x40). Each
+frame packet (DLE STX 0x55 LEN data CHK DLE ETX) carries the sequence number, the adapter's time of reading in us and
+16 bytes of the frame. Frames are appended to the capture as they come; index and footer are written when recording
+ends (Ctrl+C, --seconds or --frames). Layout of the capture is described in host_sim/raw_capture.h, captures are
+replayed through the decoder by host_sim/raw_replay.
+
+Usage: raw_capture.py /dev/ttyACM0 capture.bin [--interval-ms 0] [--seconds 0] [--frames 0] [--append]
+Requires pyserial.
+"""
+import argparse
+import os
+import struct
+import time
+
+DLE = 0x10
+STX = 0x02
+ETX = 0x03
+CMD_STREAM_START = 0x40
+CMD_STREAM_STOP = 0x41
+CMD_RAW_FRAMES = 0x48
+RAW_FRAME_COMMAND = 0x55
+
+MAGIC = b'SWRAWCAP'
+FOOTER_MAGIC = b'SWRAWIDX'
+VERSION = 1
+FRAME_BYTES = 16
+HEADER = struct.Struct('<8sHHHHQ40x')
+RECORD = struct.Struct('<QII%ds' % FRAME_BYTES)
+INDEX_ENTRY = struct.Struct('<QII')
+FOOTER = struct.Struct('<QII8s')
+INDEX_INTERVAL = 4096
+
+
+def cmd_frame(cmd, arg0=0, arg1=0):
+    return bytes([DLE, STX, cmd, arg0, arg1, cmd ^ arg0 ^ arg1, DLE, ETX])
+
+
+class CaptureWriter:
+    """Appends records to the capture file, writes index and footer on close."""
+
+    def __init__(self, path, append=False):
+        self.index = []
+        self.records = 0
+        if append and os.path.exists(path):
+            self.file = open(path, 'r+b')
+            magic, version, header_len, record_len, interval, self.start_unix_us = \
+                HEADER.unpack(self.file.read(HEADER.size))
+            if magic != MAGIC or version != VERSION or header_len != HEADER.size or record_len != RECORD.size:
+                raise ValueError('%s is not a capture of version %d' % (path, VERSION))
+            self.interval = interval
+            self.records = self._existing_records()
+            # cut off index and footer, rebuild index of existing records
+            self.file.truncate(HEADER.size + self.records * RECORD.size)
+            for n in range(0, self.records, self.interval):
+                self.file.seek(HEADER.size + n * RECORD.size)
+                device_us, seq, host_ms, _ = RECORD.unpack(self.file.read(RECORD.size))
+                self.index.append((device_us, seq, host_ms))
+            self.file.seek(0, os.SEEK_END)
+        else:
+            self.file = open(path, 'wb')
+            self.interval = INDEX_INTERVAL
+            self.start_unix_us = int(time.time() * 1e6)
+            self.file.write(HEADER.pack(MAGIC, VERSION, HEADER.size, RECORD.size, self.interval, self.start_unix_us))
+
+    def _existing_records(self):
+        body_len = self.file.seek(0, os.SEEK_END) - HEADER.size
+        if body_len >= FOOTER.size:
+            self.file.seek(-FOOTER.size, os.SEEK_END)
+            records, entries, _, magic = FOOTER.unpack(self.file.read(FOOTER.size))
+            if magic == FOOTER_MAGIC and records * RECORD.size + entries * INDEX_ENTRY.size + FOOTER.size == body_len:
+                return records
+        return body_len // RECORD.size
+
+    def append(self, seq, device_us, raw):
+        host_ms = (int(time.time() * 1e6) - self.start_unix_us) // 1000 & 0xFFFFFFFF
+        if self.records % self.interval == 0:
+            self.index.append((device_us, seq, host_ms))
+        self.file.write(RECORD.pack(device_us, seq, host_ms, raw))
+        self.records += 1
+
+    def close(self):
+        for entry in self.index:
+            self.file.write(INDEX_ENTRY.pack(*entry))
+        self.file.write(FOOTER.pack(self.records, len(self.index), 0, FOOTER_MAGIC))
+        self.file.close()
+
+
+def parse_frames(buff):
+    """Yields (seq, device_us, raw) of complete frame packets and removes parsed bytes from the buffer."""
+    while True:
+        start = buff.find(bytes([DLE, STX, RAW_FRAME_COMMAND]))
+        if start < 0 or len(buff) < start + 4:
+            return
+        data_len = buff[start + 3]
+        end = start + 4 + data_len + 3
+        if len(buff) < end:
+            return
+        data = bytes(buff[start + 4:start + 4 + data_len])
+        chk = 0
+        for byte in data:
+            chk ^= byte
+        valid = chk == buff[end - 3] and buff[end - 2] == DLE and buff[end - 1] == ETX and data_len == 12 + FRAME_BYTES
+        del buff[:end if valid else start + 1]
+        if valid:
+            seq, device_us = struct.unpack_from('<IQ', data, 0)
+            yield seq, device_us, data[12:]
+
+
+def main():
+    import serial
+
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port')
+    parser.add_argument('capture')
+    parser.add_argument('--interval-ms', type=int, default=0, help='acquisition interval, 0 - as fast as possible')
+    parser.add_argument('--seconds', type=float, default=0, help='stop after given time, 0 - until Ctrl+C')
+    parser.add_argument('--frames', type=int, default=0, help='stop after given number of frames, 0 - no limit')
+    parser.add_argument('--append', action='store_true', help='append to an existing capture')
+    args = parser.parse_args()
+
+    writer = CaptureWriter(args.capture, args.append)
+    frames = 0
+    gaps = 0
+    last_seq = None
+    with serial.Serial(args.port, timeout=0.1) as port:
+        port.reset_input_buffer()
+        port.write(cmd_frame(CMD_RAW_FRAMES, 1))
+        port.write(cmd_frame(CMD_STREAM_START, args.interval_ms & 0xFF, (args.interval_ms >> 8) & 0xFF))
+        deadline = time.monotonic() + args.seconds if args.seconds > 0 else None
+        buff = bytearray()
+        try:
+            while (deadline is None or time.monotonic() < deadline) and (args.frames == 0 or frames < args.frames):
+                buff += port.read(4096)
+                for seq, device_us, raw in parse_frames(buff):
+                    if last_seq is not None and seq != (last_seq + 1) & 0xFFFFFFFF:
+                        gaps += 1
+                    last_seq = seq
+                    writer.append(seq, device_us, raw)
+                    frames += 1
+                # data packets of streaming are not recorded
+                if len(buff) > 4096:
+                    del buff[:-64]
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.write(cmd_frame(CMD_STREAM_STOP))
+            port.write(cmd_frame(CMD_RAW_FRAMES, 0))
+            writer.close()
+
+    print('frames=%d gaps=%d records=%d' % (frames, gaps, writer.records))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Reads the adapter's trace buffer and prints it as a timeline.
+
+The adapter records events of the acquisition path (start pulse, DMM ready, received bytes, timeout, end of transfer,
+built packet, USB endpoint writes) with a core cycle counter timestamp. The dump command sends stored records in
+packets (DLE STX 0x52 LEN data CHK DLE ETX); the packet without records ends the dump.
+
+Usage: trace_timeline.py /dev/ttyACM0 [--mhz 48] [--pause]
+Requires pyserial.
+"""
+import argparse
+import struct
+import time
+
+import serial
+
+DLE = 0x10
+STX = 0x02
+ETX = 0x03
+CMD_TRACE_DUMP = 0x45
+TRACE_COMMAND = 0x52
+
+EVENT_NAMES = {
+    1: 'IR start pulse',
+    2: 'IR DMM ready',
+    3: 'IR byte',
+    4: 'IR timeout',
+    5: 'IR done',
+    6: 'packet built',
+    7: 'USB EP write',
+}
+
+
+def cmd_frame(cmd, arg0=0, arg1=0):
+    return bytes([DLE, STX, cmd, arg0, arg1, cmd ^ arg0 ^ arg1, DLE, ETX])
+
+
+def read_packets(port, timeout_s):
+    """Yields data of trace packets until the ending packet is received or timeout expires."""
+    buff = bytearray()
+    deadline = time.monotonic() + timeout_s
+    while time.monotonic() < deadline:
+        buff += port.read(4096)
+        while True:
+            start = buff.find(bytes([DLE, STX, TRACE_COMMAND]))
+            if start < 0 or len(buff) < start + 4:
+                break
+            data_len = buff[start + 3]
+            end = start + 4 + data_len + 3
+            if len(buff) < end:
+                break
+            data = bytes(buff[start + 4:start + 4 + data_len])
+            chk = 0
+            for byte in data:
+                chk ^= byte
+            valid = chk == buff[end - 3] and buff[end - 2] == DLE and buff[end - 1] == ETX
+            del buff[:end if valid else start + 1]
+            if not valid:
+                continue
+            if data_len <= 4:
+                return
+            yield data
+    raise TimeoutError('trace dump not finished')
+
+
+def describe(event, arg):
+    name = EVENT_NAMES.get(event, 'event %d' % event)
+    if event == 3:
+        return '%s #%d' % (name, arg)
+    if event == 5:
+        return '%s status %d' % (name, arg)
+    if event == 6:
+        return '%s channel %d' % (name, arg)
+    if event == 7:
+        return '%s channel %d, %d bytes%s' % (name, (arg >> 8) & 0x7F, arg & 0xFF, ', FAILED' if arg & 0x8000 else '')
+    return name
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port')
+    parser.add_argument('--mhz', type=float, default=48.0, help='core clock, used to convert cycles to time')
+    parser.add_argument('--pause', action='store_true', help='pause tracing while the buffer is dumped')
+    parser.add_argument('--timeout', type=float, default=5.0, help='dump timeout in seconds')
+    args = parser.parse_args()
+
+    records = []
+    with serial.Serial(args.port, timeout=0.1) as port:
+        port.reset_input_buffer()
+        port.write(cmd_frame(CMD_TRACE_DUMP, 1 if args.pause else 0))
+        for data in read_packets(port, args.timeout):
+            seq = struct.unpack_from('<I', data, 0)[0]
+            for offset in range(4, len(data) - 7, 8):
+                cycles, event, _, arg = struct.unpack_from('<IBBH', data, offset)
+                records.append((seq, cycles, event, arg))
+                seq += 1
+
+    if not records:
+        print('trace is empty')
+        return
+
+    # cycle counter is 32 bits wide, it wraps every ~89 s at 48 MHz
+    time_us = []
+    base = 0
+    prev_cycles = records[0][1]
+    for _, cycles, _, _ in records:
+        if cycles < prev_cycles:
+            base += 1 << 32
+        prev_cycles = cycles
+        time_us.append((base + cycles - records[0][1]) / args.mhz)
+
+    print('%10s %12s %10s  %s' % ('seq', 'time us', 'delta us', 'event'))
+    prev_us = time_us[0]
+    prev_seq = records[0][0] - 1
+    for (seq, _, event, arg), t_us in zip(records, time_us):
+        if seq != prev_seq + 1:
+            print('%10s  ... %d records lost' % ('', seq - prev_seq - 1))
+        print('%10d %12.1f %10.1f  %s' % (seq, t_us, t_us - prev_us, describe(event, arg)))
+        prev_us = t_us
+        prev_seq = seq
+
+
+if __name__ == '__main__':
+    main()